@@ -47,9 +47,10 @@ static bool cc_actor_camera_fire(struct cc_actor_t *actor)
 		if (obj_ref != NULL && cc_fifo_tokens_available(inport->fifo, 1)) {
 			cc_fifo_peek(inport->fifo);
 			if (cc_calvinsys_write(actor->calvinsys, obj_ref, (char *)"trigger", 7) != CC_SUCCESS) {
+				cc_fifo_cancel_commit(inport->fifo);
 				return false;
 			} else {
-				cc_fifo_commit_read(inport->fifo, false);
+				cc_fifo_commit_read(inport->fifo, true);
 				return true;
 			}
 		} else if (obj_ref != NULL && cc_calvinsys_can_read(actor->calvinsys, obj_ref) == true) {
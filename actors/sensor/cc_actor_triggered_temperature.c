@@ -122,10 +122,9 @@ static bool cc_actor_triggered_temperature_trigger_measurement(struct cc_actor_t
 	cc_fifo_peek(port->fifo);
 	cc_fifo_commit_read(port->fifo, true);
 
-	if (cc_calvinsys_write(actor->calvinsys, state->temperature, "\xc3", 1) != CC_SUCCESS) {
+	// the trigger token is consumed even if the measurement can't be started
+	if (cc_calvinsys_write(actor->calvinsys, state->temperature, "\xc3", 1) != CC_SUCCESS)
 		cc_log_error("Failed to start measurement");
-		return false;
-	}
 
 	return true;
 }
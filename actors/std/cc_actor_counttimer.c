@@ -27,13 +27,35 @@
 
 typedef struct cc_actor_counttimer_state_t {
 	char timer[CC_UUID_BUFFER_SIZE];
-	uint32_t sleep;
+	double sleep;
   uint32_t start;
   uint32_t steps;
   uint32_t count;
   bool stopped;
 } cc_actor_counttimer_state_t;
 
+// sleep is given in seconds, as uint or float
+static cc_result_t cc_actor_counttimer_decode_sleep(char *data, double *sleep)
+{
+	uint32_t value = 0;
+	float f = 0;
+
+	switch (cc_coder_type_of(data)) {
+	case CC_CODER_DOUBLE:
+		return cc_coder_decode_double(data, sleep);
+	case CC_CODER_FLOAT:
+		if (cc_coder_decode_float(data, &f) != CC_SUCCESS)
+			return CC_FAIL;
+		*sleep = f;
+		return CC_SUCCESS;
+	default:
+		if (cc_coder_decode_uint(data, &value) != CC_SUCCESS)
+			return CC_FAIL;
+		*sleep = value;
+		return CC_SUCCESS;
+	}
+}
+
 static cc_result_t cc_actor_counttimer_init(cc_actor_t *actor, cc_list_t *managed_attributes)
 {
 	cc_actor_counttimer_state_t *state = NULL;
@@ -51,9 +73,9 @@ static cc_result_t cc_actor_counttimer_init(cc_actor_t *actor, cc_list_t *manage
 
 	item = cc_list_get(managed_attributes, "sleep");
 	if (item == NULL) {
-		state->sleep = 1;
+		state->sleep = 1.0;
 	} else {
-		if (cc_coder_decode_uint(item->data, &state->sleep) != CC_SUCCESS) {
+		if (cc_actor_counttimer_decode_sleep(item->data, &state->sleep) != CC_SUCCESS) {
 			cc_log_error("Failed to decode 'sleep'");
 			return false;
 		}
@@ -79,12 +101,12 @@ static cc_result_t cc_actor_counttimer_init(cc_actor_t *actor, cc_list_t *manage
 		}
 	}
 
-	size = cc_coder_sizeof_uint(state->sleep);
+	size = cc_coder_sizeof_double(state->sleep);
 	if (cc_platform_mem_alloc((void **)&data, size) != CC_SUCCESS) {
 		cc_log_error("Failed to allocate memory");
 		return false;
 	}
-	cc_coder_encode_uint(data, state->sleep);
+	cc_coder_encode_double(data, state->sleep);
 
 	if (cc_list_add(&attributes, "period", data, size) == NULL) {
 		cc_log_error("Failed to add 'period'");
@@ -149,7 +171,7 @@ static cc_result_t cc_actor_counttimer_set_state(cc_actor_t *actor, cc_list_t *m
 		return CC_FAIL;
 	}
 
-	if (cc_coder_decode_uint(item->data, &state->sleep) != CC_SUCCESS) {
+	if (cc_actor_counttimer_decode_sleep(item->data, &state->sleep) != CC_SUCCESS) {
 		cc_log_error("Failed to decode 'sleep'");
 		return false;
 	}
@@ -209,12 +231,12 @@ static bool cc_actor_counttimer_step_no_periodic(struct cc_actor_t *actor)
   if (state->count == state->start + 2) {
     cc_calvinsys_close(actor->calvinsys, state->timer);
 
-		size = cc_coder_sizeof_uint(state->sleep);
+		size = cc_coder_sizeof_double(state->sleep);
 	  if (cc_platform_mem_alloc((void **)&data, size) != CC_SUCCESS) {
 	    cc_log_error("Failed to allocate memory");
 	    return false;
 	  }
-	  cc_coder_encode_uint(data, state->sleep);
+	  cc_coder_encode_double(data, state->sleep);
     if (cc_list_add(&attributes, "period", data, size) == NULL) {
       cc_log_error("Failed to add 'period'");
       return CC_FAIL;
@@ -241,12 +263,12 @@ static bool cc_actor_counttimer_step_no_periodic(struct cc_actor_t *actor)
     return false;
   }
 
-	size = cc_coder_sizeof_uint(state->sleep);
+	size = cc_coder_sizeof_double(state->sleep);
 	if (cc_platform_mem_alloc((void **)&data, size) != CC_SUCCESS) {
 		cc_log_error("Failed to allocate memory");
 		return false;
 	}
-	cc_coder_encode_uint(data, state->sleep);
+	cc_coder_encode_double(data, state->sleep);
 
   if (cc_calvinsys_write(actor->calvinsys, state->timer, data, size) != CC_SUCCESS)
     cc_log_debug("Failed to set timer %s", state->timer);
@@ -347,12 +369,12 @@ static cc_result_t cc_actor_counttimer_get_attributes(cc_actor_t *actor, cc_list
 		return CC_FAIL;
 	}
 
-	size = cc_coder_sizeof_uint(state->sleep);
+	size = cc_coder_sizeof_double(state->sleep);
 	if (cc_platform_mem_alloc((void **)&data, size) != CC_SUCCESS) {
 		cc_log_error("Failed to allocate memory");
 		return CC_FAIL;
 	}
-	cc_coder_encode_uint(data, state->sleep);
+	cc_coder_encode_double(data, state->sleep);
 
 	if (cc_list_add_n(managed_attributes, "sleep", 5, data, size) == NULL) {
 		cc_log_error("Failed to add 'sleep' to managed attributes");
@@ -65,7 +65,7 @@ static bool cc_actor_identity_fire(struct cc_actor_t *actor)
 		return false;
 
 	token = cc_fifo_peek(inport->fifo);
-	if (cc_fifo_write(outport->fifo, token->value, token->size) != CC_SUCCESS) {
+	if (cc_fifo_write_token(outport->fifo, token) != CC_SUCCESS) {
 		cc_fifo_cancel_commit(inport->fifo);
 		return false;
 	}
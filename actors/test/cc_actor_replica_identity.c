@@ -109,7 +109,7 @@ static bool cc_actor_replica_identity_fire(struct cc_actor_t *actor)
 		return false;
 	}
 
-	cc_fifo_commit_read(inport->fifo, false);
+	cc_fifo_commit_read(inport->fifo, true);
 
 	return true;
 }
@@ -2,10 +2,13 @@ ifdef CONFIG
 CC_CFLAGS += -DCC_CONFIGFILE_H=\""$(CONFIG)\""
 endif
 
+# Actor scheduler, np_scheduler (visit all actors) or rq_scheduler (ready queue)
+SCHEDULER ?= np_scheduler
+
 CC_SRC_C += \
 	cc_api.c \
 	runtime/north/cc_common.c \
-	runtime/north/scheduler/np_scheduler/cc_scheduler.c \
+	runtime/north/scheduler/$(SCHEDULER)/cc_scheduler.c \
 	runtime/north/cc_node.c \
 	runtime/north/cc_proto.c \
 	runtime/north/cc_transport.c \
@@ -18,6 +18,7 @@
 #include "runtime/north/cc_common.h"
 #include "runtime/north/coder/cc_coder.h"
 #include "runtime/north/cc_actor.h"
+#include "runtime/north/scheduler/cc_scheduler.h"
 #include "runtime/south/platform/cc_platform.h"
 #include "cc_calvinsys.h"
 
@@ -31,13 +32,6 @@ cc_result_t cc_calvinsys_init(cc_node_t *node)
 	memset(node->calvinsys, 0, sizeof(cc_calvinsys_t));
 	node->calvinsys->node = node;
 
-#if CC_USE_FDS
-	int i = 0;
-	for (i = 0; i < CC_CALVINSYS_MAX_FDS; i++) {
-		node->calvinsys->fds[i] = -1;
-	}
-#endif
-
 	return CC_SUCCESS;
 }
 
@@ -119,6 +113,18 @@ void cc_calvinsys_delete_capability(cc_calvinsys_t *calvinsys, const char *name)
 	}
 }
 
+static void cc_calvinsys_set_polled(cc_calvinsys_t *calvinsys, cc_calvinsys_obj_t *obj, bool polled)
+{
+	if (obj->polled == polled)
+		return;
+
+	obj->polled = polled;
+	if (polled)
+		calvinsys->nbr_polled++;
+	else
+		calvinsys->nbr_polled--;
+}
+
 char *cc_calvinsys_open(cc_actor_t *actor, const char *name, cc_list_t *kwargs)
 {
 	cc_calvinsys_capability_t *capability = NULL;
@@ -192,6 +198,7 @@ char *cc_calvinsys_open(cc_actor_t *actor, const char *name, cc_list_t *kwargs)
 		return NULL;
 	}
 
+	cc_calvinsys_set_polled(actor->calvinsys, obj, obj->can_read != NULL && !obj->evented);
 	cc_log("calvinsys: Opened '%s', capability '%s'", item->id, name);
 
 	return item->id;
@@ -242,6 +249,23 @@ bool cc_calvinsys_can_read(cc_calvinsys_t *calvinsys, char *id)
 	return false;
 }
 
+// Marks the actors of polled objects that can be read as ready, evented objects ready their actors when triggered
+void cc_calvinsys_ready_polled(cc_calvinsys_t *calvinsys)
+{
+	cc_list_t *item = calvinsys->objects;
+	cc_calvinsys_obj_t *obj = NULL;
+
+	if (calvinsys->nbr_polled == 0)
+		return;
+
+	while (item != NULL) {
+		obj = (cc_calvinsys_obj_t *)item->data;
+		if (obj->polled && !obj->actor->ready && obj->can_read(obj))
+			cc_scheduler_actor_ready(calvinsys->node, obj->actor);
+		item = item->next;
+	}
+}
+
 cc_result_t cc_calvinsys_read(cc_calvinsys_t *calvinsys, char *id, char **data, size_t *data_size)
 {
 	cc_calvinsys_obj_t *obj = NULL;
@@ -257,6 +281,96 @@ cc_result_t cc_calvinsys_read(cc_calvinsys_t *calvinsys, char *id, char **data,
 	return CC_FAIL;
 }
 
+#if CC_USE_FDS
+static cc_result_t cc_calvinsys_handle_event(cc_node_t *node, int fd, uint32_t events, void *data)
+{
+	cc_calvinsys_event_source_t *source = (cc_calvinsys_event_source_t *)data;
+
+	// failures are the object's, not the platform's
+	if (source->handler != NULL && source->handler(source->obj, fd, events) != CC_SUCCESS)
+		cc_log_error("Failed to handle event on '%d'", fd);
+
+	if (source->obj != NULL)
+		cc_scheduler_actor_ready(node, source->obj->actor);
+	else
+		cc_scheduler_all_ready(node);
+
+	return CC_SUCCESS;
+}
+
+cc_result_t cc_calvinsys_add_event_source(cc_calvinsys_t *calvinsys, cc_calvinsys_obj_t *obj, int fd, uint32_t events, cc_result_t (*handler)(cc_calvinsys_obj_t *obj, int fd, uint32_t events))
+{
+	cc_calvinsys_event_source_t *source = NULL;
+
+	if (cc_platform_mem_alloc((void **)&source, sizeof(cc_calvinsys_event_source_t)) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return CC_FAIL;
+	}
+
+	source->fd = fd;
+	source->obj = obj;
+	source->handler = handler;
+
+	if (cc_platform_add_event_source(calvinsys->node, fd, events, cc_calvinsys_handle_event, source) != CC_SUCCESS) {
+		cc_log_error("Failed to add event source '%d'", fd);
+		cc_platform_mem_free(source);
+		return CC_FAIL;
+	}
+
+	source->next = calvinsys->event_sources;
+	calvinsys->event_sources = source;
+	if (obj != NULL) {
+		obj->evented = true;
+		cc_calvinsys_set_polled(calvinsys, obj, false);
+	}
+
+	return CC_SUCCESS;
+}
+
+cc_result_t cc_calvinsys_modify_event_source(cc_calvinsys_t *calvinsys, int fd, uint32_t events)
+{
+	return cc_platform_modify_event_source(calvinsys->node, fd, events);
+}
+
+void cc_calvinsys_remove_event_source(cc_calvinsys_t *calvinsys, int fd)
+{
+	cc_calvinsys_event_source_t **source = &calvinsys->event_sources, *tmp = NULL;
+
+	while (*source != NULL) {
+		if ((*source)->fd == fd) {
+			tmp = *source;
+			*source = tmp->next;
+			cc_platform_remove_event_source(calvinsys->node, fd);
+			cc_platform_mem_free(tmp);
+			return;
+		}
+		source = &(*source)->next;
+	}
+}
+
+// Sources left by a closed object would wake a freed object
+static void cc_calvinsys_remove_object_event_sources(cc_calvinsys_t *calvinsys, cc_calvinsys_obj_t *obj)
+{
+	cc_calvinsys_event_source_t **source = &calvinsys->event_sources, *tmp = NULL;
+
+	while (*source != NULL) {
+		if ((*source)->obj == obj) {
+			tmp = *source;
+			*source = tmp->next;
+			cc_platform_remove_event_source(calvinsys->node, tmp->fd);
+			cc_platform_mem_free(tmp);
+		} else
+			source = &(*source)->next;
+	}
+}
+
+void cc_calvinsys_remove_event_sources(cc_calvinsys_t *calvinsys)
+{
+	while (calvinsys->event_sources != NULL)
+		cc_calvinsys_remove_event_source(calvinsys, calvinsys->event_sources->fd);
+}
+#endif
+
 void cc_calvinsys_close(cc_calvinsys_t *calvinsys, char *id)
 {
 	cc_calvinsys_obj_t *obj = NULL;
@@ -267,6 +381,10 @@ void cc_calvinsys_close(cc_calvinsys_t *calvinsys, char *id)
 		obj = (cc_calvinsys_obj_t *)item->data;
 		if (obj->close != NULL)
 			obj->close(obj);
+		cc_calvinsys_set_polled(calvinsys, obj, false);
+#if CC_USE_FDS
+		cc_calvinsys_remove_object_event_sources(calvinsys, obj);
+#endif
 		cc_log("calvinsys: Closed '%s'", id);
 		cc_list_remove(&calvinsys->objects, id);
 		cc_platform_mem_free((void *)obj);
@@ -289,35 +407,52 @@ static uint32_t cc_calvinsys_get_number_of_attributes(cc_calvinsys_t *calvinsys,
 	return items;
 }
 
-cc_result_t cc_calvinsys_get_attributes(cc_calvinsys_t *calvinsys, cc_actor_t *actor, cc_list_t **private_attributes)
+// Must be kept in line with cc_calvinsys_get_attributes, 0 if an object can't be sized
+static size_t cc_calvinsys_get_attributes_size(cc_calvinsys_t *calvinsys, cc_actor_t *actor, uint32_t nbr_of_items)
 {
 	cc_list_t *item = calvinsys->objects;
 	cc_calvinsys_obj_t *obj = NULL;
-	uint32_t nbr_of_items = cc_calvinsys_get_number_of_attributes(calvinsys, actor);
-	char *buffer = NULL, *w = NULL, *w_obj = NULL;
+	size_t size = cc_coder_sizeof_map(nbr_of_items), obj_size = 0;
+	size_t empty_obj_size = cc_coder_sizeof_key("obj") + cc_coder_sizeof_map(0);
 
-	if (nbr_of_items == 0) {
-		if (cc_platform_mem_alloc((void **)&buffer, 10) != CC_SUCCESS) {
-			cc_log_error("Failed to allocate memory");
-			return CC_FAIL;
+	while (item != NULL) {
+		obj = (cc_calvinsys_obj_t *)item->data;
+		if (actor == obj->actor) {
+			size += cc_coder_sizeof_key(item->id) + cc_coder_sizeof_map(3);
+			size += cc_coder_sizeof_key("name") + cc_coder_sizeof_str(strlen(obj->capability->name));
+			obj_size = empty_obj_size;
+			if (obj->serialize != NULL) {
+				if (obj->get_serialized_size == NULL) {
+					cc_log_error("Calvinsys object '%s' can't be sized", item->id);
+					return 0;
+				}
+				// a failing serialize encodes an empty object
+				obj_size = obj->get_serialized_size(item->id, obj);
+				if (obj_size < empty_obj_size)
+					obj_size = empty_obj_size;
+			}
+			size += obj_size;
+			size += cc_coder_sizeof_key("args") + cc_coder_sizeof_map(0);
 		}
+		item = item->next;
+	}
 
-		w = buffer;
-		w = cc_coder_encode_map(w, 0);
-
-		if (cc_list_add_n(private_attributes, "_calvinsys", 10, buffer, w - buffer) == NULL) {
-			cc_log_error("Failed to add '_calvinsys'");
-			cc_platform_mem_free((void *)buffer);
-			return CC_FAIL;
-		}
+	return size;
+}
 
-		cc_log("Serialized empty calvinsys");
+cc_result_t cc_calvinsys_get_attributes(cc_calvinsys_t *calvinsys, cc_actor_t *actor, cc_list_t **private_attributes)
+{
+	cc_list_t *item = calvinsys->objects;
+	cc_calvinsys_obj_t *obj = NULL;
+	uint32_t nbr_of_items = cc_calvinsys_get_number_of_attributes(calvinsys, actor);
+	char *buffer = NULL, *w = NULL, *w_obj = NULL;
+	// every object is sized before it is serialized and serialize writes no more than that
+	size_t size = cc_calvinsys_get_attributes_size(calvinsys, actor, nbr_of_items);
 
-		return CC_SUCCESS;
-	}
+	if (size == 0)
+		return CC_FAIL;
 
-	// TODO: set a better size
-	if (cc_platform_mem_alloc((void **)&buffer, nbr_of_items * 200) != CC_SUCCESS) {
+	if (cc_platform_mem_alloc((void **)&buffer, size) != CC_SUCCESS) {
 		cc_log_error("Failed to allocate memory");
 		return CC_FAIL;
 	}
@@ -351,6 +486,9 @@ cc_result_t cc_calvinsys_get_attributes(cc_calvinsys_t *calvinsys, cc_actor_t *a
 		return CC_FAIL;
 	}
 
+	if (nbr_of_items == 0)
+		cc_log("Serialized empty calvinsys");
+
 	return CC_SUCCESS;
 }
 
@@ -435,9 +573,10 @@ cc_result_t cc_calvinsys_deserialize(struct cc_actor_t *actor, char *buffer)
 		}
 
 		if (result == CC_SUCCESS) {
-			if (capability->deserialize(obj, kwargs) == CC_SUCCESS)
+			if (capability->deserialize(obj, kwargs) == CC_SUCCESS) {
+				cc_calvinsys_set_polled(actor->calvinsys, obj, obj->can_read != NULL && !obj->evented);
 				cc_log("calvinsys: Deserialized '%s', capability '%s'", item->id, capability->name);
-			else {
+			} else {
 				cc_log_error("Failed to deserialize '%s'", capability->name);
 				result = CC_FAIL;
 			}
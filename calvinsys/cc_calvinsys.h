@@ -26,7 +26,10 @@ typedef struct cc_calvinsys_obj_t {
 	cc_result_t (*read)(struct cc_calvinsys_obj_t *obj, char **data, size_t *data_size);
 	cc_result_t (*close)(struct cc_calvinsys_obj_t *obj);
 	char *(*serialize)(char *id, struct cc_calvinsys_obj_t *obj, char *buffer);
+	size_t (*get_serialized_size)(char *id, struct cc_calvinsys_obj_t *obj); // size of what the next serialize call encodes
 	void *state;
+	bool evented; // the actor is woken when the object is ready, can_read is not polled
+	bool polled; // opened without events, counted in nbr_polled
 	char *id;
 	struct cc_actor_t *actor;
 	struct cc_calvinsys_capability_t *capability;
@@ -42,12 +45,25 @@ typedef struct cc_calvinsys_capability_t {
 	char *python_module;
 } cc_calvinsys_capability_t;
 
+#if CC_USE_FDS
+// A descriptor waited for by the platform, readiness calls handler and wakes
+// the actor owning obj or all actors if obj is NULL
+typedef struct cc_calvinsys_event_source_t {
+	int fd;
+	cc_calvinsys_obj_t *obj;
+	cc_result_t (*handler)(cc_calvinsys_obj_t *obj, int fd, uint32_t events);
+	struct cc_calvinsys_event_source_t *next;
+} cc_calvinsys_event_source_t;
+#endif
+
 typedef struct cc_calvinsys_t {
 	cc_list_t *capabilities;
 	cc_list_t *objects;
 	struct cc_node_t *node;
+	struct cc_calvinsys_timer_heap_t *timer_heap; // armed sys.timer objects
+	uint32_t nbr_polled; // objects only ready when polled with can_read
 #if CC_USE_FDS
-	int fds[CC_CALVINSYS_MAX_FDS];
+	cc_calvinsys_event_source_t *event_sources;
 #endif
 } cc_calvinsys_t;
 
@@ -61,7 +77,14 @@ cc_result_t cc_calvinsys_write(cc_calvinsys_t *calvinsys, char *id, char *data,
 bool cc_calvinsys_can_read(cc_calvinsys_t *calvinsys, char *id);
 cc_result_t cc_calvinsys_read(cc_calvinsys_t *calvinsys, char *id, char **data, size_t *data_size);
 void cc_calvinsys_close(cc_calvinsys_t *calvinsys, char *id);
+void cc_calvinsys_ready_polled(cc_calvinsys_t *calvinsys);
 cc_result_t cc_calvinsys_get_attributes(cc_calvinsys_t *calvinsys, struct cc_actor_t *actor, cc_list_t **private_attributes);
 cc_result_t cc_calvinsys_deserialize(struct cc_actor_t *actor, char *buffer);
+#if CC_USE_FDS
+cc_result_t cc_calvinsys_add_event_source(cc_calvinsys_t *calvinsys, cc_calvinsys_obj_t *obj, int fd, uint32_t events, cc_result_t (*handler)(cc_calvinsys_obj_t *obj, int fd, uint32_t events));
+cc_result_t cc_calvinsys_modify_event_source(cc_calvinsys_t *calvinsys, int fd, uint32_t events);
+void cc_calvinsys_remove_event_source(cc_calvinsys_t *calvinsys, int fd);
+void cc_calvinsys_remove_event_sources(cc_calvinsys_t *calvinsys);
+#endif
 
 #endif /* CC_CALVINSYS_H */
@@ -199,6 +199,15 @@ static char *cc_calvinsys_attribute_serialize(char *id, cc_calvinsys_obj_t *obj,
 	return buffer;
 }
 
+static size_t cc_calvinsys_attribute_get_serialized_size(char *id, cc_calvinsys_obj_t *obj)
+{
+	cc_calvinsys_attribute_t *state = (cc_calvinsys_attribute_t *)obj->state;
+
+	return cc_coder_sizeof_key("obj") + cc_coder_sizeof_map(2) +
+		cc_coder_sizeof_key("type") + cc_coder_sizeof_str(7) +
+		cc_coder_sizeof_key("attribute") + cc_coder_sizeof_str(strlen(state->attribute_name));
+}
+
 static cc_result_t cc_calvinsys_attribute_open(cc_calvinsys_obj_t *obj, cc_list_t *kwargs)
 {
 	cc_calvinsys_attribute_t *attribute = NULL;
@@ -215,6 +224,7 @@ static cc_result_t cc_calvinsys_attribute_open(cc_calvinsys_obj_t *obj, cc_list_
 	obj->read = cc_calvinsys_attribute_read;
 	obj->close = cc_calvinsys_attribute_close;
 	obj->serialize = cc_calvinsys_attribute_serialize;
+	obj->get_serialized_size = cc_calvinsys_attribute_get_serialized_size;
 	obj->state = attribute;
 
 	return CC_SUCCESS;
@@ -297,6 +307,7 @@ cc_result_t cc_calvinsys_attribute_deserialize(cc_calvinsys_obj_t *obj, cc_list_
 	obj->read = cc_calvinsys_attribute_read;
 	obj->close = cc_calvinsys_attribute_close;
 	obj->serialize = cc_calvinsys_attribute_serialize;
+	obj->get_serialized_size = cc_calvinsys_attribute_get_serialized_size;
 	obj->state = state;
 
 	cc_log_debug("Attribute deserialized, name '%s'", state->attribute_name);
@@ -17,12 +17,150 @@
 #include "cc_calvinsys_timer.h"
 #include "runtime/north/cc_common.h"
 #include "runtime/north/cc_node.h"
+#include "runtime/north/scheduler/cc_scheduler.h"
 #include "runtime/north/coder/cc_coder.h"
 
-static void cc_calvinsys_timer_set(cc_node_t *node, cc_calvinsys_timer_t *timer, uint32_t timeout)
+#define CC_TIMER_HEAP_INITIAL_SIZE 8
+
+static uint64_t cc_calvinsys_timer_heap_key(cc_calvinsys_timer_heap_t *heap, uint32_t index)
+{
+	return ((cc_calvinsys_timer_t *)heap->objs[index]->state)->next_time;
+}
+
+static void cc_calvinsys_timer_heap_place(cc_calvinsys_timer_heap_t *heap, uint32_t index, cc_calvinsys_obj_t *obj)
+{
+	heap->objs[index] = obj;
+	((cc_calvinsys_timer_t *)obj->state)->heap_index = index;
+}
+
+static void cc_calvinsys_timer_heap_sift_up(cc_calvinsys_timer_heap_t *heap, uint32_t index)
+{
+	cc_calvinsys_obj_t *obj = heap->objs[index];
+	uint64_t key = ((cc_calvinsys_timer_t *)obj->state)->next_time;
+	uint32_t parent = 0;
+
+	while (index > 0) {
+		parent = (index - 1) / 2;
+		if (cc_calvinsys_timer_heap_key(heap, parent) <= key)
+			break;
+		cc_calvinsys_timer_heap_place(heap, index, heap->objs[parent]);
+		index = parent;
+	}
+	cc_calvinsys_timer_heap_place(heap, index, obj);
+}
+
+static void cc_calvinsys_timer_heap_sift_down(cc_calvinsys_timer_heap_t *heap, uint32_t index)
+{
+	cc_calvinsys_obj_t *obj = heap->objs[index];
+	uint64_t key = ((cc_calvinsys_timer_t *)obj->state)->next_time;
+	uint32_t child = 0;
+
+	while ((child = 2 * index + 1) < heap->count) {
+		if (child + 1 < heap->count && cc_calvinsys_timer_heap_key(heap, child + 1) < cc_calvinsys_timer_heap_key(heap, child))
+			child++;
+		if (key <= cc_calvinsys_timer_heap_key(heap, child))
+			break;
+		cc_calvinsys_timer_heap_place(heap, index, heap->objs[child]);
+		index = child;
+	}
+	cc_calvinsys_timer_heap_place(heap, index, obj);
+}
+
+static cc_result_t cc_calvinsys_timer_heap_add(cc_calvinsys_timer_heap_t *heap, cc_calvinsys_obj_t *obj)
+{
+	cc_calvinsys_obj_t **objs = NULL;
+	uint32_t size = 0;
+
+	if (heap->count == heap->size) {
+		size = heap->size == 0 ? CC_TIMER_HEAP_INITIAL_SIZE : heap->size * 2;
+		if (cc_platform_mem_alloc((void **)&objs, size * sizeof(cc_calvinsys_obj_t *)) != CC_SUCCESS) {
+			cc_log_error("Failed to allocate memory");
+			return CC_FAIL;
+		}
+		if (heap->objs != NULL) {
+			memcpy(objs, heap->objs, heap->count * sizeof(cc_calvinsys_obj_t *));
+			cc_platform_mem_free((void *)heap->objs);
+		}
+		heap->objs = objs;
+		heap->size = size;
+	}
+
+	heap->objs[heap->count] = obj;
+	heap->count++;
+	cc_calvinsys_timer_heap_sift_up(heap, heap->count - 1);
+
+	return CC_SUCCESS;
+}
+
+static void cc_calvinsys_timer_heap_remove(cc_calvinsys_timer_heap_t *heap, uint32_t index)
 {
-	timer->armed = true;
-	timer->next_time = cc_node_get_time(node) + timeout;
+	heap->count--;
+	if (index == heap->count)
+		return;
+
+	cc_calvinsys_timer_heap_place(heap, index, heap->objs[heap->count]);
+	if (index > 0 && cc_calvinsys_timer_heap_key(heap, index) < cc_calvinsys_timer_heap_key(heap, (index - 1) / 2))
+		cc_calvinsys_timer_heap_sift_up(heap, index);
+	else
+		cc_calvinsys_timer_heap_sift_down(heap, index);
+}
+
+static void cc_calvinsys_timer_set(cc_calvinsys_obj_t *obj, uint32_t timeout)
+{
+	cc_calvinsys_timer_heap_t *heap = obj->capability->calvinsys->timer_heap;
+	cc_calvinsys_timer_t *timer = (cc_calvinsys_timer_t *)obj->state;
+
+	timer->next_time = cc_node_get_time_ms(obj->capability->calvinsys->node) + timeout;
+	if (timer->armed) {
+		cc_calvinsys_timer_heap_remove(heap, timer->heap_index);
+		timer->armed = false;
+	}
+
+	if (cc_calvinsys_timer_heap_add(heap, obj) == CC_SUCCESS)
+		timer->armed = true;
+	else
+		cc_log_error("Failed to arm timer '%s'", obj->id);
+}
+
+// Decodes a time in seconds (uint or float) to milliseconds
+static cc_result_t cc_calvinsys_timer_decode_ms(char *data, uint64_t *ms)
+{
+	uint32_t seconds = 0;
+	float f = 0;
+	double d = 0;
+
+	switch (cc_coder_type_of(data)) {
+	case CC_CODER_FLOAT:
+		if (cc_coder_decode_float(data, &f) != CC_SUCCESS)
+			return CC_FAIL;
+		*ms = f > 0 ? (uint64_t)(f * 1000) : 0;
+		return CC_SUCCESS;
+	case CC_CODER_DOUBLE:
+		if (cc_coder_decode_double(data, &d) != CC_SUCCESS)
+			return CC_FAIL;
+		*ms = d > 0 ? (uint64_t)(d * 1000) : 0;
+		return CC_SUCCESS;
+	default:
+		if (cc_coder_decode_uint(data, &seconds) != CC_SUCCESS)
+			return CC_FAIL;
+		*ms = (uint64_t)seconds * 1000;
+		return CC_SUCCESS;
+	}
+}
+
+// Encodes a time in milliseconds as seconds, as float if not whole seconds
+static char *cc_calvinsys_timer_encode_kv_ms(char *buffer, const char *key, uint64_t ms)
+{
+	if (ms % 1000 == 0)
+		return cc_coder_encode_kv_uint(buffer, key, (uint32_t)(ms / 1000));
+	return cc_coder_encode_kv_double(buffer, key, (double)ms / 1000);
+}
+
+static size_t cc_calvinsys_timer_sizeof_kv_ms(const char *key, uint64_t ms)
+{
+	if (ms % 1000 == 0)
+		return cc_coder_sizeof_key(key) + cc_coder_sizeof_uint((uint32_t)(ms / 1000));
+	return cc_coder_sizeof_key(key) + cc_coder_sizeof_double((double)ms / 1000);
 }
 
 static bool cc_calvinsys_timer_can_read(struct cc_calvinsys_obj_t *obj)
@@ -38,7 +176,7 @@ static cc_result_t cc_calvinsys_timer_read(struct cc_calvinsys_obj_t *obj, char
 
 	timer->triggered = false;
 	if (timer->repeats)
-		cc_calvinsys_timer_set(obj->capability->calvinsys->node, timer, timer->timeout);
+		cc_calvinsys_timer_set(obj, timer->timeout);
 
 	return CC_SUCCESS;
 }
@@ -53,25 +191,29 @@ static bool cc_calvinsys_timer_can_write(struct cc_calvinsys_obj_t *obj)
 static cc_result_t cc_calvinsys_timer_write(struct cc_calvinsys_obj_t *obj, char *data, size_t size)
 {
 	cc_calvinsys_timer_t *timer = (cc_calvinsys_timer_t *)obj->state;
-	uint32_t timeout = 0;
+	uint64_t timeout = 0;
 
 	if (!cc_calvinsys_timer_can_write(obj))
 		return CC_FAIL;
 
-	if (cc_coder_decode_uint(data, &timeout) != CC_SUCCESS) {
-		cc_log_error("Failed to decode value as uint");
+	if (cc_calvinsys_timer_decode_ms(data, &timeout) != CC_SUCCESS) {
+		cc_log_error("Failed to decode timeout");
 		return CC_FAIL;
 	}
 
-	timer->timeout = timeout;
-	cc_calvinsys_timer_set(obj->capability->calvinsys->node, timer, timer->timeout);
+	timer->timeout = (uint32_t)timeout;
+	cc_calvinsys_timer_set(obj, timer->timeout);
 
 	return CC_SUCCESS;
 }
 
 static cc_result_t cc_calvinsys_timer_close(struct cc_calvinsys_obj_t *obj)
 {
+	cc_calvinsys_timer_t *timer = (cc_calvinsys_timer_t *)obj->state;
+
 	cc_log("Timer '%s' closed.", obj->id);
+	if (timer->armed)
+		cc_calvinsys_timer_heap_remove(obj->capability->calvinsys->timer_heap, timer->heap_index);
 	cc_platform_mem_free((void *)obj->state);
 	return CC_SUCCESS;
 }
@@ -83,22 +225,39 @@ static char *cc_calvinsys_timer_serialize(char *id, cc_calvinsys_obj_t *obj, cha
 	buffer = cc_coder_encode_kv_map(buffer, "obj", 4);
 	{
 		if (timer->armed)
-			buffer = cc_coder_encode_kv_uint(buffer, "nexttrigger", timer->next_time);
+			buffer = cc_calvinsys_timer_encode_kv_ms(buffer, "nexttrigger", timer->next_time);
 		else
 			buffer = cc_coder_encode_kv_nil(buffer, "nexttrigger");
 		buffer = cc_coder_encode_kv_bool(buffer, "repeats", timer->repeats);
-		buffer = cc_coder_encode_kv_uint(buffer, "timeout", timer->timeout);
+		buffer = cc_calvinsys_timer_encode_kv_ms(buffer, "timeout", timer->timeout);
 		buffer = cc_coder_encode_kv_bool(buffer, "triggered", timer->triggered);
 	}
 
 	return buffer;
 }
 
+// Must be kept in line with cc_calvinsys_timer_serialize
+static size_t cc_calvinsys_timer_get_serialized_size(char *id, cc_calvinsys_obj_t *obj)
+{
+	cc_calvinsys_timer_t *timer = (cc_calvinsys_timer_t *)obj->state;
+	size_t size = cc_coder_sizeof_key("obj") + cc_coder_sizeof_map(4);
+
+	if (timer->armed)
+		size += cc_calvinsys_timer_sizeof_kv_ms("nexttrigger", timer->next_time);
+	else
+		size += cc_coder_sizeof_key("nexttrigger") + cc_coder_sizeof_nil();
+	size += cc_coder_sizeof_key("repeats") + cc_coder_sizeof_bool(timer->repeats);
+	size += cc_calvinsys_timer_sizeof_kv_ms("timeout", timer->timeout);
+	size += cc_coder_sizeof_key("triggered") + cc_coder_sizeof_bool(timer->triggered);
+
+	return size;
+}
+
 static cc_result_t cc_calvinsys_timer_open(cc_calvinsys_obj_t *obj, cc_list_t *kwargs)
 {
 	cc_calvinsys_timer_t *timer = NULL;
 	cc_list_t *item = NULL;
-	uint32_t period = 0;
+	uint64_t period = 0;
 
 	if (cc_platform_mem_alloc((void **)&timer, sizeof(cc_calvinsys_timer_t)) != CC_SUCCESS) {
 		cc_log_error("Failed to allocate memory");
@@ -111,17 +270,19 @@ static cc_result_t cc_calvinsys_timer_open(cc_calvinsys_obj_t *obj, cc_list_t *k
 	obj->read = cc_calvinsys_timer_read;
 	obj->close = cc_calvinsys_timer_close;
 	obj->serialize = cc_calvinsys_timer_serialize;
+	obj->evented = true;
+	obj->get_serialized_size = cc_calvinsys_timer_get_serialized_size;
 	obj->state = timer;
 
 	item = cc_list_get(kwargs, "period");
 	if (item != NULL) {
-		if (cc_coder_decode_uint(item->data, &period) != CC_SUCCESS) {
+		if (cc_calvinsys_timer_decode_ms(item->data, &period) != CC_SUCCESS) {
 			cc_log_error("Failed to decode 'period'");
 			return CC_FAIL;
 		}
 	}
 
-	timer->timeout = period;
+	timer->timeout = (uint32_t)period;
 	timer->armed = false;
 	timer->triggered = false;
 	if (strncmp(obj->capability->name, "sys.timer.repeating", 19)  == 0)
@@ -130,9 +291,9 @@ static cc_result_t cc_calvinsys_timer_open(cc_calvinsys_obj_t *obj, cc_list_t *k
 		timer->repeats = false;
 
 	if (period > 0)
-		cc_calvinsys_timer_set(obj->capability->calvinsys->node, timer, timer->timeout);
+		cc_calvinsys_timer_set(obj, timer->timeout);
 
-	cc_log("Timer '%s' created, armed %d timeout '%ld'", obj->id, timer->armed, timer->timeout);
+	cc_log("Timer '%s' created, armed %d timeout '%ld' ms", obj->id, timer->armed, timer->timeout);
 
 	return CC_SUCCESS;
 }
@@ -140,7 +301,7 @@ static cc_result_t cc_calvinsys_timer_open(cc_calvinsys_obj_t *obj, cc_list_t *k
 cc_result_t cc_calvinsys_timer_deserialize(cc_calvinsys_obj_t *obj, cc_list_t *kwargs)
 {
 	cc_calvinsys_timer_t *timer = NULL;
-	uint32_t timeout = 0, nexttrigger = 0;
+	uint64_t timeout = 0, nexttrigger = 0, now = 0;
 	bool repeats = false, triggered = false;
 	cc_coder_type_t type = CC_CODER_UNDEF;
 	cc_list_t *item = NULL;
@@ -151,7 +312,7 @@ cc_result_t cc_calvinsys_timer_deserialize(cc_calvinsys_obj_t *obj, cc_list_t *k
 		return CC_FAIL;
 	}
 
-	if (cc_coder_decode_uint(item->data, &timeout) != CC_SUCCESS) {
+	if (cc_calvinsys_timer_decode_ms(item->data, &timeout) != CC_SUCCESS) {
 		cc_log_error("Failed to decode 'timeout'");
 		return CC_FAIL;
 	}
@@ -185,21 +346,9 @@ cc_result_t cc_calvinsys_timer_deserialize(cc_calvinsys_obj_t *obj, cc_list_t *k
 
 	memset(timer, 0, sizeof(cc_calvinsys_timer_t));
 	timer->triggered = triggered;
-	timer->timeout = timeout;
+	timer->timeout = (uint32_t)timeout;
 	timer->repeats = repeats;
-
-	item = cc_list_get(kwargs, "nexttrigger");
-	if (item != NULL) {
-		type = cc_coder_type_of(item->data);
-		if (type == CC_CODER_UNDEF || type == CC_CODER_NIL)
-			nexttrigger = 0;
-		else if (type == CC_CODER_FLOAT || type == CC_CODER_DOUBLE || type == CC_CODER_UINT)
-			cc_coder_decode_uint(item->data, &nexttrigger);
-		timeout = nexttrigger - cc_node_get_time(obj->capability->calvinsys->node);
-		cc_calvinsys_timer_set(obj->capability->calvinsys->node, timer, timeout);
-	} else {
-		timer->armed = false;
-	}
+	timer->armed = false;
 
 	obj->can_write = cc_calvinsys_timer_can_write;
 	obj->write = cc_calvinsys_timer_write;
@@ -207,22 +356,49 @@ cc_result_t cc_calvinsys_timer_deserialize(cc_calvinsys_obj_t *obj, cc_list_t *k
 	obj->read = cc_calvinsys_timer_read;
 	obj->close = cc_calvinsys_timer_close;
 	obj->serialize = cc_calvinsys_timer_serialize;
+	obj->evented = true;
+	obj->get_serialized_size = cc_calvinsys_timer_get_serialized_size;
 	obj->state = timer;
 
-	cc_log("Timer '%s' deserialized, armed '%d' timeout '%ld'", obj->id, timer->armed, timer->timeout);
+	// nexttrigger is nil if the timer isn't armed
+	item = cc_list_get(kwargs, "nexttrigger");
+	if (item != NULL) {
+		type = cc_coder_type_of(item->data);
+		if (type == CC_CODER_FLOAT || type == CC_CODER_DOUBLE || type == CC_CODER_UINT) {
+			if (cc_calvinsys_timer_decode_ms(item->data, &nexttrigger) != CC_SUCCESS) {
+				cc_log_error("Failed to decode 'nexttrigger'");
+				return CC_FAIL;
+			}
+			now = cc_node_get_time_ms(obj->capability->calvinsys->node);
+			cc_calvinsys_timer_set(obj, nexttrigger > now ? (uint32_t)(nexttrigger - now) : 0);
+		}
+	}
+
+	cc_log("Timer '%s' deserialized, armed '%d' timeout '%ld' ms", obj->id, timer->armed, timer->timeout);
 
 	return CC_SUCCESS;
 }
 
 cc_result_t cc_calvinsys_timer_create(cc_calvinsys_t **calvinsys)
 {
+	cc_calvinsys_timer_heap_t *heap = NULL;
+
+	if (cc_platform_mem_alloc((void **)&heap, sizeof(cc_calvinsys_timer_heap_t)) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return CC_FAIL;
+	}
+	memset(heap, 0, sizeof(cc_calvinsys_timer_heap_t));
+
+	// the heap is shared by both capabilities and freed with cc_calvinsys_timer_free
+	(*calvinsys)->timer_heap = heap;
+
 	if (cc_calvinsys_create_capability(*calvinsys, "sys.timer.once",
 			cc_calvinsys_timer_open,
 			cc_calvinsys_timer_deserialize,
 			NULL,
 			false) != CC_SUCCESS) {
 		cc_log_error("Failed to create 'sys.timer.once'");
-	 	return CC_FAIL;
+		return CC_FAIL;
 	}
 
 	if (cc_calvinsys_create_capability(*calvinsys, "sys.timer.repeating",
@@ -237,27 +413,42 @@ cc_result_t cc_calvinsys_timer_create(cc_calvinsys_t **calvinsys)
 	return CC_SUCCESS;
 }
 
+void cc_calvinsys_timer_free(cc_calvinsys_t *calvinsys)
+{
+	cc_calvinsys_timer_heap_t *heap = calvinsys->timer_heap;
+
+	if (heap != NULL) {
+		if (heap->objs != NULL)
+			cc_platform_mem_free((void *)heap->objs);
+		cc_platform_mem_free((void *)heap);
+		calvinsys->timer_heap = NULL;
+	}
+}
+
 void cc_calvinsys_timers_check(cc_node_t *node, uint32_t *timeout)
 {
-	cc_list_t *list = node->calvinsys->objects;
+	cc_calvinsys_timer_heap_t *heap = node->calvinsys->timer_heap;
 	cc_calvinsys_timer_t *timer = NULL;
 	cc_calvinsys_obj_t *obj = NULL;
-	uint32_t now = cc_node_get_time(node);
-
-	while (list != NULL) {
-		obj = (cc_calvinsys_obj_t *)list->data;
-		if (strncmp(obj->capability->name, "sys.timer", 9) == 0) {
-			timer = (cc_calvinsys_timer_t *)obj->state;
-			if (timer->armed) {
-				if (now >= timer->next_time) {
-					timer->triggered = true;
-					timer->armed = false;
-					*timeout = 0;
-				} else {
-					*timeout = timer->next_time - now;
-				}
-			}
+	uint64_t now = 0;
+
+	if (heap == NULL || heap->count == 0)
+		return;
+
+	now = cc_node_get_time_ms(node);
+
+	while (heap->count > 0) {
+		obj = heap->objs[0];
+		timer = (cc_calvinsys_timer_t *)obj->state;
+		if (now < timer->next_time) {
+			if (timer->next_time - now < *timeout)
+				*timeout = (uint32_t)(timer->next_time - now);
+			break;
 		}
-		list = list->next;
+		cc_calvinsys_timer_heap_remove(heap, 0);
+		timer->triggered = true;
+		timer->armed = false;
+		*timeout = 0;
+		cc_scheduler_actor_ready(node, obj->actor);
 	}
 }
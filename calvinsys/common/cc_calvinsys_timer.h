@@ -22,23 +22,40 @@
 #include "calvinsys/cc_calvinsys.h"
 
 typedef struct cc_calvinsys_timer_t {
-	uint32_t timeout;
+	uint32_t timeout; // ms
 	bool armed;
-  uint32_t next_time;
+	uint64_t next_time; // ms since epoch
 	bool repeats;
 	bool triggered;
+	uint32_t heap_index; // position in the timer heap when armed
 } cc_calvinsys_timer_t;
 
+// Min-heap, ordered on next_time, of armed timers shared by the sys.timer capabilities
+typedef struct cc_calvinsys_timer_heap_t {
+	cc_calvinsys_obj_t **objs;
+	uint32_t count;
+	uint32_t size;
+} cc_calvinsys_timer_heap_t;
+
 /**
  * cc_calvinsys_timer_create() - Create calvinsys timer objects
  * @calvinsys Calvinsys object
  */
 
 cc_result_t cc_calvinsys_timer_create(cc_calvinsys_t **calvinsys);
+
+/**
+ * cc_calvinsys_timer_free() - Free the timer heap
+ * @calvinsys Calvinsys object
+ *
+ * Called before the timer capabilities are deleted.
+ */
+void cc_calvinsys_timer_free(cc_calvinsys_t *calvinsys);
+
 /**
  * cc_calvinsys_timers_check() - Updates timers and gets next timeout
  * @node the node object
- * @timeout timeout value for next timer
+ * @timeout in: max timeout (ms), out: time (ms) until the next timer expires
  */
 void cc_calvinsys_timers_check(struct cc_node_t *node, uint32_t *timeout);
 
@@ -18,11 +18,29 @@
 #include "cc_config.h"
 #include "cc_api.h"
 #include "errno.h"
+#if CC_USE_NODE_THREADS
+#include <pthread.h>
+#endif
 #if (CC_USE_PYTHON == 1)
 #include "libmpy/cc_mpy_port.h"
 #endif
 
-cc_result_t cc_api_runtime_init(cc_node_t **node, const char *attributes, const char *uris, const char *platform_args)
+#if CC_USE_NODE_THREADS
+struct cc_api_node_thread_t {
+	pthread_t thread;
+	cc_node_t *node;
+	char *script;
+	char *state_file;
+	volatile bool stop;
+};
+
+#if CC_USE_PYTHON
+// MicroPython keeps its state in globals, only one node can run Python
+static int cc_api_python_nodes;
+#endif
+#endif
+
+static cc_result_t cc_api_node_init(cc_node_t **node, const char *attributes, const char *uris, const char *platform_args, const char *state_file)
 {
 	cc_platform_early_init();
 
@@ -31,6 +49,9 @@ cc_result_t cc_api_runtime_init(cc_node_t **node, const char *attributes, const
 		return CC_FAIL;
 	}
 	memset(*node, 0, sizeof(cc_node_t));
+#if CC_USE_STORAGE
+	(*node)->state_file = state_file;
+#endif
 
 #if (CC_USE_PYTHON == 1)
 	// MicroPython is deinitialized and its heap is freed in node_free
@@ -64,6 +85,11 @@ cc_result_t cc_api_runtime_init(cc_node_t **node, const char *attributes, const
 	return CC_SUCCESS;
 }
 
+cc_result_t cc_api_runtime_init(cc_node_t **node, const char *attributes, const char *uris, const char *platform_args)
+{
+	return cc_api_node_init(node, attributes, uris, platform_args, NULL);
+}
+
 cc_result_t cc_api_runtime_start(cc_node_t *node, const char *script)
 {
 	cc_node_run(node, script);
@@ -88,7 +114,11 @@ cc_result_t cc_api_runtime_serialize_and_stop(cc_node_t *node)
 #if (CC_USE_STORAGE == 1)
 cc_result_t cc_api_clear_serialization_file(char *filedir)
 {
-	char abs_filepath[strlen(CC_STATE_FILE) + strlen(filedir) + 1];
+#if CC_USE_CHECKPOINTING
+	char abs_filepath[strlen(CC_STATE_FILE) + strlen(filedir) + sizeof(CC_NODE_JOURNAL_SUFFIX) + 1];
+#else
+	char abs_filepath[strlen(CC_STATE_FILE) + strlen(filedir) + 2];
+#endif
 
 	strcpy(abs_filepath, filedir);
 	if (filedir[strlen(filedir) - 1] != '/')
@@ -96,6 +126,10 @@ cc_result_t cc_api_clear_serialization_file(char *filedir)
 	strcat(abs_filepath, CC_STATE_FILE);
 	if (unlink(abs_filepath) < 0)
 		return CC_FAIL;
+#if CC_USE_CHECKPOINTING
+	strcat(abs_filepath, CC_NODE_JOURNAL_SUFFIX);
+	unlink(abs_filepath);
+#endif
 	return CC_SUCCESS;
 }
 #endif
@@ -106,3 +140,104 @@ cc_result_t cc_api_reconnect(cc_node_t *node)
 		node->transport_client->state = CC_TRANSPORT_INTERFACE_DOWN;
 	return CC_SUCCESS;
 }
+
+#if CC_USE_NODE_THREADS
+static char *cc_api_strdup(const char *str)
+{
+	char *copy = NULL;
+
+	if (str == NULL)
+		return NULL;
+
+	if (cc_platform_mem_alloc((void **)&copy, strlen(str) + 1) != CC_SUCCESS)
+		return NULL;
+	strcpy(copy, str);
+
+	return copy;
+}
+
+static void cc_api_node_thread_free(cc_api_node_thread_t *thread)
+{
+	if (thread->script != NULL)
+		cc_platform_mem_free(thread->script);
+	if (thread->state_file != NULL)
+		cc_platform_mem_free(thread->state_file);
+	cc_platform_mem_free(thread);
+}
+
+static void *cc_api_node_thread_run(void *arg)
+{
+	cc_api_node_thread_t *thread = (cc_api_node_thread_t *)arg;
+
+	// the node is freed when it stops
+	cc_node_run(thread->node, thread->script);
+	thread->node = NULL;
+
+	return NULL;
+}
+
+cc_result_t cc_api_node_spawn(cc_api_node_thread_t **thread, const char *attributes, const char *uris, const char *platform_args, const char *script, const char *state_file)
+{
+	cc_api_node_thread_t *tmp = NULL;
+
+#if CC_USE_PYTHON
+	if (!__sync_bool_compare_and_swap(&cc_api_python_nodes, 0, 1)) {
+		cc_log_error("Only one node can run Python");
+		return CC_FAIL;
+	}
+#endif
+
+	if (cc_platform_mem_alloc((void **)&tmp, sizeof(cc_api_node_thread_t)) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+#if CC_USE_PYTHON
+		cc_api_python_nodes = 0;
+#endif
+		return CC_FAIL;
+	}
+	memset(tmp, 0, sizeof(cc_api_node_thread_t));
+
+	tmp->script = cc_api_strdup(script);
+	tmp->state_file = cc_api_strdup(state_file);
+
+	// a node failing init is not freed, as with cc_api_runtime_init
+	if ((script != NULL && tmp->script == NULL) || (state_file != NULL && tmp->state_file == NULL))
+		cc_log_error("Failed to allocate memory");
+	else if (cc_api_node_init(&tmp->node, attributes, uris, platform_args, tmp->state_file) != CC_SUCCESS)
+		cc_log_error("Failed to init node");
+	else {
+		tmp->node->stop_request = &tmp->stop;
+		if (pthread_create(&tmp->thread, NULL, cc_api_node_thread_run, tmp) == 0) {
+			*thread = tmp;
+			return CC_SUCCESS;
+		}
+		cc_log_error("Failed to start node thread");
+	}
+
+	cc_api_node_thread_free(tmp);
+#if CC_USE_PYTHON
+	cc_api_python_nodes = 0;
+#endif
+
+	return CC_FAIL;
+}
+
+void cc_api_node_stop(cc_api_node_thread_t *thread)
+{
+	thread->stop = true;
+}
+
+cc_result_t cc_api_node_join(cc_api_node_thread_t *thread)
+{
+	if (pthread_join(thread->thread, NULL) != 0) {
+		cc_log_error("Failed to join node thread");
+		return CC_FAIL;
+	}
+
+	cc_api_node_thread_free(thread);
+#if CC_USE_PYTHON
+	cc_api_python_nodes = 0;
+#endif
+
+	return CC_SUCCESS;
+}
+#endif
@@ -24,6 +24,13 @@ cc_result_t cc_api_runtime_start(cc_node_t *node, const char *script);
 cc_result_t cc_api_runtime_stop(cc_node_t *node);
 cc_result_t cc_api_runtime_serialize_and_stop(cc_node_t *node);
 cc_result_t cc_api_reconnect(cc_node_t *node);
+#if CC_USE_NODE_THREADS
+// Nodes hosted in the process, each running on its own thread
+typedef struct cc_api_node_thread_t cc_api_node_thread_t;
+cc_result_t cc_api_node_spawn(cc_api_node_thread_t **thread, const char *attributes, const char *uris, const char *platform_args, const char *script, const char *state_file);
+void cc_api_node_stop(cc_api_node_thread_t *thread);
+cc_result_t cc_api_node_join(cc_api_node_thread_t *thread);
+#endif
 #if (CC_USE_STORAGE == 1)
 cc_result_t cc_api_clear_serialization_file(char *filedir);
 #endif
@@ -69,16 +69,113 @@
 #endif
 #endif
 
-// Time, in seconds, to wait before reconnecting transport
+// Time, in seconds, to wait before reconnecting when no proxy could be
+// reached, doubled after each failed round up to CC_RECONNECT_MAX_TIMEOUT
 #ifndef CC_RECONNECT_TIMEOUT
 #define CC_RECONNECT_TIMEOUT (5)
 #endif
 
+#ifndef CC_RECONNECT_MAX_TIMEOUT
+#define CC_RECONNECT_MAX_TIMEOUT (60)
+#endif
+
 // Default timeout, in seconds, waiting for an event
 #ifndef CC_INACTIVITY_TIMEOUT
 #define CC_INACTIVITY_TIMEOUT (2)
 #endif
 
+// Max number of requests waiting for a reply
+#ifndef CC_MAX_PENDING_MSGS
+#define CC_MAX_PENDING_MSGS (32)
+#endif
+
+// Time, in seconds, to wait for a reply before a request times out
+#ifndef CC_PENDING_MSG_TIMEOUT
+#define CC_PENDING_MSG_TIMEOUT (10)
+#endif
+
+// Default port queue length, used if not set in the port properties
+#ifndef CC_PORT_QUEUE_LENGTH
+#define CC_PORT_QUEUE_LENGTH (4)
+#endif
+
+// Max queue length a port fifo can grow to when full, 0 disables growth
+#ifndef CC_FIFO_MAX_SIZE
+#define CC_FIFO_MAX_SIZE (0)
+#endif
+
+// Number of writes failing on a full fifo, since it was last empty, before it grows
+#ifndef CC_FIFO_GROW_THRESHOLD
+#define CC_FIFO_GROW_THRESHOLD (8)
+#endif
+
+// Max number of unacked tokens sent from an outbound port
+#ifndef CC_PORT_WINDOW_SIZE
+#define CC_PORT_WINDOW_SIZE (16)
+#endif
+
+// Max number of tokens sent in one TOKEN_BATCH message, negotiated with the
+// peer when joining, 1 disables token batching
+#ifndef CC_TOKEN_BATCH_SIZE
+#define CC_TOKEN_BATCH_SIZE (8)
+#endif
+
+// Max size, in bytes, of the token data in one TOKEN_BATCH message
+#ifndef CC_TOKEN_BATCH_DATA_SIZE
+#define CC_TOKEN_BATCH_DATA_SIZE (512)
+#endif
+
+// Tokens larger than this, in bytes, are sent as a sequence of TOKEN_CHUNK
+// messages of at most this size if the peer supports it, 0 disables chunking
+#ifndef CC_TOKEN_CHUNK_SIZE
+#define CC_TOKEN_CHUNK_SIZE (1024)
+#endif
+
+// Enable the slab allocator, small allocations are served from static pools
+// of fixed size blocks, larger allocations or allocations when a pool is
+// exhausted falls back to the platform heap
+#ifndef CC_USE_SLAB
+#define CC_USE_SLAB (0)
+#endif
+
+// Number of blocks in the 16, 32, 64 and 128 byte pools, 0 disables a pool
+#if CC_USE_SLAB
+#ifndef CC_SLAB_16_COUNT
+#define CC_SLAB_16_COUNT (64)
+#endif
+#ifndef CC_SLAB_32_COUNT
+#define CC_SLAB_32_COUNT (64)
+#endif
+#ifndef CC_SLAB_64_COUNT
+#define CC_SLAB_64_COUNT (64)
+#endif
+#ifndef CC_SLAB_128_COUNT
+#define CC_SLAB_128_COUNT (16)
+#endif
+#endif
+
+// Run blocking calvinsys operations on worker threads, requires a platform
+// with threads and descriptor event sources (CC_USE_FDS)
+#ifndef CC_USE_WORKERS
+#define CC_USE_WORKERS (0)
+#endif
+
+// Number of worker threads
+#if CC_USE_WORKERS
+#ifndef CC_WORKER_THREADS
+#define CC_WORKER_THREADS (4)
+#endif
+#endif
+
+// Allow hosting several nodes in one process, each on its own thread
+#ifndef CC_USE_NODE_THREADS
+#define CC_USE_NODE_THREADS (0)
+#endif
+
+#if CC_USE_NODE_THREADS && CC_USE_SLAB
+#error "The slab allocator is shared and not thread safe, disable CC_USE_SLAB"
+#endif
+
 // Enable platform sleep
 #ifndef CC_USE_SLEEP
 #define CC_USE_SLEEP (0)
@@ -100,6 +197,33 @@
 #define CC_USE_STORAGE (1)
 #endif
 
+// Changed actors are appended to a journal next to the state file, the journal
+// is compacted into the state file when it has this many records or bytes
+#if CC_USE_CHECKPOINTING
+#ifndef CC_CHECKPOINT_JOURNAL_RECORDS
+#define CC_CHECKPOINT_JOURNAL_RECORDS (64)
+#endif
+#ifndef CC_CHECKPOINT_JOURNAL_SIZE
+#define CC_CHECKPOINT_JOURNAL_SIZE (64 * 1024)
+#endif
+#endif
+
+// State changes are grouped into one checkpoint, a change is written at most
+// CC_CHECKPOINT_INTERVAL ms after it was made. After CC_CHECKPOINT_CHANGES
+// changes they are written early but not sooner than CC_CHECKPOINT_MIN_INTERVAL
+// ms after the previous checkpoint, which bounds the rate of file syncs.
+#if CC_USE_CHECKPOINTING
+#ifndef CC_CHECKPOINT_INTERVAL
+#define CC_CHECKPOINT_INTERVAL (1000)
+#endif
+#ifndef CC_CHECKPOINT_CHANGES
+#define CC_CHECKPOINT_CHANGES (64)
+#endif
+#ifndef CC_CHECKPOINT_MIN_INTERVAL
+#define CC_CHECKPOINT_MIN_INTERVAL (100)
+#endif
+#endif
+
 // Enable storage, used to serialize node state
 #ifndef CC_USE_STORAGE
 #define CC_USE_STORAGE (0)
@@ -112,12 +236,6 @@
 #endif
 #endif
 
-#ifdef CC_USE_FDS
-#ifndef CC_CALVINSYS_MAX_FDS
-#define CC_CALVINSYS_MAX_FDS 10
-#endif
-#endif
-
 // WIFI AP config
 #ifndef CC_USE_WIFI_AP
 #define CC_USE_WIFI_AP (0)
@@ -27,6 +27,8 @@
 
 typedef struct cc_mpy_calvinsys_state_t {
 	mp_obj_t class_instance;
+	mp_obj_t serialized;
+	size_t serialized_size;
 } cc_mpy_calvinsys_state_t;
 
 static bool cc_mpy_calvinsys_can_write(cc_calvinsys_obj_t *obj)
@@ -148,51 +150,75 @@ static cc_result_t cc_mpy_calvinsys_close(cc_calvinsys_obj_t *obj)
 	return CC_SUCCESS;
 }
 
-static char *cc_mpy_calvinsys_serialize(char *id, cc_calvinsys_obj_t *obj, char *buffer)
+// The dict from serialize() is sized and then encoded by cc_mpy_calvinsys_serialize,
+// it is kept as an attribute of the instance in between to keep it from being collected
+static size_t cc_mpy_calvinsys_get_serialized_size(char *id, cc_calvinsys_obj_t *obj)
 {
 	mp_obj_t res;
 	cc_mpy_calvinsys_state_t *state = (cc_mpy_calvinsys_state_t *)obj->state;
 	mp_obj_t func[2];
-	size_t size = 0;
-	char *w = buffer;
+
+	state->serialized = MP_OBJ_NULL;
+	state->serialized_size = 0;
 
 	mp_load_method_maybe(state->class_instance, QSTR_FROM_STR_STATIC("serialize"), func);
-	if (func[0] != MP_OBJ_NULL && func[1] != MP_OBJ_NULL) {
-		res = mp_call_method_n_kw(0, 0, func);
-		if (res != mp_const_none) {
-			if (MP_OBJ_IS_TYPE(res, &mp_type_dict)) {
-				mp_map_t *map = mp_obj_dict_get_map(res);
-				uint kw_dict_len;
-				kw_dict_len = mp_obj_dict_len(res);
-
-			 	w = cc_coder_encode_kv_map(w, "obj", kw_dict_len);
-			 	w = w + size;
-				for (size_t i = 0; i < kw_dict_len; i++) {
-					if (cc_mpy_encode_from_mpy_obj(map->table[i].key, &w, &size, false) != CC_SUCCESS) {
-						cc_log_error("Failed to encode Python object");
-						w = NULL;
-						break;
-					}
-					w = w + size;
-					if (cc_mpy_encode_from_mpy_obj(map->table[i].value, &w, &size, false) != CC_SUCCESS) {
-						cc_log_error("Failed to encode Python object");
-						w = NULL;
-						break;
-					}
-					w = w + size;
-				}
-			 } else
-				cc_log_error("Serialized value is NOT dict");
-		} else
-			cc_log_error("Serialize returned NULL");
-	} else
+	if (func[0] == MP_OBJ_NULL || func[1] == MP_OBJ_NULL) {
 		cc_log_error("Failed to load serialize method");
+		return 0;
+	}
+
+	res = mp_call_method_n_kw(0, 0, func);
+	if (res == mp_const_none)
+		cc_log_error("Serialize returned NULL");
+	else if (!MP_OBJ_IS_TYPE(res, &mp_type_dict))
+		cc_log_error("Serialized value is NOT dict");
+	else {
+		// the dict is encoded as the value of "obj"
+		state->serialized_size = cc_mpy_sizeof_mpy_obj(res);
+		if (state->serialized_size > 0) {
+			state->serialized = res;
+			mp_store_attr(state->class_instance, QSTR_FROM_STR_STATIC("_serialized"), res);
+		}
+	}
 
 	func[0] = MP_OBJ_NULL;
 	func[1] = MP_OBJ_NULL;
 	res = MP_OBJ_NULL;
 
-	return w;
+	if (state->serialized_size == 0)
+		return 0;
+
+	return cc_coder_sizeof_key("obj") + state->serialized_size;
+}
+
+static char *cc_mpy_calvinsys_serialize(char *id, cc_calvinsys_obj_t *obj, char *buffer)
+{
+	cc_mpy_calvinsys_state_t *state = (cc_mpy_calvinsys_state_t *)obj->state;
+	mp_obj_t res = state->serialized;
+	size_t size = 0;
+	char *w = buffer;
+
+	if (res == MP_OBJ_NULL) {
+		cc_log_error("Calvinsys object '%s' not sized before serialized", id);
+		return NULL;
+	}
+
+	state->serialized = MP_OBJ_NULL;
+	mp_store_attr(state->class_instance, QSTR_FROM_STR_STATIC("_serialized"), mp_const_none);
+
+	// only the space sized for the dict has been reserved
+	if (cc_mpy_sizeof_mpy_obj(res) != state->serialized_size) {
+		cc_log_error("Serialized value of '%s' changed after sized", id);
+		return NULL;
+	}
+
+	w = cc_coder_encode_str(w, "obj", strlen("obj"));
+	if (cc_mpy_encode_from_mpy_obj(res, &w, &size, false) != CC_SUCCESS) {
+		cc_log_error("Failed to encode Python object");
+		return NULL;
+	}
+
+	return w + size;
 }
 
 static cc_result_t cc_mpy_calvinsys_object_load(cc_calvinsys_obj_t *obj, cc_list_t *kwargs)
@@ -282,6 +308,7 @@ static cc_result_t cc_mpy_calvinsys_object_load(cc_calvinsys_obj_t *obj, cc_list
 	obj->can_write = cc_mpy_calvinsys_can_write;
 	obj->close = cc_mpy_calvinsys_close;
 	obj->serialize = cc_mpy_calvinsys_serialize;
+	obj->get_serialized_size = cc_mpy_calvinsys_get_serialized_size;
 
 	cc_platform_mem_free(type);
 
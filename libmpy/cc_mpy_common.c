@@ -223,15 +223,18 @@ cc_result_t cc_mpy_encode_from_mpy_obj(mp_obj_t input, char **buffer, size_t *si
 
 		pos = *buffer;
 		pos = cc_coder_encode_bin(pos, bufinfo.buf, bufinfo.len);
-
-		return CC_SUCCESS;
 	} else if (MP_OBJ_IS_TYPE(input, &mp_type_list)) {
 		mp_obj_list_t *list = MP_OBJ_TO_PTR(input);
 
-		// TODO: Calculate buffer size
-		if (alloc && cc_platform_mem_alloc((void **)buffer, 200) != CC_SUCCESS) {
-			cc_log_error("Failed to allocate memory");
-			return CC_FAIL;
+		if (alloc) {
+			if ((to_alloc = cc_mpy_sizeof_mpy_obj(input)) == 0) {
+				cc_log_error("Failed to size Python object");
+				return CC_FAIL;
+			}
+			if (cc_platform_mem_alloc((void **)buffer, to_alloc) != CC_SUCCESS) {
+				cc_log_error("Failed to allocate memory");
+				return CC_FAIL;
+			}
 		}
 
 		pos = *buffer;
@@ -240,7 +243,7 @@ cc_result_t cc_mpy_encode_from_mpy_obj(mp_obj_t input, char **buffer, size_t *si
 			if (cc_mpy_encode_from_mpy_obj(list->items[i], &pos, size, false) != CC_SUCCESS) {
 				cc_log_error("Failed to encode Python object");
 				if (alloc)
-					cc_platform_mem_free(buffer);
+					cc_platform_mem_free(*buffer);
 				return CC_FAIL;
 			}
 			pos = pos + *size;
@@ -250,13 +253,15 @@ cc_result_t cc_mpy_encode_from_mpy_obj(mp_obj_t input, char **buffer, size_t *si
 		uint kw_dict_len;
 		kw_dict_len = mp_obj_dict_len(input);
 
-		// TODO: Try to calculate buffer size
 		if (alloc) {
-			if (cc_platform_mem_alloc((void **)buffer, 10000) != CC_SUCCESS) {
+			if ((to_alloc = cc_mpy_sizeof_mpy_obj(input)) == 0) {
+				cc_log_error("Failed to size Python object");
+				return CC_FAIL;
+			}
+			if (cc_platform_mem_alloc((void **)buffer, to_alloc) != CC_SUCCESS) {
 				cc_log_error("Failed to allocate memory");
 				return CC_FAIL;
 			}
-			memset(*buffer, 0, 10000);
 		}
 
 		pos = *buffer;
@@ -265,14 +270,14 @@ cc_result_t cc_mpy_encode_from_mpy_obj(mp_obj_t input, char **buffer, size_t *si
 			if (cc_mpy_encode_from_mpy_obj(map->table[i].key, &pos, size, false) != CC_SUCCESS) {
 				cc_log_error("Failed to encode Python object");
 				if (alloc)
-					cc_platform_mem_free(buffer);
+					cc_platform_mem_free(*buffer);
 				return CC_FAIL;
 			}
 			pos = pos + *size;
 			if (cc_mpy_encode_from_mpy_obj(map->table[i].value, &pos, size, false) != CC_SUCCESS) {
 				cc_log_error("Failed to encode Python object");
 				if (alloc)
-					cc_platform_mem_free(buffer);
+					cc_platform_mem_free(*buffer);
 				return CC_FAIL;
 			}
 			pos = pos + *size;
@@ -286,3 +291,56 @@ cc_result_t cc_mpy_encode_from_mpy_obj(mp_obj_t input, char **buffer, size_t *si
 
 	return CC_SUCCESS;
 }
+
+// Size of the object encoded by cc_mpy_encode_from_mpy_obj, 0 if it can't be encoded
+size_t cc_mpy_sizeof_mpy_obj(mp_obj_t input)
+{
+	size_t size = 0, item_size = 0, i = 0;
+
+	if (MP_OBJ_IS_SMALL_INT(input))
+		return cc_coder_sizeof_uint(MP_OBJ_SMALL_INT_VALUE(input));
+	if (MP_OBJ_IS_INT(input))
+		return cc_coder_sizeof_int(mp_obj_get_int(input));
+#if CC_PYTHON_FLOATS
+	if (mp_obj_is_float(input))
+		return cc_coder_sizeof_float(mp_obj_float_get(input));
+#endif
+	if (MP_OBJ_IS_TYPE(input, &mp_type_bool))
+		return cc_coder_sizeof_bool(input == mp_const_true);
+	if (MP_OBJ_IS_TYPE(input, &mp_type_NoneType))
+		return cc_coder_sizeof_nil();
+	if (MP_OBJ_IS_STR(input))
+		return cc_coder_sizeof_str(strlen(mp_obj_str_get_str(input)));
+	if (MP_OBJ_IS_TYPE(input, &mp_type_bytes)) {
+		mp_buffer_info_t bufinfo;
+		if (!mp_get_buffer(input, &bufinfo, MP_BUFFER_READ))
+			return 0;
+		return cc_coder_sizeof_bin(bufinfo.len);
+	}
+	if (MP_OBJ_IS_TYPE(input, &mp_type_list)) {
+		mp_obj_list_t *list = MP_OBJ_TO_PTR(input);
+		size = cc_coder_sizeof_array(list->len);
+		for (i = 0; i < list->len; i++) {
+			if ((item_size = cc_mpy_sizeof_mpy_obj(list->items[i])) == 0)
+				return 0;
+			size += item_size;
+		}
+		return size;
+	}
+	if (MP_OBJ_IS_TYPE(input, &mp_type_dict)) {
+		mp_map_t *map = mp_obj_dict_get_map(input);
+		size_t len = mp_obj_dict_len(input);
+		size = cc_coder_sizeof_map(len);
+		for (i = 0; i < len; i++) {
+			if ((item_size = cc_mpy_sizeof_mpy_obj(map->table[i].key)) == 0)
+				return 0;
+			size += item_size;
+			if ((item_size = cc_mpy_sizeof_mpy_obj(map->table[i].value)) == 0)
+				return 0;
+			size += item_size;
+		}
+		return size;
+	}
+
+	return 0;
+}
@@ -23,6 +23,7 @@
 
 cc_result_t cc_mpy_decode_to_mpy_obj(char *buffer, mp_obj_t *value);
 cc_result_t cc_mpy_encode_from_mpy_obj(mp_obj_t input, char **buffer, size_t *size, bool alloc);
+size_t cc_mpy_sizeof_mpy_obj(mp_obj_t input);
 
 #endif
 
@@ -23,6 +23,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include "cc_mpy_socket.h"
+#include "runtime/south/platform/cc_platform.h"
 #include "py/objstr.h"
 #include "py/runtime.h"
 #include "py/stream.h"
@@ -62,19 +63,6 @@ STATIC mp_obj_t cc_mpy_socket_make_new(const mp_obj_type_t *type_in, size_t n_ar
   int family = AF_INET;
   int type = SOCK_STREAM;
   int proto = 0;
-  int i = 0, fd_pos = -1;
-
-	for (i = 0; i < CC_CALVINSYS_MAX_FDS; i++) {
-		if (calvinsys->fds[i] == -1) {
-			fd_pos = i;
-			break;
-		}
-	}
-
-	if (fd_pos == -1) {
-		cc_log_error("No free descriptors");
-		return mp_const_none;
-	}
 
   if (n_args > 0) {
     if (!MP_OBJ_IS_SMALL_INT(args[0])) {
@@ -107,7 +95,14 @@ STATIC mp_obj_t cc_mpy_socket_make_new(const mp_obj_type_t *type_in, size_t n_ar
     return mp_const_none;
   }
 
-  calvinsys->fds[fd_pos] = fd;
+#if CC_USE_FDS
+  // sockets are not bound to a calvinsys object, readiness wakes all actors
+  if (cc_calvinsys_add_event_source(calvinsys, NULL, fd, CC_PLATFORM_EVENT_READ, NULL) != CC_SUCCESS) {
+    cc_log_error("Failed to add socket");
+    close(fd);
+    return mp_const_none;
+  }
+#endif
 
   return MP_OBJ_FROM_PTR(cc_mpy_socket_new(fd));
 }
@@ -194,17 +189,12 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_setblocking_obj, socket_setblocking);
 STATIC mp_obj_t cc_mpy_socket_close(mp_obj_t self_arg)
 {
   mp_obj_socket_t *self = MP_OBJ_TO_PTR(self_arg);
-  int i = 0;
 
+#if CC_USE_FDS
+  cc_calvinsys_remove_event_source(calvinsys, self->fd);
+#endif
   mp_stream_close(self_arg);
 
-  for (i = 0; i < CC_CALVINSYS_MAX_FDS; i++) {
-    if (calvinsys->fds[i] == self->fd) {
-      calvinsys->fds[i] = -1;
-      break;
-    }
-  }
-
   return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(cc_mpy_socket_close_obj, cc_mpy_socket_close);
@@ -25,6 +25,7 @@
 #include "runtime/south/platform/cc_platform.h"
 #include "coder/cc_coder.h"
 #include "cc_proto.h"
+#include "scheduler/cc_scheduler.h"
 #if CC_USE_PYTHON
 #include <stdio.h>
 #include "libmpy/cc_actor_mpy.h"
@@ -36,6 +37,11 @@ cc_result_t cc_actor_req_match_reply_handler(cc_node_t *node, char *data, size_t
 	uint32_t actor_id_len = 0, peer_id_len = 0, status = 0;
 	cc_actor_t *actor = NULL;
 
+	if (data == NULL) {
+		cc_log_error("Requirement match timed out");
+		return CC_FAIL;
+	}
+
 	if (cc_coder_get_value_from_map(data, "value", &value) != CC_SUCCESS) {
 		cc_log_error("Failed to decode 'value'");
 		return CC_FAIL;
@@ -108,6 +114,11 @@ static cc_result_t cc_actor_migrate_reply_handler(cc_node_t *node, char *data, s
 	actor_id = (char *)msg_data;
 	actor_id_len = strnlen(actor_id, CC_UUID_BUFFER_SIZE);
 
+	if (data == NULL) {
+		cc_log_error("Migration of actor '%s' timed out", actor_id);
+		return CC_FAIL;
+	}
+
 	if (cc_coder_get_value_from_map(data, "value", &value) != CC_SUCCESS) {
 		cc_log_error("Failed to get 'value'");
 		return CC_FAIL;
@@ -140,6 +151,9 @@ static cc_result_t actor_set_reply_handler(cc_node_t *node, char *data, size_t d
 	uint32_t key_len = 0, status = 0;
 	cc_actor_t *actor = NULL;
 
+	if (data == NULL)
+		return CC_FAIL;
+
 	if (cc_coder_get_value_from_map(data, "value", &value) != CC_SUCCESS) {
 		cc_log_error("Failed to get 'value'");
 		return CC_FAIL;
@@ -183,6 +197,7 @@ void cc_actor_set_state(cc_actor_t *actor, cc_actor_state_t state)
 	if (state == CC_ACTOR_ENABLED && actor->state != CC_ACTOR_ENABLED)
 		cc_log("Actor: Enabled '%s'", actor->id);
 	actor->state = state;
+	cc_scheduler_actor_ready(actor->calvinsys->node, actor);
 }
 
 #if CC_USE_PYTHON
@@ -254,6 +269,11 @@ static cc_result_t cc_actor_get_compiled_actor_reply_handler(cc_node_t *node, ch
 	uint32_t status = 0, type_len = 0, module_len = 0;
 	char *value = NULL, *module = NULL, *type = NULL, *obj_data = NULL;
 
+	if (data == NULL) {
+		cc_log_error("Actor module request timed out");
+		return CC_FAIL;
+	}
+
 	if (cc_coder_get_value_from_map(data, "value", &value) != CC_SUCCESS) {
 		cc_log_error("Failed to decode 'value'");
 		return CC_FAIL;
@@ -306,6 +326,7 @@ cc_actor_t *cc_actor_create_from_type(cc_node_t *node, char *type, uint32_t type
 	memset(actor, 0, sizeof(cc_actor_t));
 	actor->state = CC_ACTOR_PENDING;
 	actor->calvinsys = node->calvinsys;
+	cc_actor_set_dirty(actor);
 
 	if (cc_platform_mem_alloc((void **)&actor->type, type_len + 1) != CC_SUCCESS) {
 		cc_log_error("Failed to alllocate memory");
@@ -474,6 +495,11 @@ static cc_result_t cc_actor_create_ports(cc_node_t *node, cc_actor_t *actor, cha
 			}
 		}
 
+		if (cc_index_add(&node->port_index, port->id, strnlen(port->id, CC_UUID_BUFFER_SIZE), port) != CC_SUCCESS) {
+			cc_log_error("Failed to index port");
+			return CC_FAIL;
+		}
+
 		nbr_keys = cc_coder_decode_map(&ports);
 		for (i_key = 0; i_key < nbr_keys; i_key++) {
 			cc_coder_decode_map_next(&ports);
@@ -705,6 +731,9 @@ cc_actor_t *cc_actor_create(cc_node_t *node, char *root)
 		result = CC_FAIL;
 	}
 
+	if (result == CC_SUCCESS && (result = cc_index_add(&node->actor_index, actor->id, strnlen(actor->id, CC_UUID_BUFFER_SIZE), actor)) != CC_SUCCESS)
+		cc_log_error("Failed to index actor");
+
 	if (result == CC_SUCCESS) {
 		if (actor->state == CC_ACTOR_PENDING_IMPL)
 			cc_log("Actor: Created '%s', type '%s' with pending implementation", actor->id, actor->type);
@@ -729,6 +758,9 @@ void cc_actor_free(cc_node_t *node, cc_actor_t *actor, bool remove_from_registry
 	if (actor == NULL)
 		return;
 
+	cc_scheduler_actor_removed(node, actor);
+	cc_node_remove_pending_msgs_with_data(node, actor->id);
+
 	if (actor->will_end != NULL)
 		actor->will_end(actor);
 
@@ -771,7 +803,12 @@ void cc_actor_free(cc_node_t *node, cc_actor_t *actor, bool remove_from_registry
 			if (cc_proto_send_remove_actor(node, actor, actor_remove_reply_handler) != CC_SUCCESS)
 				cc_log_error("Failed to send command");
 		}
+#if CC_USE_CHECKPOINTING
+		if (cc_list_add_n(&node->checkpoint_removed, actor->id, strnlen(actor->id, CC_UUID_BUFFER_SIZE), NULL, 0) == NULL)
+			node->checkpoint_compact = true;
+#endif
 		cc_list_remove(&node->actors, actor->id);
+		cc_index_remove(&node->actor_index, actor->id, strnlen(actor->id, CC_UUID_BUFFER_SIZE), actor);
 		cc_platform_mem_free(actor->id);
 		actor->id = NULL;
 	}
@@ -784,18 +821,23 @@ void cc_actor_free(cc_node_t *node, cc_actor_t *actor, bool remove_from_registry
 	if (actor->private_attributes != NULL)
 		cc_actor_free_attribute_list(actor->private_attributes);
 
+	if (actor->serialize_attributes != NULL)
+		cc_actor_free_attribute_list(actor->serialize_attributes);
+
 	cc_platform_mem_free((void *)actor);
 }
 
 cc_actor_t *cc_actor_get(cc_node_t *node, const char *actor_id, uint32_t actor_id_len)
 {
-	cc_list_t *item = NULL;
+	cc_actor_t *actor = (cc_actor_t *)cc_index_get(&node->actor_index, actor_id, actor_id_len);
 
-	item = cc_list_get_n(node->actors, actor_id, actor_id_len);
-	if (item != NULL)
-		return (cc_actor_t *)item->data;
+#if CC_USE_STORAGE
+	// restored actors are created when first used
+	if (actor == NULL && node->restore_actors != NULL && cc_node_restore_actor(node, actor_id, actor_id_len) == CC_SUCCESS)
+		actor = (cc_actor_t *)cc_index_get(&node->actor_index, actor_id, actor_id_len);
+#endif
 
-	return NULL;
+	return actor;
 }
 
 cc_actor_t *cc_actor_get_from_name(cc_node_t *node, const char *name, uint32_t name_len)
@@ -810,6 +852,14 @@ cc_actor_t *cc_actor_get_from_name(cc_node_t *node, const char *name, uint32_t n
 		actors = actors->next;
 	}
 
+#if CC_USE_STORAGE
+	// names are only known once restored actors are created
+	if (node->restore_actors != NULL) {
+		cc_node_restore_actors(node);
+		return cc_actor_get_from_name(node, name, name_len);
+	}
+#endif
+
 	return NULL;
 }
 
@@ -819,6 +869,8 @@ void cc_actor_port_state_changed(cc_actor_t *actor)
 	cc_actor_state_t actor_state = CC_ACTOR_ENABLED;
 	cc_port_state_t port_state = CC_PORT_DISCONNECTED;
 
+	cc_actor_set_dirty(actor);
+
 	list = actor->in_ports;
 	while (list != NULL) {
 		port_state = ((cc_port_t *)list->data)->state;
@@ -897,35 +949,134 @@ cc_result_t cc_actor_migrate(cc_node_t *node, cc_actor_t *actor, char *to_rt_uui
 	return cc_proto_send_actor_new(node, actor, to_rt_uuid, to_rt_uuid_len, cc_actor_migrate_reply_handler);
 }
 
-char *cc_actor_serialize(const cc_node_t *node, cc_actor_t *actor, char *buffer, bool include_state)
+static void cc_actor_serialize_done(cc_actor_t *actor)
 {
-	cc_list_t *in_ports = NULL, *out_ports = NULL;
-	cc_list_t *managed_attributes = NULL, *tmp_list = NULL;
-	cc_port_t *port = NULL;
-	unsigned int nbr_state_attributes = 3;
-	unsigned int nbr_inports = 0, nbr_outports = 0, nbr_managed_attributes = 0;
-	unsigned int nbr_private_attributes = 0;
+	if (actor->serialize_attributes != NULL) {
+		cc_actor_free_attribute_list(actor->serialize_attributes);
+		actor->serialize_attributes = NULL;
+	}
+	actor->serialize_prepared = false;
+}
+
+// Collects the attributes the actor is serialized with, they are kept until
+// the actor is encoded so the size and the encoding are computed from the same data
+static cc_result_t cc_actor_serialize_prepare(const cc_node_t *node, cc_actor_t *actor)
+{
+	cc_list_t *item = NULL;
+
+	cc_actor_serialize_done(actor);
 
 	if (actor->private_attributes == NULL) {
 		cc_log_error("No private_attributes");
-		return NULL;
+		return CC_FAIL;
 	}
 
 	if (actor->get_managed_attributes != NULL) {
-		if (actor->get_managed_attributes((cc_actor_t *)actor, &managed_attributes) != CC_SUCCESS) {
+		if (actor->get_managed_attributes((cc_actor_t *)actor, &actor->serialize_attributes) != CC_SUCCESS) {
 			cc_log_error("Failed to get managed attributes");
-			return NULL;
+			cc_actor_serialize_done(actor);
+			return CC_FAIL;
 		}
-		nbr_managed_attributes = cc_list_count(managed_attributes);
+	}
+
+	// replace the calvinsys state from an earlier serialization
+	item = cc_list_get(actor->private_attributes, "_calvinsys");
+	if (item != NULL) {
+		cc_platform_mem_free(item->data);
+		cc_list_remove(&actor->private_attributes, "_calvinsys");
 	}
 
 	if (cc_calvinsys_get_attributes(node->calvinsys, actor, &actor->private_attributes) != CC_SUCCESS) {
 		cc_log_error("Failed to get calvinsys attributes");
-		if (managed_attributes != NULL)
-			cc_actor_free_attribute_list(managed_attributes);
-		return NULL;
+		cc_actor_serialize_done(actor);
+		return CC_FAIL;
 	}
 
+	actor->serialize_prepared = true;
+
+	return CC_SUCCESS;
+}
+
+static size_t cc_actor_get_attributes_size(cc_list_t *attributes)
+{
+	size_t size = 0;
+
+	while (attributes != NULL) {
+		size += cc_coder_sizeof_key(attributes->id);
+		if (attributes->data == NULL)
+			size += cc_coder_sizeof_nil();
+		else
+			size += attributes->data_len;
+		attributes = attributes->next;
+	}
+
+	return size;
+}
+
+// Returns the number of bytes cc_actor_serialize writes for the actor, 0 on
+// failure. Must be kept in line with cc_actor_serialize.
+size_t cc_actor_get_serialized_size(const cc_node_t *node, cc_actor_t *actor, bool include_state)
+{
+	cc_list_t *ports = NULL;
+	unsigned int nbr_state_attributes = 3;
+	unsigned int nbr_inports = 0, nbr_outports = 0;
+	size_t size = 0;
+
+	if (cc_actor_serialize_prepare(node, actor) != CC_SUCCESS)
+		return 0;
+
+	if (actor->in_ports != NULL)
+		nbr_inports = cc_list_count(actor->in_ports);
+	if (actor->out_ports != NULL)
+		nbr_outports = cc_list_count(actor->out_ports);
+
+	if (include_state)
+		nbr_state_attributes += 1;
+
+	size += cc_coder_sizeof_key("state") + cc_coder_sizeof_map(nbr_state_attributes);
+	if (include_state)
+		size += cc_coder_sizeof_key("constrained_state") + cc_coder_sizeof_uint(actor->state);
+	size += cc_coder_sizeof_key("actor_type") + cc_coder_sizeof_str(strlen(actor->type));
+	size += cc_coder_sizeof_key("prev_connections") + cc_coder_sizeof_map(2);
+	size += cc_coder_sizeof_key("inports") + cc_coder_sizeof_map(nbr_inports);
+	for (ports = actor->in_ports; ports != NULL; ports = ports->next)
+		size += cc_port_get_prev_connections_size((cc_port_t *)ports->data);
+	size += cc_coder_sizeof_key("outports") + cc_coder_sizeof_map(nbr_outports);
+	for (ports = actor->out_ports; ports != NULL; ports = ports->next)
+		size += cc_port_get_prev_connections_size((cc_port_t *)ports->data);
+
+	size += cc_coder_sizeof_key("actor_state") + cc_coder_sizeof_map(4);
+	size += cc_coder_sizeof_key("security") + cc_coder_sizeof_map(1);
+	size += cc_coder_sizeof_key("_subject_attributes") + cc_coder_sizeof_nil();
+	size += cc_coder_sizeof_key("custom") + cc_coder_sizeof_map(0);
+	size += cc_coder_sizeof_key("managed") + cc_coder_sizeof_map(cc_list_count(actor->serialize_attributes));
+	size += cc_actor_get_attributes_size(actor->serialize_attributes);
+	size += cc_coder_sizeof_key("private") + cc_coder_sizeof_map(cc_list_count(actor->private_attributes) + 2);
+	size += cc_actor_get_attributes_size(actor->private_attributes);
+	size += cc_coder_sizeof_key("inports") + cc_coder_sizeof_map(nbr_inports);
+	for (ports = actor->in_ports; ports != NULL; ports = ports->next)
+		size += cc_port_get_serialized_size((cc_port_t *)ports->data, include_state);
+	size += cc_coder_sizeof_key("outports") + cc_coder_sizeof_map(nbr_outports);
+	for (ports = actor->out_ports; ports != NULL; ports = ports->next)
+		size += cc_port_get_serialized_size((cc_port_t *)ports->data, include_state);
+
+	return size;
+}
+
+char *cc_actor_serialize(const cc_node_t *node, cc_actor_t *actor, char *buffer, bool include_state)
+{
+	cc_list_t *in_ports = NULL, *out_ports = NULL;
+	cc_list_t *tmp_list = NULL;
+	cc_port_t *port = NULL;
+	unsigned int nbr_state_attributes = 3;
+	unsigned int nbr_inports = 0, nbr_outports = 0, nbr_managed_attributes = 0;
+	unsigned int nbr_private_attributes = 0;
+
+	// uses the attributes collected by cc_actor_get_serialized_size if called before
+	if (!actor->serialize_prepared && cc_actor_serialize_prepare(node, actor) != CC_SUCCESS)
+		return NULL;
+
+	nbr_managed_attributes = cc_list_count(actor->serialize_attributes);
 	nbr_private_attributes = cc_list_count(actor->private_attributes);
 	nbr_private_attributes += 2; // in/outports
 
@@ -973,7 +1124,7 @@ char *cc_actor_serialize(const cc_node_t *node, cc_actor_t *actor, char *buffer,
 			buffer = cc_coder_encode_kv_map(buffer, "custom", 0);
 			buffer = cc_coder_encode_kv_map(buffer, "managed", nbr_managed_attributes);
 			{
-				tmp_list = managed_attributes;
+				tmp_list = actor->serialize_attributes;
 				while (tmp_list != NULL) {
 					buffer = cc_coder_encode_kv_value(buffer, tmp_list->id, (char *)tmp_list->data, tmp_list->data_len);
 					tmp_list = tmp_list->next;
@@ -1010,8 +1161,7 @@ char *cc_actor_serialize(const cc_node_t *node, cc_actor_t *actor, char *buffer,
 		}
 	}
 
-	if (managed_attributes != NULL)
-		cc_actor_free_attribute_list(managed_attributes);
+	cc_actor_serialize_done(actor);
 
 	return buffer;
 }
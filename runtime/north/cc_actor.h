@@ -63,8 +63,22 @@ typedef struct cc_actor_t{
 	cc_result_t (*get_requires)(struct cc_actor_t *actor, cc_list_t **requires);
 	cc_calvinsys_t *calvinsys;
 	char *requires;
+	bool ready;
+	struct cc_actor_t *next_ready;
+	uint32_t scheduler_pass; // last scheduler pass the actor was visited in
+	cc_list_t *serialize_attributes; // managed attributes collected when sized
+	bool serialize_prepared;
+#if CC_USE_CHECKPOINTING
+	bool dirty; // changed since the last checkpoint
+#endif
 } cc_actor_t;
 
+#if CC_USE_CHECKPOINTING
+#define cc_actor_set_dirty(actor) ((actor)->dirty = true)
+#else
+#define cc_actor_set_dirty(actor) do {} while (0)
+#endif
+
 cc_result_t cc_actor_req_match_reply_handler(struct cc_node_t *node, char *data, size_t data_len, void *msg_data);
 cc_actor_t *cc_actor_create(struct cc_node_t *node, char *root);
 cc_actor_t *cc_actor_create_from_type(struct cc_node_t *node, char *type, uint32_t type_len);
@@ -75,6 +89,7 @@ void cc_actor_port_state_changed(cc_actor_t *actor);
 void cc_actor_disconnect(struct cc_node_t *node, cc_actor_t *actor, bool unref_tunnel);
 void cc_actor_connect_ports(struct cc_node_t *node, cc_actor_t *actor);
 cc_result_t cc_actor_migrate(struct cc_node_t *node, cc_actor_t *actor, char *to_rt_uuid, uint32_t to_rt_uuid_len);
+size_t cc_actor_get_serialized_size(const struct cc_node_t *node, cc_actor_t *actor, bool include_state);
 char *cc_actor_serialize(const struct cc_node_t *node, cc_actor_t *actor, char *buffer, bool include_state);
 void cc_actor_free_attribute_list(cc_list_t *managed_attributes);
 
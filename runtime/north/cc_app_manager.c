@@ -63,7 +63,7 @@ static cc_result_t cc_app_manager_setup_port_connections(cc_node_t *node, cc_por
 static cc_result_t cc_app_manager_create_ports(cc_node_t *node, cc_actor_t *actor, char *obj_portproperties)
 {
   cc_result_t result = CC_SUCCESS;
-  uint32_t i = 0, port_count = 0, name_len = 0, direction_len = 0, nbr_peers = 0;
+  uint32_t i = 0, port_count = 0, name_len = 0, direction_len = 0, nbr_peers = 0, queue_length = 0;
   char *name = NULL, *direction = NULL, *obj_port = NULL, *obj_properties = NULL;
   cc_port_t *port = NULL;
 
@@ -84,6 +84,12 @@ static cc_result_t cc_app_manager_create_ports(cc_node_t *node, cc_actor_t *acto
     if (result == CC_SUCCESS && (result = cc_coder_decode_uint_from_map(obj_properties, "nbr_peers", &nbr_peers)) != CC_SUCCESS)
       cc_log_error("Failed to get 'nbr_peers'");
 
+    queue_length = CC_PORT_QUEUE_LENGTH;
+    if (result == CC_SUCCESS && cc_coder_has_key(obj_properties, "queue_length")) {
+      if ((result = cc_coder_decode_uint_from_map(obj_properties, "queue_length", &queue_length)) != CC_SUCCESS)
+        cc_log_error("Failed to decode 'queue_length'");
+    }
+
     if (result == CC_SUCCESS && (result = cc_platform_mem_alloc((void **)&port, sizeof(cc_port_t))) != CC_SUCCESS)
       cc_log_error("Failed to allocate memory");
 
@@ -101,7 +107,8 @@ static cc_result_t cc_app_manager_create_ports(cc_node_t *node, cc_actor_t *acto
       port->actor = actor;
       port->peer_port = NULL;
       port->tunnel = NULL;
-      port->fifo = cc_fifo_init_empty();
+      cc_port_set_default_sink(port);
+      port->fifo = cc_fifo_init_empty(queue_length);
       if (port->fifo ==  NULL) {
         cc_log_error("Failed to init fifo");
         result = CC_FAIL;
@@ -119,6 +126,9 @@ static cc_result_t cc_app_manager_create_ports(cc_node_t *node, cc_actor_t *acto
         }
       }
 
+      if (result == CC_SUCCESS && (result = cc_index_add(&node->port_index, port->id, strnlen(port->id, CC_UUID_BUFFER_SIZE), port)) != CC_SUCCESS)
+        cc_log_error("Failed to index port");
+
       if (result != CC_SUCCESS && port != NULL)
         cc_port_free(node, port, false);
     }
@@ -204,6 +214,9 @@ static cc_actor_t *cc_app_manager_create_actor(cc_node_t *node, char *obj_actor)
     result = CC_FAIL;
   }
 
+  if (result == CC_SUCCESS && (result = cc_index_add(&node->actor_index, actor->id, strnlen(actor->id, CC_UUID_BUFFER_SIZE), actor)) != CC_SUCCESS)
+    cc_log_error("Failed to index actor");
+
   // add args
   args_count = cc_coder_decode_map(&args);
   for (i = 0; i < args_count && result == CC_SUCCESS; i++) {
@@ -16,14 +16,42 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #include "cc_common.h"
 #include "runtime/south/platform/cc_platform.h"
 //#include <esp/hwrand.h>
 
+// xorshift state, per thread when nodes are hosted on separate threads
+#if CC_USE_NODE_THREADS
+static __thread uint32_t cc_uuid_state;
+#else
+static uint32_t cc_uuid_state;
+#endif
+
+static uint32_t cc_uuid_random(void)
+{
+	uint32_t x = cc_uuid_state;
+
+	if (x == 0) {
+		// rand() is only used for seeding, the address differs between threads
+		x = (uint32_t)rand() ^ (uint32_t)(uintptr_t)&cc_uuid_state ^ (uint32_t)cc_platform_get_time_ms();
+		if (x == 0)
+			x = 0x9e3779b9;
+	}
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	cc_uuid_state = x;
+
+	return x;
+}
+
 // TODO: Generate a proper uuid
 void cc_gen_uuid(char *buffer, const char *prefix)
 {
 	int i, len_prefix = 0;
+	uint32_t value = 0;
 	const char *hex_digits = "0123456789abcdef";
 
 	if (prefix != NULL)
@@ -32,8 +60,12 @@ void cc_gen_uuid(char *buffer, const char *prefix)
 	for (i = 0; i < len_prefix; i++)
 		buffer[i] = prefix[i];
 
-	for (i = 0; i < 36; i++)
-		buffer[i + len_prefix] = hex_digits[(rand() % 16)];
+	for (i = 0; i < 36; i++) {
+		if (i % 8 == 0)
+			value = cc_uuid_random();
+		buffer[i + len_prefix] = hex_digits[value & 0x0f];
+		value >>= 4;
+	}
 
 	buffer[8 + len_prefix] = buffer[13 + len_prefix] = buffer[18 + len_prefix] = buffer[23 + len_prefix] = '-';
 	buffer[36 + len_prefix] = '\0';
@@ -174,6 +206,230 @@ cc_list_t *cc_list_get(cc_list_t *list, const char *id)
 	return NULL;
 }
 
+#if CC_USE_SLAB
+#define CC_SLAB_NBR_OF_CLASSES 4
+#define CC_SLAB_POOL(size, count) static uint64_t cc_slab_pool_##size[((size) * (count)) / sizeof(uint64_t) + 1]
+
+CC_SLAB_POOL(16, CC_SLAB_16_COUNT);
+CC_SLAB_POOL(32, CC_SLAB_32_COUNT);
+CC_SLAB_POOL(64, CC_SLAB_64_COUNT);
+CC_SLAB_POOL(128, CC_SLAB_128_COUNT);
+
+// free blocks are linked through their first word, blocks never handed out
+// are taken from the end of the pool so no initialization is needed
+typedef struct cc_slab_class_t {
+	char *pool;
+	void *free_list;
+	uint32_t untouched;
+	cc_slab_stats_t stats;
+} cc_slab_class_t;
+
+static cc_slab_class_t cc_slab_classes[CC_SLAB_NBR_OF_CLASSES] = {
+	{(char *)cc_slab_pool_16, NULL, 0, {16, CC_SLAB_16_COUNT, 0, 0, 0}},
+	{(char *)cc_slab_pool_32, NULL, 0, {32, CC_SLAB_32_COUNT, 0, 0, 0}},
+	{(char *)cc_slab_pool_64, NULL, 0, {64, CC_SLAB_64_COUNT, 0, 0, 0}},
+	{(char *)cc_slab_pool_128, NULL, 0, {128, CC_SLAB_128_COUNT, 0, 0, 0}}
+};
+
+cc_result_t cc_slab_alloc(void **buffer, uint32_t size)
+{
+	cc_slab_class_t *slab = NULL;
+	uint8_t i = 0;
+
+	for (i = 0; i < CC_SLAB_NBR_OF_CLASSES; i++) {
+		slab = &cc_slab_classes[i];
+		if (size > slab->stats.block_size || slab->stats.blocks == 0)
+			continue;
+
+		if (slab->free_list != NULL) {
+			*buffer = slab->free_list;
+			slab->free_list = *(void **)slab->free_list;
+		} else if (slab->untouched < slab->stats.blocks) {
+			*buffer = slab->pool + slab->untouched * slab->stats.block_size;
+			slab->untouched++;
+		} else {
+			slab->stats.fallbacks++;
+			return CC_FAIL;
+		}
+
+		slab->stats.used++;
+		if (slab->stats.used > slab->stats.peak)
+			slab->stats.peak = slab->stats.used;
+		return CC_SUCCESS;
+	}
+
+	return CC_FAIL;
+}
+
+bool cc_slab_free(void *buffer)
+{
+	cc_slab_class_t *slab = NULL;
+	uint8_t i = 0;
+
+	for (i = 0; i < CC_SLAB_NBR_OF_CLASSES; i++) {
+		slab = &cc_slab_classes[i];
+		if ((char *)buffer >= slab->pool && (char *)buffer < slab->pool + slab->stats.blocks * slab->stats.block_size) {
+			*(void **)buffer = slab->free_list;
+			slab->free_list = buffer;
+			slab->stats.used--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+cc_result_t cc_slab_get_stats(uint8_t size_class, cc_slab_stats_t *stats)
+{
+	if (size_class >= CC_SLAB_NBR_OF_CLASSES)
+		return CC_FAIL;
+
+	*stats = cc_slab_classes[size_class].stats;
+
+	return CC_SUCCESS;
+}
+#endif
+
+#define CC_INDEX_INITIAL_SIZE 16
+
+// FNV-1a
+uint32_t cc_hash(const char *id, uint32_t id_len)
+{
+	uint32_t hash = 2166136261u, i = 0;
+
+	for (i = 0; i < id_len; i++) {
+		hash ^= (uint8_t)id[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static cc_index_entry_t *cc_index_find(const cc_index_t *index, const char *id, uint32_t id_len, uint32_t hash)
+{
+	uint32_t i = 0, n = 0, mask = index->size - 1;
+	cc_index_entry_t *entry = NULL;
+
+	for (i = hash & mask, n = 0; n < index->size; i = (i + 1) & mask, n++) {
+		entry = &index->entries[i];
+		if (entry->id == NULL)
+			return NULL;
+		// removed entries have data set to NULL
+		if (entry->data != NULL && entry->hash == hash && entry->id_len == id_len && strncmp(entry->id, id, id_len) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void cc_index_insert(cc_index_t *index, const char *id, uint32_t id_len, uint32_t hash, void *data)
+{
+	uint32_t i = 0, mask = index->size - 1;
+
+	for (i = hash & mask; index->entries[i].data != NULL; i = (i + 1) & mask)
+		;
+
+	if (index->entries[i].id == NULL)
+		index->used++;
+	index->entries[i].id = id;
+	index->entries[i].id_len = id_len;
+	index->entries[i].hash = hash;
+	index->entries[i].data = data;
+	index->count++;
+}
+
+static cc_result_t cc_index_resize(cc_index_t *index, uint32_t size)
+{
+	cc_index_entry_t *entries = index->entries;
+	uint32_t old_size = index->size, i = 0;
+
+	if (cc_platform_mem_alloc((void **)&index->entries, sizeof(cc_index_entry_t) * size) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		index->entries = entries;
+		return CC_FAIL;
+	}
+
+	memset(index->entries, 0, sizeof(cc_index_entry_t) * size);
+	index->size = size;
+	index->count = 0;
+	index->used = 0;
+
+	for (i = 0; i < old_size; i++) {
+		if (entries[i].data != NULL)
+			cc_index_insert(index, entries[i].id, entries[i].id_len, entries[i].hash, entries[i].data);
+	}
+
+	if (entries != NULL)
+		cc_platform_mem_free((void *)entries);
+
+	return CC_SUCCESS;
+}
+
+cc_result_t cc_index_add(cc_index_t *index, const char *id, uint32_t id_len, void *data)
+{
+	uint32_t hash = cc_hash(id, id_len), size = CC_INDEX_INITIAL_SIZE;
+	cc_index_entry_t *entry = NULL;
+
+	if (index->size > 0) {
+		entry = cc_index_find(index, id, id_len, hash);
+		if (entry != NULL) {
+			entry->id = id;
+			entry->data = data;
+			return CC_SUCCESS;
+		}
+	}
+
+	// keep the load, including removed entries, below 3/4
+	if ((index->used + 1) * 4 > index->size * 3) {
+		if (index->size > 0)
+			size = (index->count + 1) * 2 > index->size ? index->size * 2 : index->size;
+		if (cc_index_resize(index, size) != CC_SUCCESS)
+			return CC_FAIL;
+	}
+
+	cc_index_insert(index, id, id_len, hash, data);
+
+	return CC_SUCCESS;
+}
+
+void cc_index_remove(cc_index_t *index, const char *id, uint32_t id_len, void *data)
+{
+	cc_index_entry_t *entry = NULL;
+
+	if (index->size == 0)
+		return;
+
+	entry = cc_index_find(index, id, id_len, cc_hash(id, id_len));
+	if (entry != NULL && entry->data == data) {
+		entry->data = NULL;
+		index->count--;
+	}
+}
+
+void *cc_index_get(const cc_index_t *index, const char *id, uint32_t id_len)
+{
+	cc_index_entry_t *entry = NULL;
+
+	if (index->size == 0)
+		return NULL;
+
+	entry = cc_index_find(index, id, id_len, cc_hash(id, id_len));
+	if (entry != NULL)
+		return entry->data;
+
+	return NULL;
+}
+
+void cc_index_free(cc_index_t *index)
+{
+	if (index->entries != NULL)
+		cc_platform_mem_free((void *)index->entries);
+	index->entries = NULL;
+	index->size = 0;
+	index->count = 0;
+	index->used = 0;
+}
+
 static int cc_json_skip(const char *buffer, jsmntok_t *token, size_t count)
 {
 	int i = 0, j = 0;
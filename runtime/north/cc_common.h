@@ -43,6 +43,31 @@ typedef struct cc_list_t {
 	struct cc_list_t *next;
 } cc_list_t;
 
+// open addressing hash index entry, id points to the id of the indexed object
+typedef struct cc_index_entry_t {
+	const char *id;
+	uint32_t id_len;
+	uint32_t hash;
+	void *data;
+} cc_index_entry_t;
+
+// hash index with string identifiers, used for fast lookups of list items
+typedef struct cc_index_t {
+	cc_index_entry_t *entries;
+	uint32_t size;
+	uint32_t count;
+	uint32_t used;
+} cc_index_t;
+
+// slab allocator size class statistics
+typedef struct cc_slab_stats_t {
+	uint32_t block_size;
+	uint32_t blocks;
+	uint32_t used;
+	uint32_t peak;
+	uint32_t fallbacks;
+} cc_slab_stats_t;
+
 /**
  * cc_gen_uuid() - Fill buffer with a 36 byte UUID and optional prefix
  * @buffer Buffer to fill
@@ -118,6 +143,83 @@ cc_list_t *cc_list_get_n(cc_list_t *list, const char *id, uint32_t id_len);
  */
 cc_list_t *cc_list_get(cc_list_t *list, const char *id);
 
+/**
+ * cc_hash() - Hash an identifier
+ * @id ID to hash
+ * @id_len Length of ID
+ *
+ * Return: The hash
+ */
+uint32_t cc_hash(const char *id, uint32_t id_len);
+
+/**
+ * cc_index_add() - Add item to index
+ * @index The index
+ * @id ID of item, must be valid while indexed
+ * @id_len Length of ID
+ * @data Data to index
+ *
+ * An existing item with the same ID is replaced.
+ *
+ * Return: CC_SUCCESS or CC_FAIL on allocation failure
+ */
+cc_result_t cc_index_add(cc_index_t *index, const char *id, uint32_t id_len, void *data);
+
+/**
+ * cc_index_remove() - Remove item from index
+ * @index The index
+ * @id ID of item
+ * @id_len Length of ID
+ * @data Indexed data, only removed if matching
+ */
+void cc_index_remove(cc_index_t *index, const char *id, uint32_t id_len, void *data);
+
+/**
+ * cc_index_get() - Get item from index
+ * @index The index
+ * @id ID of item
+ * @id_len Length of ID
+ *
+ * Return: Pointer to data or NULL
+ */
+void *cc_index_get(const cc_index_t *index, const char *id, uint32_t id_len);
+
+/**
+ * cc_index_free() - Free index
+ * @index The index
+ */
+void cc_index_free(cc_index_t *index);
+
+/**
+ * cc_slab_alloc() - Allocate a block from the slab pools
+ * @buffer Allocated block
+ * @size Requested size
+ *
+ * Used by the platform mem API when CC_USE_SLAB is set, the block is taken
+ * from the smallest size class that fits.
+ *
+ * Return: CC_SUCCESS or CC_FAIL if no pool can serve the request
+ */
+cc_result_t cc_slab_alloc(void **buffer, uint32_t size);
+
+/**
+ * cc_slab_free() - Return a block to its slab pool
+ * @buffer The block
+ *
+ * Return: true if the block belonged to a pool, false if it should be
+ * released to the platform heap
+ */
+bool cc_slab_free(void *buffer);
+
+/**
+ * cc_slab_get_stats() - Get size class statistics
+ * @size_class Size class index, starting at 0
+ * @stats Statistics
+ *
+ * Return: CC_SUCCESS or CC_FAIL if size_class is out of range
+ */
+cc_result_t cc_slab_get_stats(uint8_t size_class, cc_slab_stats_t *stats);
+
 /**
  * cc_json_get_dict_value() - Get value with JSON object
  * @buffer The JSON buffer
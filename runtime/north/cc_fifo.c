@@ -15,10 +15,102 @@
  */
 #include <stdlib.h>
 #include <string.h>
+#include "cc_config.h"
 #include "cc_fifo.h"
 #include "coder/cc_coder.h"
 #include "runtime/south/platform/cc_platform.h"
 
+#define CC_FIFO_INDEX(fifo, pos) ((pos) & ((fifo)->size - 1))
+
+// Smallest power of two >= size
+static uint32_t cc_fifo_round_size(uint32_t size)
+{
+	uint32_t rounded = 2;
+
+	while (rounded < size)
+		rounded <<= 1;
+
+	return rounded;
+}
+
+static cc_result_t cc_fifo_alloc_tokens(cc_fifo_t *fifo, uint32_t length)
+{
+	uint32_t i_token = 0;
+
+	fifo->length = length;
+	fifo->size = cc_fifo_round_size(length);
+	if (cc_platform_mem_alloc((void **)&fifo->tokens, sizeof(cc_token_t) * fifo->size) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return CC_FAIL;
+	}
+
+	for (i_token = 0; i_token < fifo->size; i_token++) {
+		fifo->tokens[i_token].value = NULL;
+		fifo->tokens[i_token].size = 0;
+		fifo->tokens[i_token].rx_buffer = NULL;
+	}
+
+	return CC_SUCCESS;
+}
+
+#if CC_FIFO_MAX_SIZE > 0
+// Double the queue length, tokens keep their positions
+static void cc_fifo_grow(cc_fifo_t *fifo)
+{
+	cc_token_t *tokens = NULL;
+	uint32_t pos = 0, length = fifo->length * 2, size = 0, i_token = 0;
+
+	if (length > CC_FIFO_MAX_SIZE)
+		length = CC_FIFO_MAX_SIZE;
+
+	fifo->full_count = 0;
+	if (length <= fifo->size) {
+		fifo->length = length;
+		cc_log_debug("Fifo: Increased length to '%ld'", (unsigned long)length);
+		return;
+	}
+
+	size = cc_fifo_round_size(length);
+	if (cc_platform_mem_alloc((void **)&tokens, sizeof(cc_token_t) * size) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return;
+	}
+
+	for (i_token = 0; i_token < size; i_token++) {
+		tokens[i_token].value = NULL;
+		tokens[i_token].size = 0;
+		tokens[i_token].rx_buffer = NULL;
+	}
+
+	for (pos = fifo->read_pos; pos != fifo->write_pos; pos++)
+		tokens[pos & (size - 1)] = fifo->tokens[CC_FIFO_INDEX(fifo, pos)];
+
+	cc_platform_mem_free((void *)fifo->tokens);
+	fifo->tokens = tokens;
+	fifo->size = size;
+	fifo->length = length;
+	cc_log_debug("Fifo: Increased length to '%ld'", (unsigned long)length);
+}
+#endif
+
+// Checks for a free slot before a write, a fifo found full by writes
+// since it was last empty grows
+static bool cc_fifo_write_slot_available(cc_fifo_t *fifo)
+{
+	if (fifo->write_pos == fifo->read_pos)
+		fifo->full_count = 0;
+
+	if (fifo->write_pos - fifo->read_pos < fifo->length)
+		return true;
+
+#if CC_FIFO_MAX_SIZE > 0
+	if (fifo->length < CC_FIFO_MAX_SIZE && ++fifo->full_count >= CC_FIFO_GROW_THRESHOLD)
+		cc_fifo_grow(fifo);
+#endif
+
+	return fifo->write_pos - fifo->read_pos < fifo->length;
+}
+
 cc_fifo_t *cc_fifo_init(char *obj_fifo, char* obj_properties)
 {
 	cc_result_t result = CC_SUCCESS;
@@ -26,7 +118,7 @@ cc_fifo_t *cc_fifo_init(char *obj_fifo, char* obj_properties)
 	char *reader = NULL, *tmp_reader = NULL, *obj_read_pos = NULL, *obj_tokens = NULL, *obj_readers = NULL;
 	char *obj_token = NULL, *obj_tentative_read_pos = NULL, *obj_data = NULL, *queuetype = NULL, *r = obj_fifo;
 	char *data = NULL, *p = obj_properties;
-	uint32_t i_token = 0, queuetype_len = 0, reader_len = 0, nbr_of_tokens = 0, size = 0;
+	uint32_t pos = 0, queuetype_len = 0, reader_len = 0, nbr_of_tokens = 0, size = 0;
 
 	if (cc_platform_mem_alloc((void **)&fifo, sizeof(cc_fifo_t)) != CC_SUCCESS) {
 		cc_log_error("Failed to allocate memory");
@@ -34,9 +126,12 @@ cc_fifo_t *cc_fifo_init(char *obj_fifo, char* obj_properties)
 	}
 
 	fifo->size = 0;
+	fifo->length = 0;
 	fifo->write_pos = 0;
 	fifo->read_pos = 0;
 	fifo->tentative_read_pos = 0;
+	fifo->nacked = 0;
+	fifo->full_count = 0;
 
 	if (obj_fifo != NULL && cc_coder_decode_string_from_map(r, "queuetype", &queuetype, &queuetype_len) != CC_SUCCESS)
 		return NULL;
@@ -46,20 +141,18 @@ cc_fifo_t *cc_fifo_init(char *obj_fifo, char* obj_properties)
 		return NULL;
 	}
 
-	if (obj_fifo != NULL && cc_coder_decode_uint_from_map(r, "N", &fifo->size) != CC_SUCCESS)
-		return NULL;
+	// N includes the slot that is always kept free
+	if (obj_fifo != NULL) {
+		if (cc_coder_decode_uint_from_map(r, "N", &size) != CC_SUCCESS || size < 2)
+			return NULL;
+		size--;
+	}
 
-	if (obj_fifo == NULL && cc_coder_decode_uint_from_map(p, "queue_length", &fifo->size) != CC_SUCCESS)
-		fifo->size = 4;
+	if (obj_fifo == NULL && cc_coder_decode_uint_from_map(p, "queue_length", &size) != CC_SUCCESS)
+		size = CC_PORT_QUEUE_LENGTH;
 
-	if (cc_platform_mem_alloc((void **)&fifo->tokens, sizeof(cc_token_t) * fifo->size) != CC_SUCCESS) {
-		cc_log_error("Failed to allocate memory");
+	if (cc_fifo_alloc_tokens(fifo, size) != CC_SUCCESS)
 		return NULL;
-	}
-	for (i_token = 0; i_token < fifo->size; i_token++) {
-		fifo->tokens[i_token].value = NULL;
-		fifo->tokens[i_token].size = 0;
-	}
 
 	// When init without previous queue state done
 	if (obj_fifo == NULL)
@@ -94,10 +187,16 @@ cc_fifo_t *cc_fifo_init(char *obj_fifo, char* obj_properties)
 	if (result == CC_SUCCESS)
 		result = cc_coder_decode_uint_from_map(obj_read_pos, tmp_reader, &fifo->read_pos);
 
-	if (cc_coder_get_value_from_map(r, "fifo", &obj_tokens) == CC_SUCCESS) {
+	if (result == CC_SUCCESS && fifo->write_pos - fifo->read_pos > fifo->length) {
+		cc_log_error("Invalid fifo positions");
+		result = CC_FAIL;
+	}
+
+	// the serialized slots are indexed by position modulo N, remap the unread tokens
+	if (result == CC_SUCCESS && cc_coder_get_value_from_map(r, "fifo", &obj_tokens) == CC_SUCCESS) {
 		nbr_of_tokens = cc_coder_get_size_of_array(obj_tokens);
-		for (i_token = 0; i_token < nbr_of_tokens; i_token++) {
-			if (cc_coder_get_value_from_array(obj_tokens, i_token, &obj_token) != CC_SUCCESS) {
+		for (pos = fifo->read_pos; nbr_of_tokens > 0 && pos != fifo->write_pos; pos++) {
+			if (cc_coder_get_value_from_array(obj_tokens, pos % nbr_of_tokens, &obj_token) != CC_SUCCESS) {
 				result = CC_FAIL;
 				break;
 			}
@@ -107,16 +206,14 @@ cc_fifo_t *cc_fifo_init(char *obj_fifo, char* obj_properties)
 				break;
 			}
 
-			if (fifo->read_pos != fifo->tentative_read_pos || fifo->write_pos != fifo->read_pos) {
-				size = cc_coder_get_size_of_value(obj_data);
-				if (cc_platform_mem_alloc((void **)&data, size) != CC_SUCCESS) {
-					cc_log_error("Failed to allocate memory");
-					result = CC_FAIL;
-					break;
-				}
-				memcpy(data, obj_data, size);
-				cc_token_set_data(&fifo->tokens[i_token], data, size);
+			size = cc_coder_get_size_of_value(obj_data);
+			if (cc_platform_mem_alloc((void **)&data, size) != CC_SUCCESS) {
+				cc_log_error("Failed to allocate memory");
+				result = CC_FAIL;
+				break;
 			}
+			memcpy(data, obj_data, size);
+			cc_token_set_data(&fifo->tokens[CC_FIFO_INDEX(fifo, pos)], data, size);
 		}
 	}
 
@@ -129,31 +226,26 @@ cc_fifo_t *cc_fifo_init(char *obj_fifo, char* obj_properties)
 	return fifo;
 }
 
-cc_fifo_t *cc_fifo_init_empty()
+cc_fifo_t *cc_fifo_init_empty(uint32_t length)
 {
 	cc_fifo_t *fifo = NULL;
-	uint32_t i_token = 0;
 
 	if (cc_platform_mem_alloc((void **)&fifo, sizeof(cc_fifo_t)) != CC_SUCCESS) {
 		cc_log_error("Failed to allocate memory");
 		return NULL;
 	}
 
-	fifo->size = 4;
 	fifo->write_pos = 0;
 	fifo->read_pos = 0;
 	fifo->tentative_read_pos = 0;
+	fifo->nacked = 0;
+	fifo->full_count = 0;
 
-	if (cc_platform_mem_alloc((void **)&fifo->tokens, sizeof(cc_token_t) * fifo->size) != CC_SUCCESS) {
-		cc_log_error("Failed to allocate memory");
+	if (cc_fifo_alloc_tokens(fifo, length) != CC_SUCCESS) {
+		cc_platform_mem_free((void *)fifo);
 		return NULL;
 	}
 
-	for (i_token = 0; i_token < fifo->size; i_token++) {
-		fifo->tokens[i_token].value = NULL;
-		fifo->tokens[i_token].size = 0;
-	}
-
 	return fifo;
 }
 
@@ -165,6 +257,7 @@ void cc_fifo_free(cc_fifo_t *fifo)
 		cc_token_free(&fifo->tokens[i_token]);
 	cc_platform_mem_free((void *)fifo->tokens);
 	fifo->size = 0;
+	fifo->length = 0;
 	fifo->write_pos = 0;
 	fifo->read_pos = 0;
 	fifo->tentative_read_pos = 0;
@@ -174,6 +267,7 @@ void cc_fifo_free(cc_fifo_t *fifo)
 void cc_fifo_cancel(cc_fifo_t *fifo)
 {
 	fifo->tentative_read_pos = fifo->read_pos;
+	fifo->nacked = 0;
 }
 
 cc_token_t *cc_fifo_peek(cc_fifo_t *fifo)
@@ -182,17 +276,18 @@ cc_token_t *cc_fifo_peek(cc_fifo_t *fifo)
 
 	read_pos = fifo->tentative_read_pos;
 	fifo->tentative_read_pos = read_pos + 1;
-	return &fifo->tokens[read_pos % fifo->size];
+	return &fifo->tokens[CC_FIFO_INDEX(fifo, read_pos)];
 }
 
 void cc_fifo_commit_read(cc_fifo_t *fifo, bool free_token)
 {
 	if (fifo->read_pos < fifo->tentative_read_pos) {
 		if (free_token)
-			cc_token_free(&fifo->tokens[fifo->read_pos % fifo->size]);
+			cc_token_free(&fifo->tokens[CC_FIFO_INDEX(fifo, fifo->read_pos)]);
 		else {
-			fifo->tokens[fifo->read_pos % fifo->size].value = NULL;
-			fifo->tokens[fifo->read_pos % fifo->size].size = 0;
+			fifo->tokens[CC_FIFO_INDEX(fifo, fifo->read_pos)].value = NULL;
+			fifo->tokens[CC_FIFO_INDEX(fifo, fifo->read_pos)].size = 0;
+			fifo->tokens[CC_FIFO_INDEX(fifo, fifo->read_pos)].rx_buffer = NULL;
 		}
 		fifo->read_pos++;
 	} else
@@ -206,7 +301,7 @@ void cc_fifo_cancel_commit(cc_fifo_t *fifo)
 
 bool cc_fifo_slots_available(const cc_fifo_t *fifo, uint32_t length)
 {
-	return (fifo->size - ((fifo->write_pos - fifo->read_pos) % fifo->size) - 1) >= length;
+	return fifo->length - (fifo->write_pos - fifo->read_pos) >= length;
 }
 
 bool cc_fifo_tokens_available(const cc_fifo_t *fifo, uint32_t length)
@@ -216,15 +311,45 @@ bool cc_fifo_tokens_available(const cc_fifo_t *fifo, uint32_t length)
 
 cc_result_t cc_fifo_write(cc_fifo_t *fifo, char *data, const size_t size)
 {
-	if (!cc_fifo_slots_available(fifo, 1))
+	if (!cc_fifo_write_slot_available(fifo))
+		return CC_FAIL;
+
+	cc_token_set_data(&fifo->tokens[CC_FIFO_INDEX(fifo, fifo->write_pos)], data, size);
+	fifo->write_pos++;
+
+	return CC_SUCCESS;
+}
+
+cc_result_t cc_fifo_write_token(cc_fifo_t *fifo, cc_token_t *token)
+{
+	if (!cc_fifo_write_slot_available(fifo))
 		return CC_FAIL;
 
-	cc_token_set_data(&fifo->tokens[fifo->write_pos % fifo->size], data, size);
+	cc_token_move(&fifo->tokens[CC_FIFO_INDEX(fifo, fifo->write_pos)], token);
 	fifo->write_pos++;
 
 	return CC_SUCCESS;
 }
 
+// The serialized fifo has one slot more than the queue length, kept free,
+// and tokens in slot position modulo the number of slots
+uint32_t cc_fifo_get_serialized_slots(const cc_fifo_t *fifo)
+{
+	return fifo->length + 1;
+}
+
+// Token in slot index of the serialized fifo, NULL if the slot is empty
+cc_token_t *cc_fifo_get_serialized_token(cc_fifo_t *fifo, uint32_t index)
+{
+	uint32_t slots = fifo->length + 1;
+	uint32_t offset = (index + slots - fifo->read_pos % slots) % slots;
+
+	if (offset >= fifo->write_pos - fifo->read_pos)
+		return NULL;
+
+	return &fifo->tokens[CC_FIFO_INDEX(fifo, fifo->read_pos + offset)];
+}
+
 void cc_fifo_com_peek(cc_fifo_t *fifo, cc_token_t **token, uint32_t *sequence_nbr)
 {
 	*sequence_nbr = fifo->tentative_read_pos;
@@ -233,37 +358,121 @@ void cc_fifo_com_peek(cc_fifo_t *fifo, cc_token_t **token, uint32_t *sequence_nb
 
 cc_result_t cc_fifo_com_write(cc_fifo_t *fifo, char *data, size_t size, uint32_t sequence_nbr)
 {
-	if (sequence_nbr >= fifo->write_pos) { // TODO: Should be sequence_nbr == fifo->write_pos
-		cc_fifo_write(fifo, data, size);
+	return cc_fifo_com_write_ref(fifo, data, size, NULL, sequence_nbr);
+}
+
+// Tokens are only accepted in order, a duplicate is not written and the
+// caller keeps the data, a token after a missing one is rejected so the
+// sender resends from the missing one
+cc_result_t cc_fifo_com_write_ref(cc_fifo_t *fifo, char *data, size_t size, struct cc_transport_rx_buffer_t *rx_buffer, uint32_t sequence_nbr)
+{
+	if (cc_fifo_com_is_duplicate(fifo, sequence_nbr)) {
+		cc_log_debug("Duplicate token with sequencenbr '%ld'", (unsigned long)sequence_nbr);
 		return CC_SUCCESS;
 	}
 
-	cc_log_error("Unhandled token with sequencenbr '%ld' with write_pos '%ld'", (unsigned long)sequence_nbr, (unsigned long)fifo->write_pos);
+	if (sequence_nbr != fifo->write_pos) {
+		cc_log_debug("Token with sequencenbr '%ld' out of order, expected '%ld'", (unsigned long)sequence_nbr, (unsigned long)fifo->write_pos);
+		return CC_FAIL;
+	}
+
+	if (!cc_fifo_write_slot_available(fifo))
+		return CC_FAIL;
+
+	cc_token_set_ref(&fifo->tokens[CC_FIFO_INDEX(fifo, fifo->write_pos)], data, size, rx_buffer);
+	fifo->write_pos++;
 
 	return CC_SUCCESS;
 }
 
+bool cc_fifo_com_is_duplicate(const cc_fifo_t *fifo, uint32_t sequence_nbr)
+{
+	return sequence_nbr < fifo->write_pos;
+}
+
+uint32_t cc_fifo_com_in_flight(const cc_fifo_t *fifo)
+{
+	return fifo->tentative_read_pos - fifo->read_pos;
+}
+
 void cc_fifo_com_commit_read(cc_fifo_t *fifo, uint32_t sequence_nbr)
 {
-	if (sequence_nbr >= fifo->tentative_read_pos)
+	if (sequence_nbr < fifo->read_pos) {
+		cc_log_debug("Token '%ld' already committed", (unsigned long)sequence_nbr);
 		return;
+	}
 
-	if (fifo->read_pos < fifo->tentative_read_pos) {
-		if (sequence_nbr == fifo->read_pos) {
-			cc_token_free(&fifo->tokens[fifo->read_pos % fifo->size]);
-			fifo->read_pos++;
-			return;
-		}
+	if (sequence_nbr >= fifo->tentative_read_pos) {
+		cc_log_error("Unhandled commit");
+		return;
 	}
 
-	cc_log_error("Unhandled commit");
+	// cumulative, commits all tokens up to and including sequence_nbr
+	while (fifo->read_pos <= sequence_nbr) {
+		cc_token_free(&fifo->tokens[CC_FIFO_INDEX(fifo, fifo->read_pos)]);
+		fifo->read_pos++;
+		fifo->nacked >>= 1;
+	}
 }
 
 void cc_fifo_com_cancel_read(cc_fifo_t *fifo, uint32_t sequence_nbr)
 {
-	if (sequence_nbr >= fifo->tentative_read_pos && sequence_nbr < fifo->read_pos) {
+	// only tokens in flight can be resent, read_pos <= tentative_read_pos must hold
+	if (sequence_nbr < fifo->read_pos || sequence_nbr > fifo->tentative_read_pos) {
 		cc_log_error("Invalid cancel");
 		return;
 	}
 	fifo->tentative_read_pos = sequence_nbr;
+	if (sequence_nbr - fifo->read_pos < CC_FIFO_MAX_NACKED)
+		fifo->nacked &= ((uint32_t)1 << (sequence_nbr - fifo->read_pos)) - 1;
+}
+
+// Nacks first to last, the range is clamped to the tokens in flight
+void cc_fifo_com_nack_read(cc_fifo_t *fifo, uint32_t first, uint32_t last)
+{
+	uint32_t sequence_nbr = 0;
+
+	if (first < fifo->read_pos)
+		first = fifo->read_pos;
+	if (last >= fifo->tentative_read_pos)
+		last = fifo->tentative_read_pos - 1;
+
+	if (first >= fifo->tentative_read_pos || first > last) {
+		cc_log_debug("Ignoring nack of tokens '%ld' to '%ld'", (unsigned long)first, (unsigned long)last);
+		return;
+	}
+
+	for (sequence_nbr = first; sequence_nbr <= last; sequence_nbr++) {
+		if (sequence_nbr - fifo->read_pos >= CC_FIFO_MAX_NACKED) {
+			// outside of the tracked window, resend everything after it
+			fifo->tentative_read_pos = sequence_nbr;
+			return;
+		}
+		fifo->nacked |= (uint32_t)1 << (sequence_nbr - fifo->read_pos);
+	}
+}
+
+bool cc_fifo_com_peek_nacked(cc_fifo_t *fifo, cc_token_t **token, uint32_t *sequence_nbr)
+{
+	uint32_t i = 0;
+
+	for (i = 0; i < CC_FIFO_MAX_NACKED && fifo->read_pos + i < fifo->tentative_read_pos; i++) {
+		if (fifo->nacked & ((uint32_t)1 << i)) {
+			fifo->nacked &= ~((uint32_t)1 << i);
+			*sequence_nbr = fifo->read_pos + i;
+			*token = &fifo->tokens[CC_FIFO_INDEX(fifo, *sequence_nbr)];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Get the in-flight token with sequence_nbr, NULL if it is not in flight
+cc_token_t *cc_fifo_com_get(cc_fifo_t *fifo, uint32_t sequence_nbr)
+{
+	if (sequence_nbr < fifo->read_pos || sequence_nbr >= fifo->tentative_read_pos)
+		return NULL;
+
+	return &fifo->tokens[CC_FIFO_INDEX(fifo, sequence_nbr)];
 }
@@ -20,16 +20,22 @@
 #include "cc_common.h"
 #include "cc_token.h"
 
+// Number of in-flight tokens tracked for selective resend
+#define CC_FIFO_MAX_NACKED	32
+
 typedef struct cc_fifo_t {
-	uint32_t size;
+	uint32_t size; // number of slots, a power of two
+	uint32_t length; // number of usable slots, the queue length
 	uint32_t write_pos;
 	uint32_t read_pos;
 	uint32_t tentative_read_pos;
+	uint32_t nacked; // bit n set when token read_pos + n is nacked and should be resent
+	uint32_t full_count; // number of writes failing on a full fifo since it was last empty
 	cc_token_t *tokens;
 } cc_fifo_t;
 
 cc_fifo_t *cc_fifo_init(char *obj_fifo, char *obj_properties);
-cc_fifo_t *cc_fifo_init_empty();
+cc_fifo_t *cc_fifo_init_empty(uint32_t length);
 void cc_fifo_free(cc_fifo_t *fifo);
 void cc_fifo_cancel(cc_fifo_t *fifo);
 cc_token_t *cc_fifo_peek(cc_fifo_t *fifo);
@@ -38,9 +44,18 @@ void cc_fifo_cancel_commit(cc_fifo_t *fifo);
 bool cc_fifo_slots_available(const cc_fifo_t *fifo, uint32_t length);
 bool cc_fifo_tokens_available(const cc_fifo_t *fifo, uint32_t length);
 cc_result_t cc_fifo_write(cc_fifo_t *fifo, char *data, const size_t size);
+cc_result_t cc_fifo_write_token(cc_fifo_t *fifo, cc_token_t *token);
+uint32_t cc_fifo_get_serialized_slots(const cc_fifo_t *fifo);
+cc_token_t *cc_fifo_get_serialized_token(cc_fifo_t *fifo, uint32_t index);
 void cc_fifo_com_peek(cc_fifo_t *fifo, cc_token_t **token, uint32_t *sequence_nbr);
 cc_result_t cc_fifo_com_write(cc_fifo_t *fifo, char *data, size_t size, uint32_t sequence_nbr);
+cc_result_t cc_fifo_com_write_ref(cc_fifo_t *fifo, char *data, size_t size, struct cc_transport_rx_buffer_t *rx_buffer, uint32_t sequence_nbr);
+bool cc_fifo_com_is_duplicate(const cc_fifo_t *fifo, uint32_t sequence_nbr);
+uint32_t cc_fifo_com_in_flight(const cc_fifo_t *fifo);
 void cc_fifo_com_commit_read(cc_fifo_t *fifo, uint32_t sequence_nbr);
 void cc_fifo_com_cancel_read(cc_fifo_t *fifo, uint32_t sequence_nbr);
+void cc_fifo_com_nack_read(cc_fifo_t *fifo, uint32_t first, uint32_t last);
+bool cc_fifo_com_peek_nacked(cc_fifo_t *fifo, cc_token_t **token, uint32_t *sequence_nbr);
+cc_token_t *cc_fifo_com_get(cc_fifo_t *fifo, uint32_t sequence_nbr);
 
 #endif /* CC_FIFO_H */
@@ -46,6 +46,15 @@ cc_link_t *cc_link_create(cc_node_t *node, const char *peer_id, uint32_t peer_id
 		return NULL;
 	}
 
+	if (cc_index_add(&node->link_index, link->peer_id, strnlen(link->peer_id, CC_UUID_BUFFER_SIZE), link) != CC_SUCCESS) {
+		cc_log_error("Failed to index link");
+		cc_list_remove(&node->links, link->peer_id);
+		cc_platform_mem_free((void *)link);
+		return NULL;
+	}
+
+	cc_node_set_dirty(node);
+
 	if (link->is_proxy)
 		cc_log("Link: Created to proxy '%s'", link->peer_id);
 	else
@@ -54,6 +63,13 @@ cc_link_t *cc_link_create(cc_node_t *node, const char *peer_id, uint32_t peer_id
 	return link;
 }
 
+size_t cc_link_get_serialized_size(const cc_link_t *link)
+{
+	return cc_coder_sizeof_map(2) +
+		cc_coder_sizeof_key("peer_id") + cc_coder_sizeof_str(strnlen(link->peer_id, CC_UUID_BUFFER_SIZE)) +
+		cc_coder_sizeof_key("is_proxy") + cc_coder_sizeof_bool(link->is_proxy);
+}
+
 char *cc_link_serialize(const cc_link_t *link, char *buffer)
 {
 	buffer = cc_coder_encode_map(buffer, 2);
@@ -84,7 +100,9 @@ void cc_link_free(cc_node_t *node, cc_link_t *link)
 {
 	cc_log("Link: Deleting link to '%s'", link->peer_id);
 	cc_list_remove(&node->links, link->peer_id);
+	cc_index_remove(&node->link_index, link->peer_id, strnlen(link->peer_id, CC_UUID_BUFFER_SIZE), link);
 	cc_platform_mem_free((void *)link);
+	cc_node_set_dirty(node);
 }
 
 void cc_link_add_ref(cc_link_t *link)
@@ -107,15 +125,5 @@ void cc_link_remove_ref(cc_node_t *node, cc_link_t *link)
 
 cc_link_t *cc_link_get(cc_node_t *node, const char *peer_id, uint32_t peer_id_len)
 {
-	cc_list_t *links = node->links;
-	cc_link_t *link = NULL;
-
-	while (links != NULL) {
-		link = (cc_link_t *)links->data;
-		if (strncmp(link->peer_id, peer_id, peer_id_len) == 0)
-			return link;
-		links = links->next;
-	}
-
-	return NULL;
+	return (cc_link_t *)cc_index_get(&node->link_index, peer_id, peer_id_len);
 }
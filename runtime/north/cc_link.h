@@ -29,6 +29,7 @@ typedef struct cc_link_t {
 } cc_link_t;
 
 cc_link_t *cc_link_create(struct cc_node_t *node, const char *peer_id, uint32_t peer_id_len, bool is_proxy);
+size_t cc_link_get_serialized_size(const cc_link_t *link);
 char *cc_link_serialize(const cc_link_t *link, char *buffer);
 cc_link_t *cc_link_deserialize(struct cc_node_t *node, char *buffer);
 void cc_link_free(struct cc_node_t *node, cc_link_t *link);
@@ -37,27 +37,88 @@
 #include "jsmn/jsmn.h"
 #include "cc_app_manager.h"
 
-#define CONNECT_TIMEOUT 10
+#define CONNECT_TIMEOUT 10000
 
 #if CC_USE_STORAGE
-static cc_result_t cc_node_get_state(cc_node_t *node)
+#if CC_USE_CHECKPOINTING
+// The journal is kept next to the state file
+static void cc_node_journal_file(const cc_node_t *node, char *path)
 {
-	char *buffer = NULL, *value = NULL, *array_value = NULL;
-	char *tmp = NULL;
-	uint32_t i = 0, value_len = 0, array_size = 0, state = 0;
-	cc_link_t *link = NULL;
-	cc_tunnel_t *tunnel = NULL;
-	cc_actor_t *actor = NULL;
-	size_t size;
+	strcpy(path, node->state_file);
+	strcat(path, CC_NODE_JOURNAL_SUFFIX);
+}
 
-	if (cc_platform_file_read(CC_STATE_FILE, &buffer, &size) != CC_SUCCESS)
-		return CC_FAIL;
+static void cc_node_free_removed(cc_node_t *node)
+{
+	cc_list_t *item = NULL;
 
-	cc_log("Node: Starting from state");
+	while (node->checkpoint_removed != NULL) {
+		item = node->checkpoint_removed;
+		node->checkpoint_removed = item->next;
+		cc_platform_mem_free((void *)item->id);
+		cc_platform_mem_free((void *)item);
+	}
+}
+
+// Reads the journal if it was written for the state file, a record cut short
+// by a crash ends the journal
+static void cc_node_read_journal(cc_node_t *node, char *state, char **journal, size_t *journal_size)
+{
+	char path[strlen(node->state_file) + sizeof(CC_NODE_JOURNAL_SUFFIX)];
+	char *buffer = NULL;
+	size_t size = 0, offset = 0, record_size = 0;
+	uint32_t epoch = 0;
+
+	if (cc_coder_has_key(state, "checkpoint_epoch"))
+		cc_coder_decode_uint_from_map(state, "checkpoint_epoch", &node->checkpoint_epoch);
+
+	cc_node_journal_file(node, path);
+	if (cc_platform_file_stat(path) != CC_STAT_FILE)
+		return;
+
+	if (cc_platform_file_read(path, &buffer, &size) != CC_SUCCESS)
+		return;
+
+	// the first record holds the epoch of the state file
+	record_size = cc_coder_check_value(buffer, size);
+	if (record_size == 0 || cc_coder_decode_uint_from_map(buffer, "epoch", &epoch) != CC_SUCCESS || epoch != node->checkpoint_epoch) {
+		cc_log("Node: Ignoring journal of previous state");
+		cc_platform_mem_free(buffer);
+		return;
+	}
+
+	offset = record_size;
+	while (offset < size) {
+		record_size = cc_coder_check_value(buffer + offset, size - offset);
+		if (record_size == 0) {
+			cc_log_error("Ignoring incomplete journal record");
+			break;
+		}
+		offset += record_size;
+	}
+
+	*journal = buffer;
+	*journal_size = offset;
+}
+#endif
+
+static cc_result_t cc_node_restore_state(cc_node_t *node, char *buffer, char *journal, size_t journal_size)
+{
+	char *value = NULL, *array_value = NULL, *id = NULL;
+	char *tmp = NULL, *root = buffer;
+	uint32_t i = 0, value_len = 0, array_size = 0, state = 0, id_len = 0;
+	cc_link_t *link = NULL;
+	cc_tunnel_t *tunnel = NULL;
+	cc_list_t *actors = NULL, *item = NULL;
+	cc_result_t result = CC_SUCCESS;
+#if CC_USE_CHECKPOINTING
+	char removed_id[CC_UUID_BUFFER_SIZE];
+	char *record = NULL;
+	size_t offset = 0;
+#endif
 
 	if (cc_coder_decode_string_from_map(buffer, "id", &value, &value_len) != CC_SUCCESS) {
 		cc_log_error("Failed to decode 'id'");
-		cc_platform_mem_free(buffer);
 		return CC_FAIL;
 	}
 	strncpy(node->id, value, value_len);
@@ -72,13 +133,11 @@ static cc_result_t cc_node_get_state(cc_node_t *node)
 		if (cc_coder_type_of(tmp) == CC_CODER_STR) {
 			if (cc_coder_decode_string_from_map(buffer, "attributes", &value, &value_len) != CC_SUCCESS) {
 				cc_log_error("Failed to decode 'attributes'");
-				cc_platform_mem_free(buffer);
 				return CC_FAIL;
 			}
 
 			if (cc_platform_mem_alloc((void **)&node->attributes, value_len + 1) != CC_SUCCESS) {
 				cc_log_error("Failed to allocate memory");
-				cc_platform_mem_free(buffer);
 				return CC_FAIL;
 			}
 
@@ -94,7 +153,6 @@ static cc_result_t cc_node_get_state(cc_node_t *node)
 				if (cc_coder_decode_string_from_array(array_value, i, &value, &value_len) == CC_SUCCESS) {
 					if (cc_list_add_n(&node->proxy_uris, value, value_len, NULL, 0) == NULL) {
 						cc_log_error("Failed to add uri");
-						cc_platform_mem_free(buffer);
 						return CC_FAIL;
 					}
 				}
@@ -102,8 +160,17 @@ static cc_result_t cc_node_get_state(cc_node_t *node)
 		}
 	}
 
-	if (cc_coder_has_key(buffer, "state")) {
-		if (cc_coder_decode_uint_from_map(buffer, "state", &state) == CC_SUCCESS) {
+#if CC_USE_CHECKPOINTING
+	// links, tunnels and state from the last journal record with them
+	for (offset = 0; offset < journal_size; offset += cc_coder_get_size_of_value(record)) {
+		record = journal + offset;
+		if (cc_coder_has_key(record, "node"))
+			cc_coder_get_value_from_map(record, "node", &root);
+	}
+#endif
+
+	if (cc_coder_has_key(root, "state")) {
+		if (cc_coder_decode_uint_from_map(root, "state", &state) == CC_SUCCESS) {
 			if (state == CC_NODE_DO_SLEEP)
 				node->state = CC_NODE_STARTED;
 			else
@@ -111,67 +178,285 @@ static cc_result_t cc_node_get_state(cc_node_t *node)
 		}
 	}
 
-	if (cc_coder_has_key(buffer, "links")) {
-		if (cc_coder_get_value_from_map(buffer, "links", &array_value) == CC_SUCCESS) {
+	if (cc_coder_has_key(root, "links")) {
+		if (cc_coder_get_value_from_map(root, "links", &array_value) == CC_SUCCESS) {
 			array_size = cc_coder_get_size_of_array(array_value);
 			for (i = 0; i < array_size; i++) {
 				if (cc_coder_get_value_from_array(array_value, i, &value) == CC_SUCCESS) {
 					link = cc_link_deserialize(node, value);
-					if (link == NULL) {
-						cc_platform_mem_free(buffer);
+					if (link == NULL)
 						return CC_FAIL;
-					} else {
-						if (link->is_proxy) {
-							node->proxy_link = link;
-							cc_log(" Proxy: %s", link->peer_id);
-						}
+					if (link->is_proxy) {
+						node->proxy_link = link;
+						cc_log(" Proxy: %s", link->peer_id);
 					}
 				}
 			}
 		}
 	}
 
-	if (cc_coder_has_key(buffer, "tunnels")) {
-		if (cc_coder_get_value_from_map(buffer, "tunnels", &array_value) == CC_SUCCESS) {
+	if (cc_coder_has_key(root, "tunnels")) {
+		if (cc_coder_get_value_from_map(root, "tunnels", &array_value) == CC_SUCCESS) {
 			array_size = cc_coder_get_size_of_array(array_value);
 			for (i = 0; i < array_size; i++) {
 				if (cc_coder_get_value_from_array(array_value, i, &value) == CC_SUCCESS) {
 					tunnel = cc_tunnel_deserialize(node, value);
-					if (tunnel == NULL) {
-						cc_platform_mem_free(buffer);
+					if (tunnel == NULL)
 						return CC_FAIL;
-					} else {
-						if (tunnel->type == CC_TUNNEL_TYPE_STORAGE) {
-							node->storage_tunnel = tunnel;
-							cc_log(" Storage tunnel: %s", node->storage_tunnel->id);
-						} else if (tunnel->type == CC_TUNNEL_TYPE_PROXY) {
-							node->proxy_tunnel = tunnel;
-							cc_log(" Proxy tunnel: %s", node->proxy_tunnel->id);
-						}
+					if (tunnel->type == CC_TUNNEL_TYPE_STORAGE) {
+						node->storage_tunnel = tunnel;
+						cc_log(" Storage tunnel: %s", node->storage_tunnel->id);
+					} else if (tunnel->type == CC_TUNNEL_TYPE_PROXY) {
+						node->proxy_tunnel = tunnel;
+						cc_log(" Proxy tunnel: %s", node->proxy_tunnel->id);
 					}
 				}
 			}
 		}
 	}
 
+	// actors are collected by id so journal records can replace them
 	if (cc_coder_has_key(buffer, "actors")) {
 		if (cc_coder_get_value_from_map(buffer, "actors", &array_value) == CC_SUCCESS) {
 			array_size = cc_coder_get_size_of_array(array_value);
-			for (i = 0; i < array_size; i++) {
-				if (cc_coder_get_value_from_array(array_value, i, &value) == CC_SUCCESS) {
-					actor = cc_actor_create(node, value);
-					if (actor == NULL) {
-						cc_platform_mem_free(buffer);
-						return CC_FAIL;
-					}
-				}
+			for (i = 0; i < array_size && result == CC_SUCCESS; i++) {
+				if (cc_coder_get_value_from_array(array_value, i, &value) != CC_SUCCESS)
+					continue;
+				if (!cc_coder_has_key(value, "id")) {
+					// state written before actors had ids
+					if (cc_actor_create(node, value) == NULL)
+						result = CC_FAIL;
+				} else if (cc_coder_decode_string_from_map(value, "id", &id, &id_len) != CC_SUCCESS) {
+					cc_log_error("Failed to decode 'id'");
+					result = CC_FAIL;
+				} else if (cc_list_add_n(&actors, id, id_len, value, 0) == NULL)
+					result = CC_FAIL;
 			}
 		}
 	}
 
-	cc_platform_mem_free(buffer);
+#if CC_USE_CHECKPOINTING
+	for (offset = 0; offset < journal_size && result == CC_SUCCESS; offset += cc_coder_get_size_of_value(record)) {
+		record = journal + offset;
+		if (cc_coder_has_key(record, "actor")) {
+			if (cc_coder_get_value_from_map(record, "actor", &value) != CC_SUCCESS ||
+				cc_coder_decode_string_from_map(value, "id", &id, &id_len) != CC_SUCCESS) {
+				cc_log_error("Failed to decode journal record");
+				result = CC_FAIL;
+			} else if ((item = cc_list_get_n(actors, id, id_len)) != NULL)
+				item->data = value;
+			else if (cc_list_add_n(&actors, id, id_len, value, 0) == NULL)
+				result = CC_FAIL;
+		} else if (cc_coder_has_key(record, "removed")) {
+			if (cc_coder_decode_string_from_map(record, "removed", &id, &id_len) == CC_SUCCESS && id_len < CC_UUID_BUFFER_SIZE) {
+				strncpy(removed_id, id, id_len);
+				removed_id[id_len] = '\0';
+				cc_list_remove(&actors, removed_id);
+			}
+		}
+	}
+#endif
 
-	return CC_SUCCESS;
+	// actors are created when first used or when the node is idle
+	if (result == CC_SUCCESS) {
+		node->restore_actors = actors;
+		actors = NULL;
+	}
+
+	while (actors != NULL) {
+		item = actors;
+		actors = actors->next;
+		cc_platform_mem_free((void *)item->id);
+		cc_platform_mem_free((void *)item);
+	}
+
+	return result;
+}
+
+static cc_result_t cc_node_get_state(cc_node_t *node)
+{
+	char *buffer = NULL, *journal = NULL;
+	size_t size = 0, journal_size = 0;
+	cc_result_t result = CC_SUCCESS;
+
+	if (cc_platform_file_map(node->state_file, &buffer, &size) != CC_SUCCESS)
+		return CC_FAIL;
+
+	cc_log("Node: Starting from state");
+
+#if CC_USE_CHECKPOINTING
+	cc_node_read_journal(node, buffer, &journal, &journal_size);
+#endif
+
+	result = cc_node_restore_state(node, buffer, journal, journal_size);
+
+	// the records of actors not created yet point into the buffers
+	if (result == CC_SUCCESS && node->restore_actors != NULL) {
+		node->restore_state = buffer;
+		node->restore_state_size = size;
+		node->restore_journal = journal;
+		return CC_SUCCESS;
+	}
+
+	if (journal != NULL)
+		cc_platform_mem_free(journal);
+	cc_platform_file_unmap(buffer, size);
+
+	return result;
+}
+
+// Drops actors not created yet and releases the state they were restored from
+static void cc_node_restore_release(cc_node_t *node)
+{
+	cc_list_t *item = NULL;
+
+	while (node->restore_actors != NULL) {
+		item = node->restore_actors;
+		node->restore_actors = item->next;
+		cc_platform_mem_free((void *)item->id);
+		cc_platform_mem_free((void *)item);
+	}
+
+	if (node->restore_journal != NULL) {
+		cc_platform_mem_free(node->restore_journal);
+		node->restore_journal = NULL;
+	}
+
+	if (node->restore_state != NULL) {
+		cc_platform_file_unmap(node->restore_state, node->restore_state_size);
+		node->restore_state = NULL;
+		node->restore_state_size = 0;
+	}
+}
+
+// Creates the restored actor of item, item is unlinked first as creating the
+// actor looks up actors and ports
+static cc_result_t cc_node_restore_item(cc_node_t *node, cc_list_t *item)
+{
+	cc_list_t **prev = &node->restore_actors;
+	cc_actor_t *actor = NULL;
+
+	while (*prev != item)
+		prev = &(*prev)->next;
+	*prev = item->next;
+
+	actor = cc_actor_create(node, (char *)item->data);
+	if (actor == NULL)
+		cc_log_error("Failed to restore actor '%s'", item->id);
+#if CC_USE_CHECKPOINTING
+	else
+		actor->dirty = false; // as in the state file
+#endif
+
+	cc_platform_mem_free((void *)item->id);
+	cc_platform_mem_free((void *)item);
+
+	if (node->restore_actors == NULL)
+		cc_node_restore_release(node);
+
+	return actor == NULL ? CC_FAIL : CC_SUCCESS;
+}
+
+cc_result_t cc_node_restore_actor(cc_node_t *node, const char *actor_id, uint32_t actor_id_len)
+{
+	cc_list_t *item = cc_list_get_n(node->restore_actors, actor_id, actor_id_len);
+
+	if (item == NULL)
+		return CC_FAIL;
+
+	return cc_node_restore_item(node, item);
+}
+
+// Creates the restored actor with the port, its ports are the keys of its
+// previous connections
+cc_result_t cc_node_restore_port(cc_node_t *node, const char *port_id, uint32_t port_id_len)
+{
+	cc_list_t *item = node->restore_actors;
+	char *state = NULL, *connections = NULL, *ports = NULL, *port = NULL;
+
+	while (item != NULL) {
+		if (cc_coder_get_value_from_map((char *)item->data, "state", &state) == CC_SUCCESS &&
+			cc_coder_get_value_from_map(state, "prev_connections", &connections) == CC_SUCCESS) {
+			if (cc_coder_get_value_from_map(connections, "inports", &ports) == CC_SUCCESS &&
+				cc_coder_get_value_from_map_n(ports, port_id, port_id_len, &port) == CC_SUCCESS)
+				return cc_node_restore_item(node, item);
+			if (cc_coder_get_value_from_map(connections, "outports", &ports) == CC_SUCCESS &&
+				cc_coder_get_value_from_map_n(ports, port_id, port_id_len, &port) == CC_SUCCESS)
+				return cc_node_restore_item(node, item);
+		}
+		item = item->next;
+	}
+
+	return CC_FAIL;
+}
+
+void cc_node_restore_actors(cc_node_t *node)
+{
+	while (node->restore_actors != NULL)
+		cc_node_restore_item(node, node->restore_actors);
+}
+
+static size_t cc_node_get_state_size(cc_node_t *node)
+{
+	cc_list_t *item = NULL;
+	size_t size = 0;
+
+	size += cc_coder_sizeof_key("state") + cc_coder_sizeof_uint(node->state);
+	size += cc_coder_sizeof_key("links") + cc_coder_sizeof_array(cc_list_count(node->links));
+	for (item = node->links; item != NULL; item = item->next)
+		size += cc_link_get_serialized_size((cc_link_t *)item->data);
+	size += cc_coder_sizeof_key("tunnels") + cc_coder_sizeof_array(cc_list_count(node->tunnels));
+	for (item = node->tunnels; item != NULL; item = item->next)
+		size += cc_tunnel_get_serialized_size((cc_tunnel_t *)item->data);
+
+	return size;
+}
+
+// Node state, links and tunnels as map items
+static char *cc_node_serialize_state(cc_node_t *node, char *buffer)
+{
+	cc_list_t *item = NULL;
+
+	buffer = cc_coder_encode_kv_uint(buffer, "state", node->state);
+
+	buffer = cc_coder_encode_kv_array(buffer, "links", cc_list_count(node->links));
+	{
+		item = node->links;
+		while (item != NULL) {
+			buffer = cc_link_serialize((cc_link_t *)item->data, buffer);
+			item = item->next;
+		}
+	}
+
+	buffer = cc_coder_encode_kv_array(buffer, "tunnels", cc_list_count(node->tunnels));
+	{
+		item = node->tunnels;
+		while (item != NULL) {
+			buffer = cc_tunnel_serialize((cc_tunnel_t *)item->data, buffer);
+			item = item->next;
+		}
+	}
+
+	return buffer;
+}
+
+// Size of the items written by cc_node_serialize_actor, 0 on failure
+static size_t cc_node_get_actor_size(cc_node_t *node, cc_actor_t *actor)
+{
+	size_t size = cc_actor_get_serialized_size(node, actor, true);
+
+	if (size == 0)
+		return 0;
+
+	return size + cc_coder_sizeof_key("id") + cc_coder_sizeof_str(strnlen(actor->id, CC_UUID_BUFFER_SIZE));
+}
+
+// Actor id and state as map items, NULL on failure
+static char *cc_node_serialize_actor(cc_node_t *node, cc_actor_t *actor, char *buffer)
+{
+	buffer = cc_coder_encode_kv_str(buffer, "id", actor->id, strnlen(actor->id, CC_UUID_BUFFER_SIZE));
+
+	return cc_actor_serialize(node, actor, buffer, true);
 }
 
 void cc_node_set_state(cc_node_t *node, bool include_state)
@@ -179,19 +464,50 @@ void cc_node_set_state(cc_node_t *node, bool include_state)
 	char *buffer = NULL, *tmp = NULL;
 	int nbr_of_attributes = 3, nbr_of_items = 0;
 	cc_list_t *item = NULL;
-	size_t buffer_size = 500;
+	size_t buffer_size = 0, size = 0;
+#if CC_USE_CHECKPOINTING
+	char journal[strlen(node->state_file) + sizeof(CC_NODE_JOURNAL_SUFFIX)];
+	uint32_t epoch = node->checkpoint_epoch + 1;
+
+	nbr_of_attributes++;
+#endif
+
+	buffer_size += cc_coder_sizeof_key("id") + cc_coder_sizeof_str(strlen(node->id));
+	buffer_size += cc_coder_sizeof_key("attributes");
+	if (node->attributes != NULL)
+		buffer_size += cc_coder_sizeof_str(strnlen(node->attributes, CC_MAX_ATTRIBUTES_LEN));
+	else
+		buffer_size += cc_coder_sizeof_nil();
+	buffer_size += cc_coder_sizeof_key("proxy_uris") + cc_coder_sizeof_array(cc_list_count(node->proxy_uris));
+	for (item = node->proxy_uris; item != NULL; item = item->next)
+		buffer_size += cc_coder_sizeof_str(strnlen(item->id, CC_MAX_URI_LEN));
+#if CC_USE_CHECKPOINTING
+	buffer_size += cc_coder_sizeof_key("checkpoint_epoch") + cc_coder_sizeof_uint(epoch);
+#endif
 
 	if (include_state) {
-		// TODO: Find better way to get buffer size when serializing actors
-		buffer_size += cc_list_count(node->actors) * 2000;
-		nbr_of_attributes = 7;
+		buffer_size += cc_node_get_state_size(node);
+		nbr_of_items = cc_list_count(node->actors) + cc_list_count(node->restore_actors);
+		buffer_size += cc_coder_sizeof_key("actors") + cc_coder_sizeof_array(nbr_of_items);
+		for (item = node->actors; item != NULL; item = item->next) {
+			size = cc_node_get_actor_size(node, (cc_actor_t *)item->data);
+			if (size == 0) {
+				cc_log_error("Failed to serialize state");
+				return;
+			}
+			buffer_size += cc_coder_sizeof_map(2) + size;
+		}
+		for (item = node->restore_actors; item != NULL; item = item->next)
+			buffer_size += cc_coder_get_size_of_value((char *)item->data);
+		nbr_of_attributes += 4;
 	}
 
+	buffer_size += cc_coder_sizeof_map(nbr_of_attributes);
+
 	if (cc_platform_mem_alloc((void **)&buffer, buffer_size) != CC_SUCCESS) {
 		cc_log_error("Failed to allocate memory");
 		return;
 	}
-	memset(buffer, 0, buffer_size);
 	tmp = buffer;
 
 	tmp = cc_coder_encode_map(tmp, nbr_of_attributes);
@@ -213,54 +529,238 @@ void cc_node_set_state(cc_node_t *node, bool include_state)
 				item = item->next;
 			}
 		}
+#if CC_USE_CHECKPOINTING
+		tmp = cc_coder_encode_kv_uint(tmp, "checkpoint_epoch", epoch);
+#endif
 
 		if (include_state) {
-			tmp = cc_coder_encode_kv_uint(tmp, "state", node->state);
+			tmp = cc_node_serialize_state(node, tmp);
 
-			nbr_of_items = cc_list_count(node->links);
-			tmp = cc_coder_encode_kv_array(tmp, "links", nbr_of_items);
+			nbr_of_items = cc_list_count(node->actors) + cc_list_count(node->restore_actors);
+			tmp = cc_coder_encode_kv_array(tmp, "actors", nbr_of_items);
 			{
-				item = node->links;
-				while (item != NULL) {
-					tmp = cc_link_serialize((cc_link_t *)item->data, tmp);
+				item = node->actors;
+				while (item != NULL && tmp != NULL) {
+					tmp = cc_coder_encode_map(tmp, 2);
+					tmp = cc_node_serialize_actor(node, (cc_actor_t *)item->data, tmp);
 					item = item->next;
 				}
-			}
 
-			nbr_of_items = cc_list_count(node->tunnels);
-			tmp = cc_coder_encode_kv_array(tmp, "tunnels", nbr_of_items);
-			{
-				item = node->tunnels;
-				while (item != NULL) {
-					tmp = cc_tunnel_serialize((cc_tunnel_t *)item->data, tmp);
+				// actors not created yet are unchanged
+				item = node->restore_actors;
+				while (item != NULL && tmp != NULL) {
+					memcpy(tmp, item->data, cc_coder_get_size_of_value((char *)item->data));
+					tmp += cc_coder_get_size_of_value((char *)item->data);
 					item = item->next;
 				}
 			}
+		}
+	}
 
-			nbr_of_items = cc_list_count(node->actors);
-			tmp = cc_coder_encode_kv_array(tmp, "actors", nbr_of_items);
-			{
-				item = node->actors;
-				while (item != NULL) {
-					tmp = cc_coder_encode_map(tmp, 1);
-					tmp = cc_actor_serialize(node, (cc_actor_t*)item->data, tmp, true);
-					item = item->next;
-				}
+	if (tmp == NULL || (size_t)(tmp - buffer) != buffer_size) {
+		cc_log_error("Failed to serialize state");
+		cc_platform_mem_free(buffer);
+		return;
+	}
+
+	if (cc_platform_file_write(node->state_file, buffer, tmp - buffer) == CC_SUCCESS) {
+		cc_log("Node: Serialized state");
+#if CC_USE_CHECKPOINTING
+		// the journal was written for the previous epoch and is ignored if left behind
+		cc_node_journal_file(node, journal);
+		if (cc_platform_file_stat(journal) == CC_STAT_FILE)
+			cc_platform_file_del(journal);
+		node->checkpoint_epoch = epoch;
+		node->checkpoint_records = 0;
+		node->checkpoint_journal_size = 0;
+		node->checkpoint_changes = 0;
+		node->checkpoint_last = cc_platform_get_time_ms();
+		node->checkpoints_written++;
+		node->checkpoint_bytes += tmp - buffer;
+		node->checkpoint_dirty = false;
+		node->checkpoint_compact = !include_state;
+		cc_node_free_removed(node);
+		item = node->actors;
+		while (item != NULL) {
+			((cc_actor_t *)item->data)->dirty = false;
+			item = item->next;
+		}
+#endif
+	} else
+		cc_log_error("File to write state");
+	cc_platform_mem_free(buffer);
+}
+
+#if CC_USE_CHECKPOINTING
+// Writes the actors, links and tunnels changed since the last checkpoint to
+// the journal, the state file is rewritten when the journal has grown too large
+void cc_node_checkpoint(cc_node_t *node)
+{
+	char *buffer = NULL, *tmp = NULL;
+	char journal[strlen(node->state_file) + sizeof(CC_NODE_JOURNAL_SUFFIX)];
+	size_t buffer_size = 0, size = 0;
+	uint32_t nbr_of_records = 0, nbr_of_actors = 0;
+	cc_list_t *item = NULL;
+	cc_actor_t *actor = NULL;
+	cc_result_t result = CC_SUCCESS;
+
+	node->checkpoint_changes = 0;
+
+	if (node->checkpoint_compact ||
+		node->checkpoint_records >= CC_CHECKPOINT_JOURNAL_RECORDS ||
+		node->checkpoint_journal_size >= CC_CHECKPOINT_JOURNAL_SIZE) {
+		cc_node_set_state(node, true);
+		return;
+	}
+
+	item = node->actors;
+	while (item != NULL) {
+		actor = (cc_actor_t *)item->data;
+		if (actor->dirty) {
+			size = cc_node_get_actor_size(node, actor);
+			if (size == 0) {
+				cc_log_error("Failed to serialize actor");
+				return;
 			}
+			buffer_size += cc_coder_sizeof_map(1) + cc_coder_sizeof_key("actor") + cc_coder_sizeof_map(2) + size;
+			nbr_of_actors++;
 		}
+		item = item->next;
 	}
 
-	if (cc_platform_file_write(CC_STATE_FILE, buffer, tmp - buffer) == CC_SUCCESS)
-		cc_log("Node: Serialized state");
+	if (!node->checkpoint_dirty && node->checkpoint_removed == NULL && nbr_of_actors == 0)
+		return;
+
+	if (node->checkpoint_records == 0)
+		buffer_size += cc_coder_sizeof_map(1) + cc_coder_sizeof_key("epoch") + cc_coder_sizeof_uint(node->checkpoint_epoch);
+	if (node->checkpoint_dirty)
+		buffer_size += cc_coder_sizeof_map(1) + cc_coder_sizeof_key("node") + cc_coder_sizeof_map(3) + cc_node_get_state_size(node);
+	for (item = node->checkpoint_removed; item != NULL; item = item->next)
+		buffer_size += cc_coder_sizeof_map(1) + cc_coder_sizeof_key("removed") + cc_coder_sizeof_str(strnlen(item->id, CC_UUID_BUFFER_SIZE));
+
+	if (cc_platform_mem_alloc((void **)&buffer, buffer_size) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return;
+	}
+	tmp = buffer;
+
+	// a new journal starts with the epoch of the state file it applies to
+	if (node->checkpoint_records == 0) {
+		tmp = cc_coder_encode_map(tmp, 1);
+		tmp = cc_coder_encode_kv_uint(tmp, "epoch", node->checkpoint_epoch);
+	}
+
+	if (node->checkpoint_dirty) {
+		tmp = cc_coder_encode_map(tmp, 1);
+		tmp = cc_coder_encode_kv_map(tmp, "node", 3);
+		tmp = cc_node_serialize_state(node, tmp);
+		nbr_of_records++;
+	}
+
+	item = node->checkpoint_removed;
+	while (item != NULL) {
+		tmp = cc_coder_encode_map(tmp, 1);
+		tmp = cc_coder_encode_kv_str(tmp, "removed", item->id, strnlen(item->id, CC_UUID_BUFFER_SIZE));
+		nbr_of_records++;
+		item = item->next;
+	}
+
+	item = node->actors;
+	while (item != NULL && tmp != NULL) {
+		actor = (cc_actor_t *)item->data;
+		if (actor->dirty) {
+			tmp = cc_coder_encode_map(tmp, 1);
+			tmp = cc_coder_encode_kv_map(tmp, "actor", 2);
+			tmp = cc_node_serialize_actor(node, actor, tmp);
+			nbr_of_records++;
+		}
+		item = item->next;
+	}
+
+	if (tmp == NULL || (size_t)(tmp - buffer) != buffer_size) {
+		cc_log_error("Failed to serialize actor");
+		cc_platform_mem_free(buffer);
+		return;
+	}
+
+	// the first write replaces a journal left from a previous epoch
+	cc_node_journal_file(node, journal);
+	if (node->checkpoint_records == 0)
+		result = cc_platform_file_write(journal, buffer, tmp - buffer);
 	else
-		cc_log_error("File to write state");
+		result = cc_platform_file_append(journal, buffer, tmp - buffer);
+
+	if (result == CC_SUCCESS) {
+		node->checkpoint_records += nbr_of_records;
+		node->checkpoint_journal_size += tmp - buffer;
+		node->checkpoint_last = cc_platform_get_time_ms();
+		node->checkpoints_written++;
+		node->checkpoint_bytes += tmp - buffer;
+		node->checkpoint_dirty = false;
+		cc_node_free_removed(node);
+		item = node->actors;
+		while (item != NULL) {
+			((cc_actor_t *)item->data)->dirty = false;
+			item = item->next;
+		}
+	} else {
+		// a partly written journal is replaced by the next checkpoint
+		cc_log_error("Failed to write journal");
+		node->checkpoint_compact = true;
+	}
+
 	cc_platform_mem_free(buffer);
 }
 
+// Time the grouped changes are due to be written
+static uint64_t cc_node_checkpoint_due(const cc_node_t *node)
+{
+	uint64_t due = node->checkpoint_deadline;
+
+	if (node->checkpoint_changes >= CC_CHECKPOINT_CHANGES && node->checkpoint_last + CC_CHECKPOINT_MIN_INTERVAL < due)
+		due = node->checkpoint_last + CC_CHECKPOINT_MIN_INTERVAL;
+
+	return due;
+}
+
+// Adds a state change to the next checkpoint
+void cc_node_checkpoint_changed(cc_node_t *node)
+{
+	uint64_t now = cc_platform_get_time_ms();
+
+	if (node->checkpoint_changes++ == 0)
+		node->checkpoint_deadline = now + CC_CHECKPOINT_INTERVAL;
+
+	if (now >= cc_node_checkpoint_due(node))
+		cc_node_checkpoint(node);
+}
+
+// Writes grouped changes that are due, timeout is lowered to when the next are
+void cc_node_checkpoint_check(cc_node_t *node, uint32_t *timeout)
+{
+	uint64_t now = 0, due = 0;
+
+	if (node->checkpoint_changes == 0)
+		return;
+
+	now = cc_platform_get_time_ms();
+	due = cc_node_checkpoint_due(node);
+	if (now >= due) {
+		cc_node_checkpoint(node);
+		return;
+	}
+
+	if (due - now < *timeout)
+		*timeout = due - now;
+}
+#endif
+
 static void cc_node_reset(cc_node_t *node)
 {
 	cc_list_t *tmp_list = NULL;
 
+	cc_node_restore_release(node);
+
 	while (node->actors != NULL) {
 		tmp_list = node->actors;
 		node->actors = node->actors->next;
@@ -285,68 +785,178 @@ static void cc_node_reset(cc_node_t *node)
 	node->links = NULL;
 	node->proxy_link = NULL;
 
-	while (node->pending_msgs != NULL) {
-		tmp_list = node->pending_msgs;
-		node->pending_msgs = node->pending_msgs->next;
-		cc_platform_mem_free(tmp_list->data);
-		cc_platform_mem_free(tmp_list->id);
-		cc_platform_mem_free(tmp_list);
-	}
-	node->pending_msgs = NULL;
+	memset(node->pending_msgs, 0, sizeof(node->pending_msgs));
+	node->nbr_of_pending_msgs = 0;
 
 	cc_node_set_state(node, false);
 }
 #endif
 
+// Pending msgs are kept in a fixed size open addressing table, removed
+// entries are filled by shifting back the entries following them
+static int cc_node_find_pending_msg(const cc_node_t *node, const char *msg_uuid, uint32_t *hash)
+{
+	uint32_t len = strnlen(msg_uuid, CC_UUID_BUFFER_SIZE), i = 0, slot = 0;
+	const cc_pending_msg_t *msg = NULL;
+
+	*hash = cc_hash(msg_uuid, len);
+	slot = *hash % CC_MAX_PENDING_MSGS;
+
+	for (i = 0; i < CC_MAX_PENDING_MSGS; i++) {
+		msg = &node->pending_msgs[slot];
+		if (msg->id[0] == '\0')
+			break;
+		if (msg->hash == *hash && strncmp(msg->id, msg_uuid, CC_UUID_BUFFER_SIZE) == 0)
+			return slot;
+		slot = (slot + 1) % CC_MAX_PENDING_MSGS;
+	}
+
+	return -1;
+}
+
+static void cc_node_delete_pending_msg(cc_node_t *node, uint32_t slot)
+{
+	uint32_t next = slot, home = 0;
+
+	node->pending_msgs[slot].id[0] = '\0';
+	node->nbr_of_pending_msgs--;
+
+	while (true) {
+		next = (next + 1) % CC_MAX_PENDING_MSGS;
+		if (node->pending_msgs[next].id[0] == '\0')
+			break;
+
+		// move the entry if the free slot is between its home slot and its slot
+		home = node->pending_msgs[next].hash % CC_MAX_PENDING_MSGS;
+		if ((next > slot && (home <= slot || home > next)) || (next < slot && home <= slot && home > next)) {
+			node->pending_msgs[slot] = node->pending_msgs[next];
+			node->pending_msgs[next].id[0] = '\0';
+			slot = next;
+		}
+	}
+}
+
+bool cc_node_can_add_pending_msg(const cc_node_t *node)
+{
+	return node->nbr_of_pending_msgs < CC_MAX_PENDING_MSGS;
+}
+
 cc_result_t cc_node_add_pending_msg(cc_node_t *node, char *msg_uuid, cc_msg_handler_t handler, void *msg_data)
 {
 	cc_pending_msg_t *msg = NULL;
+	uint32_t hash = 0, slot = 0;
 
-	if (cc_platform_mem_alloc((void **)&msg, sizeof(cc_pending_msg_t)) != CC_SUCCESS) {
-		cc_log_error("Failed to allocate memory");
+	if (!cc_node_can_add_pending_msg(node)) {
+		cc_log_error("Too many pending msgs");
 		return CC_FAIL;
 	}
 
+	if (cc_node_find_pending_msg(node, msg_uuid, &hash) >= 0) {
+		cc_log_error("Pending msg '%s' already exists", msg_uuid);
+		return CC_FAIL;
+	}
+
+	slot = hash % CC_MAX_PENDING_MSGS;
+	while (node->pending_msgs[slot].id[0] != '\0')
+		slot = (slot + 1) % CC_MAX_PENDING_MSGS;
+
+	msg = &node->pending_msgs[slot];
+	strncpy(msg->id, msg_uuid, CC_UUID_BUFFER_SIZE - 1);
+	msg->id[CC_UUID_BUFFER_SIZE - 1] = '\0';
+	msg->hash = hash;
+	msg->deadline = cc_platform_get_time_ms() + CC_PENDING_MSG_TIMEOUT * 1000;
 	msg->handler = handler;
 	msg->msg_data = msg_data;
+	node->nbr_of_pending_msgs++;
 
-	if (cc_list_add_n(&node->pending_msgs, msg_uuid, strnlen(msg_uuid, CC_UUID_BUFFER_SIZE), (void *)msg, sizeof(cc_pending_msg_t)) == NULL) {
-		cc_log_error("Failed to add pending msg");
-		cc_platform_mem_free(msg);
-		return CC_FAIL;
-	}
+	if (node->nbr_of_pending_msgs == 1 || msg->deadline < node->pending_msgs_deadline)
+		node->pending_msgs_deadline = msg->deadline;
 
 	return CC_SUCCESS;
 }
 
 void cc_node_remove_pending_msg(cc_node_t *node, char *msg_uuid)
 {
-	cc_list_t *item = NULL;
+	uint32_t hash = 0;
+	int slot = cc_node_find_pending_msg(node, msg_uuid, &hash);
 
-	item = cc_list_get_n(node->pending_msgs, msg_uuid, strnlen(msg_uuid, CC_UUID_BUFFER_SIZE));
-	if (item != NULL) {
-		cc_platform_mem_free(item->data);
-		cc_list_remove(&node->pending_msgs, msg_uuid);
-	}
+	if (slot >= 0)
+		cc_node_delete_pending_msg(node, slot);
 }
 
 cc_pending_msg_t *cc_node_get_pending_msg(cc_node_t *node, const char *msg_uuid)
 {
-	cc_list_t *item = NULL;
+	uint32_t hash = 0;
+	int slot = cc_node_find_pending_msg(node, msg_uuid, &hash);
 
-	item = cc_list_get_n(node->pending_msgs, msg_uuid, strnlen(msg_uuid, CC_UUID_BUFFER_SIZE));
-	if (item != NULL)
-		return (cc_pending_msg_t *)item->data;
+	if (slot >= 0)
+		return &node->pending_msgs[slot];
 
 	return NULL;
 }
 
+void cc_node_remove_pending_msgs_with_data(cc_node_t *node, const void *msg_data)
+{
+	uint32_t i = 0;
+
+	while (i < CC_MAX_PENDING_MSGS) {
+		if (node->pending_msgs[i].id[0] != '\0' && node->pending_msgs[i].msg_data == msg_data)
+			cc_node_delete_pending_msg(node, i);
+		else
+			i++;
+	}
+}
+
+void cc_node_pending_msgs_check(cc_node_t *node, uint32_t *timeout)
+{
+	cc_pending_msg_t msg;
+	uint64_t now = 0, deadline = 0;
+	uint32_t i = 0;
+
+	if (node->nbr_of_pending_msgs == 0)
+		return;
+
+	now = cc_platform_get_time_ms();
+
+	// handlers may add and remove pending msgs, restart the scan after each call
+	while (node->nbr_of_pending_msgs > 0 && now >= node->pending_msgs_deadline) {
+		deadline = UINT64_MAX;
+		for (i = 0; i < CC_MAX_PENDING_MSGS; i++) {
+			if (node->pending_msgs[i].id[0] == '\0')
+				continue;
+			if (node->pending_msgs[i].deadline <= now)
+				break;
+			if (node->pending_msgs[i].deadline < deadline)
+				deadline = node->pending_msgs[i].deadline;
+		}
+
+		if (i == CC_MAX_PENDING_MSGS) {
+			node->pending_msgs_deadline = deadline;
+			break;
+		}
+
+		msg = node->pending_msgs[i];
+		cc_node_delete_pending_msg(node, i);
+		cc_log_error("Pending msg '%s' timed out", msg.id);
+		msg.handler(node, NULL, 0, msg.msg_data);
+	}
+
+	if (node->nbr_of_pending_msgs > 0 && node->pending_msgs_deadline - now < *timeout)
+		*timeout = (uint32_t)(node->pending_msgs_deadline - now);
+}
+
 static cc_result_t cc_node_setup_reply_handler(cc_node_t *node, char *data, size_t data_len, void *msg_data)
 {
 	uint32_t status;
-	char *value = NULL, *obj_time = NULL, *obj_data = NULL;
+	char *value = NULL, *obj_time = NULL, *obj_data = NULL, *reply_values[2];
+	static const cc_coder_key_t reply_keys[2] = {CC_CODER_KEY("status"), CC_CODER_KEY("data")};
 	cc_coder_type_t type = CC_CODER_UNDEF;
 
+	if (data == NULL) {
+		cc_log_error("Node setup timed out");
+		return CC_FAIL;
+	}
+
 	if (cc_coder_get_value_from_map(data, "value", &value) != CC_SUCCESS) {
 		cc_log_error("Failed to decode 'value'");
 		return CC_FAIL;
@@ -357,12 +967,18 @@ static cc_result_t cc_node_setup_reply_handler(cc_node_t *node, char *data, size
 		return CC_FAIL;
 	}
 
-	if (cc_coder_decode_uint_from_map(value, "status", &status) != CC_SUCCESS) {
+	if (cc_coder_decode_map_keys(value, reply_keys, 2, reply_values) != CC_SUCCESS) {
+		cc_log_error("Failed to decode 'value'");
+		return CC_FAIL;
+	}
+
+	if (reply_values[0] == NULL || cc_coder_decode_uint(reply_values[0], &status) != CC_SUCCESS) {
 		cc_log_error("Failed to decode 'status'");
 		return CC_FAIL;
 	}
 
-	if (cc_coder_get_value_from_map(value, "data", &obj_data) != CC_SUCCESS) {
+	obj_data = reply_values[1];
+	if (obj_data == NULL) {
 		cc_log_error("Failed to decode 'data'");
 		return CC_FAIL;
 	}
@@ -384,16 +1000,16 @@ static cc_result_t cc_node_setup_reply_handler(cc_node_t *node, char *data, size
 			cc_log_error("Failed to decode 'time'");
 			return CC_FAIL;
 		}
-		node->seconds_since_epoch = (uint32_t)seconds;
-		node->time_at_sync = cc_platform_get_time();
+		node->ms_since_epoch = (uint64_t)((double)seconds * 1000);
+		node->time_at_sync = cc_platform_get_time_ms();
 	} else if (type == CC_CODER_DOUBLE) {
 		double seconds = 0.0;
 		if (cc_coder_decode_double(obj_time, &seconds) != CC_SUCCESS) {
 			cc_log_error("Failed to decode 'time'");
 			return CC_FAIL;
 		}
-		node->seconds_since_epoch = (uint32_t)seconds;
-		node->time_at_sync = cc_platform_get_time();
+		node->ms_since_epoch = (uint64_t)((double)seconds * 1000);
+		node->time_at_sync = cc_platform_get_time_ms();
 	} else {
 		cc_log_error("Unsupported type '%d'", type);
 		return CC_FAIL;
@@ -405,7 +1021,7 @@ static cc_result_t cc_node_setup_reply_handler(cc_node_t *node, char *data, size
 	cc_log("Node: Connected to proxy");
 	cc_log(" id: %s", node->transport_client->peer_id);
 	cc_log(" uri: %s", node->transport_client->uri);
-	cc_log(" time: %ld (seconds since epoch)", node->seconds_since_epoch);
+	cc_log(" time: %ld (seconds since epoch)", cc_node_get_time(node));
 
 	return CC_SUCCESS;
 }
@@ -416,6 +1032,11 @@ static cc_result_t cc_node_enter_sleep_reply_handler(cc_node_t *node, char *data
 	uint32_t status = 0;
 	char *value = NULL;
 
+	if (data == NULL) {
+		node->state = CC_NODE_STARTED;
+		return CC_SUCCESS;
+	}
+
 	if (cc_coder_get_value_from_map(data, "value", &value) != CC_SUCCESS) {
 		cc_log_error("Failed to decode 'value'");
 		return CC_FAIL;
@@ -437,40 +1058,163 @@ static cc_result_t cc_node_enter_sleep_reply_handler(cc_node_t *node, char *data
 }
 #endif
 
-cc_result_t cc_node_handle_token(cc_port_t *port, const char *data, const size_t size, uint32_t sequencenbr)
+cc_result_t cc_node_handle_token(cc_node_t *node, cc_port_t *port, const char *data, const size_t size, uint32_t sequencenbr)
 {
 	char *buffer = NULL;
+	cc_transport_rx_buffer_t *rx_buffer = NULL;
 
-	if (port->actor->state == CC_ACTOR_ENABLED) {
-		if (cc_fifo_slots_available(port->fifo, 1)) {
-			if (cc_platform_mem_alloc((void **)&buffer, size) != CC_SUCCESS) {
-				cc_log_error("Failed to allocate memory");
-				return CC_FAIL;
-			}
-			memcpy(buffer, data, size);
-			if (cc_fifo_com_write(port->fifo, buffer, size, sequencenbr) == CC_SUCCESS)
-				return CC_SUCCESS;
-			cc_log_error("Failed to write to fifo");
-			cc_platform_mem_free((void *)buffer);
-		} else
-			cc_log_debug("Token received but no slots available");
-	} else
+	// already written, ack it again without storing it
+	if (cc_fifo_com_is_duplicate(port->fifo, sequencenbr)) {
+		cc_log_debug("Duplicate token '%ld' received", (unsigned long)sequencenbr);
+		return CC_SUCCESS;
+	}
+
+	// nacked so the sender resends from the missing token
+	if (sequencenbr != port->fifo->write_pos) {
+		cc_log_debug("Token '%ld' received out of order", (unsigned long)sequencenbr);
+		return CC_FAIL;
+	}
+
+	if (port->actor->state != CC_ACTOR_ENABLED) {
 		cc_log_debug("Token received but actor not enabled");
+		return CC_FAIL;
+	}
+
+	// reference the token data in the received frame if possible, a write to
+	// a full fifo fails and grows the fifo if it stays full
+	if (node->transport_client != NULL)
+		rx_buffer = cc_transport_rx_buffer_get(node->transport_client, data, size);
+	if (rx_buffer != NULL) {
+		if (cc_fifo_com_write_ref(port->fifo, (char *)data, size, rx_buffer, sequencenbr) == CC_SUCCESS) {
+			cc_actor_set_dirty(port->actor);
+			cc_scheduler_actor_ready(node, port->actor);
+			return CC_SUCCESS;
+		}
+		cc_log_debug("Token received but no slots available");
+		return CC_FAIL;
+	}
+
+	if (cc_platform_mem_alloc((void **)&buffer, size) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return CC_FAIL;
+	}
+	memcpy(buffer, data, size);
+	if (cc_fifo_com_write(port->fifo, buffer, size, sequencenbr) == CC_SUCCESS) {
+		cc_actor_set_dirty(port->actor);
+		cc_scheduler_actor_ready(node, port->actor);
+		return CC_SUCCESS;
+	}
+	cc_log_debug("Token received but no slots available");
+	cc_platform_mem_free((void *)buffer);
+
+	return CC_FAIL;
+}
+
+// Streams a chunk of a large token to the sink of the port, the token is
+// written to the fifo when all chunks are received
+cc_result_t cc_node_handle_token_chunk(cc_node_t *node, cc_port_t *port, uint32_t sequencenbr, uint32_t size, uint32_t offset, const char *data, uint32_t len, bool *complete)
+{
+	char *buffer = NULL;
+	size_t buffer_size = 0;
+
+	*complete = false;
+
+	// a chunk of an already written token acks it again
+	if (cc_fifo_com_is_duplicate(port->fifo, sequencenbr)) {
+		*complete = true;
+		return CC_SUCCESS;
+	}
+
+	if (sequencenbr != port->fifo->write_pos) {
+		cc_log_debug("Token chunk '%ld' received out of order", (unsigned long)sequencenbr);
+		return CC_FAIL;
+	}
+
+	if (port->actor->state != CC_ACTOR_ENABLED) {
+		cc_log_debug("Token chunk received but actor not enabled");
+		return CC_FAIL;
+	}
+
+	// a first chunk (re)starts the transfer, nack it early if the token has no slot
+	if (offset == 0) {
+		cc_port_clear_chunk(port);
+		if (size == 0)
+			return CC_FAIL;
+		if (!cc_fifo_slots_available(port->fifo, 1)) {
+			cc_log_debug("Token chunk received but no slots available");
+			return CC_FAIL;
+		}
+		if (port->sink->open(port, size) != CC_SUCCESS)
+			return CC_FAIL;
+		port->chunk.active = true;
+		port->chunk.sequencenbr = sequencenbr;
+		port->chunk.size = size;
+		port->chunk.offset = 0;
+	} else if (!port->chunk.active || port->chunk.sequencenbr != sequencenbr || port->chunk.offset != offset) {
+		cc_log_error("Unexpected token chunk");
+		cc_port_clear_chunk(port);
+		return CC_FAIL;
+	}
+
+	if (len > port->chunk.size - offset || port->sink->write(port, offset, data, len) != CC_SUCCESS) {
+		cc_log_error("Failed to write token chunk");
+		cc_port_clear_chunk(port);
+		return CC_FAIL;
+	}
+
+	port->chunk.offset += len;
+	if (port->chunk.offset < port->chunk.size)
+		return CC_SUCCESS;
+
+	*complete = true;
+	port->sink->close(port, true, &buffer, &buffer_size);
+	memset(&port->chunk, 0, sizeof(cc_port_chunk_t));
+	if (cc_fifo_com_write(port->fifo, buffer, buffer_size, sequencenbr) == CC_SUCCESS) {
+		cc_actor_set_dirty(port->actor);
+		cc_scheduler_actor_ready(node, port->actor);
+		return CC_SUCCESS;
+	}
+
+	cc_log_error("Failed to write to fifo");
+	cc_platform_mem_free((void *)buffer);
 
 	return CC_FAIL;
 }
 
-void cc_node_handle_token_reply(cc_node_t *node, char *port_id, uint32_t port_id_len, cc_port_reply_type_t reply_type, uint32_t sequencenbr)
+void cc_node_handle_token_chunk_reply(cc_node_t *node, char *port_id, uint32_t port_id_len, uint32_t sequencenbr, uint32_t offset)
+{
+	cc_port_t *port = cc_port_get(node, port_id, port_id_len);
+
+	if (port == NULL || !port->chunk.active || !port->chunk.in_flight || port->chunk.sequencenbr != sequencenbr)
+		return;
+
+	if (offset <= port->chunk.offset || offset >= port->chunk.size) {
+		cc_log_error("Invalid chunk offset '%ld'", (unsigned long)offset);
+		return;
+	}
+
+	port->chunk.offset = offset;
+	port->chunk.in_flight = false;
+	cc_scheduler_actor_ready(node, port->actor);
+}
+
+void cc_node_handle_token_reply(cc_node_t *node, char *port_id, uint32_t port_id_len, cc_port_reply_type_t reply_type, uint32_t sequencenbr, uint32_t sequencenbr_end)
 {
 	cc_port_t *port = cc_port_get(node, port_id, port_id_len);
 
 	if (port != NULL) {
+		// the reply to the last chunk acks or nacks the whole token
+		if (port->chunk.active && port->chunk.sequencenbr >= sequencenbr && port->chunk.sequencenbr <= sequencenbr_end)
+			memset(&port->chunk, 0, sizeof(cc_port_chunk_t));
+		// acks are cumulative, nacked tokens are resent one by one
 		if (reply_type == CC_PORT_REPLY_TYPE_ACK)
-			cc_fifo_com_commit_read(port->fifo, sequencenbr);
+			cc_fifo_com_commit_read(port->fifo, sequencenbr_end);
 		else if (reply_type == CC_PORT_REPLY_TYPE_NACK)
-			cc_fifo_com_cancel_read(port->fifo, sequencenbr);
+			cc_fifo_com_nack_read(port->fifo, sequencenbr, sequencenbr_end);
 		else if (reply_type == CC_PORT_REPLY_TYPE_ABORT)
 			cc_log_debug("TODO: handle ABORT");
+		cc_actor_set_dirty(port->actor);
+		cc_scheduler_actor_ready(node, port->actor);
 	}
 }
 
@@ -478,9 +1222,9 @@ cc_result_t cc_node_handle_message(cc_node_t *node, char *buffer, size_t len)
 {
 	if (cc_proto_parse_message(node, buffer, len) == CC_SUCCESS) {
 #if (CC_USE_STORAGE == 1 && CC_USE_CHECKPOINTING == 1)
-		// message successfully handled == state changed -> serialize the node
+		// message successfully handled == state changed -> group it into the next checkpoint
 		if (node->state == CC_NODE_STARTED)
-			cc_node_set_state(node, true);
+			cc_node_checkpoint_changed(node);
 #endif
 		return CC_SUCCESS;
 	}
@@ -499,7 +1243,7 @@ static cc_result_t cc_node_setup(cc_node_t *node)
 #endif
 
 #if CC_USE_STORAGE
-	if (cc_platform_file_stat(CC_STATE_FILE) == CC_STAT_FILE) {
+	if (cc_platform_file_stat(node->state_file) == CC_STAT_FILE) {
 		if (cc_node_get_state(node) == CC_SUCCESS)
 			return CC_SUCCESS;
 		cc_log("Node: Failed to get state, resetting node");
@@ -512,51 +1256,81 @@ static cc_result_t cc_node_setup(cc_node_t *node)
 	return CC_SUCCESS;
 }
 
-static cc_result_t cc_node_connect_to_proxy(cc_node_t *node, char *uri)
+static void cc_node_proxy_set_state(cc_node_t *node, cc_node_proxy_state_t state, uint32_t timeout_ms)
 {
-	char *peer_id = NULL;
-	size_t peer_id_len = 0;
-	cc_list_t *tmp_list = NULL;
-	bool new_proxy = true;
+	node->proxy_state = state;
+	node->proxy_deadline = cc_platform_get_time_ms() + timeout_ms;
+}
 
-	cc_log("Node: Connecting to proxy with '%s'", uri);
+// Closes the connection, a transport with its interface down is kept waiting for it
+static void cc_node_proxy_disconnect(cc_node_t *node)
+{
+	cc_transport_state_t state = node->transport_client->state;
 
-	if (node->transport_client == NULL) {
-		node->transport_client = cc_transport_create(node, uri);
-		if (node->transport_client == NULL)
-			return CC_FAIL;
-	}
+	cc_transport_disconnect(node, node->transport_client);
+	if (state == CC_TRANSPORT_INTERFACE_DOWN)
+		node->transport_client->state = CC_TRANSPORT_INTERFACE_DOWN;
+}
 
-	while (node->state != CC_NODE_STOP && node->transport_client->state == CC_TRANSPORT_INTERFACE_DOWN) {
-		if (cc_platform_evt_wait(node, CONNECT_TIMEOUT) == CC_PLATFORM_EVT_WAIT_FAIL)
-			return CC_FAIL;
-	}
+// Try the next uri or, when all have failed, back off before the next round
+static void cc_node_proxy_failed(cc_node_t *node)
+{
+	cc_log_error("Node: Failed to connect to proxy with '%s'", node->proxy_uri->id);
 
-	if (node->transport_client->connect(node, node->transport_client) != CC_SUCCESS)
-		return CC_FAIL;
+	if (node->transport_client != NULL)
+		cc_node_proxy_disconnect(node);
 
-	while (node->state != CC_NODE_STOP && node->transport_client->state == CC_TRANSPORT_PENDING) {
-		if (cc_platform_evt_wait(node, CONNECT_TIMEOUT) == CC_PLATFORM_EVT_WAIT_FAIL)
-			return CC_FAIL;
+	node->proxy_uri = node->proxy_uri->next;
+	if (node->proxy_uri != NULL) {
+		cc_node_proxy_set_state(node, CC_NODE_PROXY_DISCONNECTED, 0);
+		return;
 	}
 
-	if (cc_transport_join(node, node->transport_client) != CC_SUCCESS)
-		return CC_FAIL;
+	node->proxy_uri = node->proxy_uris;
+	cc_log("Node: Reconnecting in %ld ms", (unsigned long)node->proxy_backoff);
+	cc_node_proxy_set_state(node, CC_NODE_PROXY_DISCONNECTED, node->proxy_backoff);
+	node->proxy_backoff *= 2;
+	if (node->proxy_backoff > CC_RECONNECT_MAX_TIMEOUT * 1000)
+		node->proxy_backoff = CC_RECONNECT_MAX_TIMEOUT * 1000;
+}
 
-	while (node->state != CC_NODE_STOP && node->transport_client->state == CC_TRANSPORT_PENDING) {
-		if (cc_platform_evt_wait(node, CONNECT_TIMEOUT) == CC_PLATFORM_EVT_WAIT_FAIL)
+static cc_result_t cc_node_proxy_start(cc_node_t *node)
+{
+	cc_transport_client_t *transport_client = NULL;
+
+	cc_log("Node: Connecting to proxy with '%s'", node->proxy_uri->id);
+
+	// the previous transport is kept until replaced as it is referenced while disconnected
+	if (node->transport_client == NULL || node->proxy_transport_uri != node->proxy_uri) {
+		transport_client = cc_transport_create(node, node->proxy_uri->id);
+		if (transport_client == NULL)
 			return CC_FAIL;
+		if (node->transport_client != NULL)
+			node->transport_client->free(node->transport_client);
+		node->transport_client = transport_client;
+		node->proxy_transport_uri = node->proxy_uri;
 	}
 
-	if (node->state == CC_NODE_STOP || node->transport_client->state != CC_TRANSPORT_ENABLED)
-		return CC_FAIL;
+	if (node->state != CC_NODE_STOP)
+		node->state = CC_NODE_DO_START;
+
+	return CC_SUCCESS;
+}
+
+// Joined the proxy, drop the state of a previous proxy and request the proxy tunnels
+static cc_result_t cc_node_proxy_joined(cc_node_t *node)
+{
+	char *peer_id = NULL;
+	size_t peer_id_len = 0;
+	cc_list_t *tmp_list = NULL;
 
 	peer_id = node->transport_client->peer_id;
 	peer_id_len = strnlen(peer_id, CC_UUID_BUFFER_SIZE);
+	node->proxy_new = true;
 
 	if (node->proxy_link != NULL) {
 		if (strncmp(node->proxy_link->peer_id, peer_id, peer_id_len) == 0)
-			new_proxy = false;
+			node->proxy_new = false;
 		else {
 			cc_log("New proxy");
 			while (node->tunnels != NULL) {
@@ -592,6 +1366,13 @@ static cc_result_t cc_node_connect_to_proxy(cc_node_t *node, char *uri)
 		}
 	}
 
+	// tunnels that failed while disconnected are requested again
+	if (node->storage_tunnel != NULL && node->storage_tunnel->state == CC_TUNNEL_DISCONNECTED && cc_tunnel_connect(node, node->storage_tunnel) != CC_SUCCESS)
+		return CC_FAIL;
+
+	if (node->proxy_tunnel != NULL && node->proxy_tunnel->state == CC_TUNNEL_DISCONNECTED && cc_tunnel_connect(node, node->proxy_tunnel) != CC_SUCCESS)
+		return CC_FAIL;
+
 	if (node->storage_tunnel == NULL) {
 		node->storage_tunnel = cc_tunnel_create(node, CC_TUNNEL_TYPE_STORAGE, CC_TUNNEL_DISCONNECTED, peer_id, peer_id_len, NULL, 0);
 		if (node->storage_tunnel == NULL) {
@@ -610,12 +1391,11 @@ static cc_result_t cc_node_connect_to_proxy(cc_node_t *node, char *uri)
 		cc_tunnel_add_ref(node->proxy_tunnel);
 	}
 
-	while ((node->storage_tunnel->state == CC_TUNNEL_PENDING || node->proxy_tunnel->state == CC_TUNNEL_PENDING)
-		&& node->state != CC_NODE_STOP && node->transport_client->state == CC_TRANSPORT_ENABLED) {
-		if (cc_platform_evt_wait(node, CONNECT_TIMEOUT) == CC_PLATFORM_EVT_WAIT_FAIL)
-			return CC_FAIL;
-	}
+	return CC_SUCCESS;
+}
 
+static cc_result_t cc_node_proxy_setup(cc_node_t *node)
+{
 	if (node->storage_tunnel->state != CC_TUNNEL_ENABLED) {
 		cc_log_error("Failed to connect storage tunnel");
 		return CC_FAIL;
@@ -626,31 +1406,117 @@ static cc_result_t cc_node_connect_to_proxy(cc_node_t *node, char *uri)
 		return CC_FAIL;
 	}
 
-	if (new_proxy) {
-		if (cc_proto_send_node_setup(node, cc_node_setup_reply_handler) != CC_SUCCESS)
-			return CC_FAIL;
-	} else {
-		if (cc_proto_send_wake_signal(node, cc_node_setup_reply_handler) != CC_SUCCESS)
-			return CC_FAIL;
-	}
+	if (node->proxy_new)
+		return cc_proto_send_node_setup(node, cc_node_setup_reply_handler);
 
-	while (node->state != CC_NODE_STARTED && node->state != CC_NODE_STOP && node->transport_client->state == CC_TRANSPORT_ENABLED) {
-		if (cc_platform_evt_wait(node, CONNECT_TIMEOUT) == CC_PLATFORM_EVT_WAIT_FAIL)
-			return CC_FAIL;
-	}
+	return cc_proto_send_wake_signal(node, cc_node_setup_reply_handler);
+}
 
-	if (node->state != CC_NODE_STARTED) {
-		cc_log_error("Failed connect to proxy");
-		return CC_FAIL;
-	}
+static void cc_node_proxy_started(cc_node_t *node)
+{
+	cc_list_t *tmp_list = node->actors;
+
+	cc_log("Connected to proxy");
+
+	node->proxy_backoff = CC_RECONNECT_TIMEOUT * 1000;
+	cc_node_proxy_set_state(node, CC_NODE_PROXY_CONNECTED, 0);
 
-	tmp_list = node->actors;
 	while (tmp_list != NULL) {
 		cc_actor_connect_ports(node, (cc_actor_t *)tmp_list->data);
 		tmp_list = tmp_list->next;
 	}
+}
 
-	return CC_SUCCESS;
+// Advances the connection to the proxy without blocking, each step waits for
+// transport events and fails over to the next uri if not done in CONNECT_TIMEOUT
+static void cc_node_proxy_check(cc_node_t *node, uint32_t *timeout)
+{
+	cc_transport_client_t *transport_client = NULL;
+	cc_node_proxy_state_t state;
+	uint64_t now = 0;
+
+	if (node->proxy_uris == NULL || node->state == CC_NODE_STOP)
+		return;
+
+	do {
+		state = node->proxy_state;
+		transport_client = node->transport_client;
+		now = cc_platform_get_time_ms();
+
+		switch (node->proxy_state) {
+		case CC_NODE_PROXY_DISCONNECTED:
+			if (now < node->proxy_deadline)
+				break;
+			if (cc_node_proxy_start(node) == CC_SUCCESS)
+				cc_node_proxy_set_state(node, CC_NODE_PROXY_WAIT_INTERFACE, CONNECT_TIMEOUT);
+			else
+				cc_node_proxy_failed(node);
+			break;
+		case CC_NODE_PROXY_WAIT_INTERFACE:
+			if (transport_client->state == CC_TRANSPORT_INTERFACE_DOWN) {
+				if (now >= node->proxy_deadline)
+					cc_node_proxy_failed(node);
+			} else if (transport_client->connect(node, transport_client) == CC_SUCCESS)
+				cc_node_proxy_set_state(node, CC_NODE_PROXY_CONNECTING, CONNECT_TIMEOUT);
+			else
+				cc_node_proxy_failed(node);
+			break;
+		case CC_NODE_PROXY_CONNECTING:
+			if (transport_client->state == CC_TRANSPORT_CONNECTING || transport_client->state == CC_TRANSPORT_PENDING) {
+				if (now >= node->proxy_deadline)
+					cc_node_proxy_failed(node);
+			} else if (transport_client->state == CC_TRANSPORT_CONNECTED && cc_transport_join(node, transport_client) == CC_SUCCESS)
+				cc_node_proxy_set_state(node, CC_NODE_PROXY_JOINING, CONNECT_TIMEOUT);
+			else
+				cc_node_proxy_failed(node);
+			break;
+		case CC_NODE_PROXY_JOINING:
+			if (transport_client->state == CC_TRANSPORT_PENDING) {
+				if (now >= node->proxy_deadline)
+					cc_node_proxy_failed(node);
+			} else if (transport_client->state == CC_TRANSPORT_ENABLED && cc_node_proxy_joined(node) == CC_SUCCESS)
+				cc_node_proxy_set_state(node, CC_NODE_PROXY_TUNNELS, CONNECT_TIMEOUT);
+			else
+				cc_node_proxy_failed(node);
+			break;
+		case CC_NODE_PROXY_TUNNELS:
+			if (transport_client->state != CC_TRANSPORT_ENABLED)
+				cc_node_proxy_failed(node);
+			else if (node->storage_tunnel->state == CC_TUNNEL_PENDING || node->proxy_tunnel->state == CC_TUNNEL_PENDING) {
+				if (now >= node->proxy_deadline)
+					cc_node_proxy_failed(node);
+			} else if (cc_node_proxy_setup(node) == CC_SUCCESS)
+				cc_node_proxy_set_state(node, CC_NODE_PROXY_SETUP, CONNECT_TIMEOUT);
+			else
+				cc_node_proxy_failed(node);
+			break;
+		case CC_NODE_PROXY_SETUP:
+			if (transport_client->state != CC_TRANSPORT_ENABLED)
+				cc_node_proxy_failed(node);
+			else if (node->state == CC_NODE_STARTED)
+				cc_node_proxy_started(node);
+			else if (now >= node->proxy_deadline)
+				cc_node_proxy_failed(node);
+			break;
+		case CC_NODE_PROXY_CONNECTED:
+			if (transport_client->state == CC_TRANSPORT_ENABLED)
+				break;
+			// reconnect to the same uri first, local actors keep running meanwhile
+			cc_log_error("Node: Lost connection to proxy");
+			cc_node_proxy_disconnect(node);
+			cc_node_proxy_set_state(node, CC_NODE_PROXY_DISCONNECTED, 0);
+			break;
+		}
+	} while (node->proxy_state != state && node->state != CC_NODE_STOP);
+
+	// wake up for the end of the current step or backoff
+	if (node->proxy_state != CC_NODE_PROXY_CONNECTED) {
+		now = cc_platform_get_time_ms();
+		if (node->proxy_deadline <= now)
+			*timeout = 0;
+		else if (node->proxy_deadline - now < *timeout)
+			*timeout = node->proxy_deadline - now;
+	}
 }
 
 cc_result_t cc_node_init(cc_node_t *node, const char *attributes, const char *proxy_uris)
@@ -688,17 +1554,44 @@ cc_result_t cc_node_init(cc_node_t *node, const char *attributes, const char *pr
 	node->transport_client = NULL;
 	node->proxy_link = NULL;
 	node->platform = NULL;
+#if CC_USE_STORAGE
+	if (node->state_file == NULL)
+		node->state_file = CC_STATE_FILE;
+	node->restore_actors = NULL;
+	node->restore_state = NULL;
+	node->restore_state_size = 0;
+	node->restore_journal = NULL;
+#endif
+#if CC_USE_CHECKPOINTING
+	node->checkpoint_dirty = false;
+	node->checkpoint_compact = true;
+	node->checkpoint_removed = NULL;
+	node->checkpoint_epoch = 0;
+	node->checkpoint_records = 0;
+	node->checkpoint_journal_size = 0;
+	node->checkpoint_changes = 0;
+	node->checkpoint_deadline = 0;
+	node->checkpoint_last = 0;
+	node->checkpoints_written = 0;
+	node->checkpoint_bytes = 0;
+#endif
 	node->links = NULL;
 	node->storage_tunnel = NULL;
 	node->proxy_tunnel = NULL;
 	node->tunnels = NULL;
 	node->actors = NULL;
-	node->seconds_since_epoch = 0;
+	node->ms_since_epoch = 0;
 	node->time_at_sync = 0;
 	node->actor_types = NULL;
-#if CC_USE_FDS
-	FD_ZERO(&node->fds);
-#endif
+	memset(node->pending_msgs, 0, sizeof(node->pending_msgs));
+	node->nbr_of_pending_msgs = 0;
+	node->pending_msgs_deadline = 0;
+	node->proxy_state = CC_NODE_PROXY_DISCONNECTED;
+	node->proxy_uri = node->proxy_uris;
+	node->proxy_transport_uri = NULL;
+	node->proxy_deadline = 0;
+	node->proxy_backoff = CC_RECONNECT_TIMEOUT * 1000;
+	node->proxy_new = true;
 
 	if (attributes != NULL) {
 		if (strlen(attributes) <= CC_MAX_ATTRIBUTES_LEN) {
@@ -759,6 +1652,10 @@ static void cc_node_free(cc_node_t *node, bool cleanup)
 {
 	cc_list_t *item = NULL, *tmp_item = NULL;
 	cc_actor_type_t *type = NULL;
+#if CC_USE_SLAB
+	cc_slab_stats_t stats;
+	uint8_t i = 0;
+#endif
 
 	item = node->proxy_uris;
 	while (item != NULL) {
@@ -801,9 +1698,20 @@ static void cc_node_free(cc_node_t *node, bool cleanup)
 		cc_link_free(node, (cc_link_t *)tmp_item->data);
 	}
 
+#if CC_USE_STORAGE
+	cc_node_restore_release(node);
+#endif
+#if CC_USE_CHECKPOINTING
+	cc_node_free_removed(node);
+#endif
+
+#if CC_USE_FDS
+	cc_calvinsys_remove_event_sources(node->calvinsys);
+#endif
 	if (node->platform != NULL)
 		cc_platform_mem_free((void *)node->platform);
 
+	cc_calvinsys_timer_free(node->calvinsys);
 	item = node->calvinsys->capabilities;
 	while (item != NULL) {
 		tmp_item = item;
@@ -815,31 +1723,37 @@ static void cc_node_free(cc_node_t *node, bool cleanup)
 	if (node->attributes != NULL)
 		cc_platform_mem_free((void *)node->attributes);
 
-	while (node->pending_msgs != NULL) {
-		item = node->pending_msgs;
-		node->pending_msgs = node->pending_msgs->next;
-		cc_platform_mem_free(item->data);
-		cc_platform_mem_free(item->id);
-		cc_platform_mem_free(item);
-	}
-
 #if CC_USE_PYTHON
 	cc_mpy_port_deinit();
 	cc_platform_mem_free(node->mpy_heap);
 #endif
 
 	if (node->transport_client != NULL) {
-		node->transport_client->disconnect(node, node->transport_client);
+		cc_transport_disconnect(node, node->transport_client);
 		node->transport_client->free(node->transport_client);
 	}
 
+	cc_index_free(&node->actor_index);
+	cc_index_free(&node->port_index);
+	cc_index_free(&node->tunnel_index);
+	cc_index_free(&node->link_index);
+
+#if CC_USE_SLAB
+	while (cc_slab_get_stats(i++, &stats) == CC_SUCCESS)
+		cc_log("Slab %ld: blocks %ld used %ld peak %ld fallbacks %ld", (unsigned long)stats.block_size, (unsigned long)stats.blocks, (unsigned long)stats.used, (unsigned long)stats.peak, (unsigned long)stats.fallbacks);
+#endif
+
 	cc_platform_mem_free((void *)node);
 }
 
+uint64_t cc_node_get_time_ms(cc_node_t *node)
+{
+	return node->ms_since_epoch + (cc_platform_get_time_ms() - node->time_at_sync);
+}
+
 uint32_t cc_node_get_time(cc_node_t *node)
 {
-	// TODO: Handle wraps
-	return node->seconds_since_epoch + (cc_platform_get_time() - node->time_at_sync);
+	return (uint32_t)(cc_node_get_time_ms(node) / 1000);
 }
 
 #if CC_USE_SLEEP
@@ -891,6 +1805,10 @@ void cc_node_stop(cc_node_t *node)
 
 	cc_log("Node: Stopping");
 
+#if CC_USE_STORAGE
+	cc_node_restore_actors(node);
+#endif
+
 	item = node->actors;
 	while (item != NULL) {
 		tmp_item = item;
@@ -980,6 +1898,16 @@ static void cc_node_dump_info(cc_node_t *node)
 			item = item->next;
 		}
 	}
+#if CC_USE_STORAGE
+	if (node->restore_actors != NULL) {
+		cc_log("Actors to restore:");
+		item = node->restore_actors;
+		while (item != NULL) {
+			cc_log(" %s", item->id);
+			item = item->next;
+		}
+	}
+#endif
 
 #if CC_USE_PYTHON
 	cc_log("MicroPython heap: %d", CC_PYTHON_HEAP_SIZE);
@@ -988,7 +1916,6 @@ static void cc_node_dump_info(cc_node_t *node)
 
 cc_result_t cc_node_run(cc_node_t *node, const char *script)
 {
-	cc_list_t *item = NULL;
 	uint32_t wait_timeout = 0, next_timer_timeout = 0;
 	cc_platform_evt_wait_status_t waitstatus = CC_PLATFORM_EVT_WAIT_DATA_READ;
 #if CC_USE_SLEEP
@@ -1015,35 +1942,54 @@ cc_result_t cc_node_run(cc_node_t *node, const char *script)
 	}
 
 	while (node->state != CC_NODE_STOP) {
-		if (node->proxy_uris != NULL &&
-				(node->transport_client == NULL || (node->transport_client != NULL && node->transport_client->state != CC_TRANSPORT_ENABLED))) {
-			item = node->proxy_uris;
-			while (item != NULL && node->state != CC_NODE_STOP) {
-				node->state = CC_NODE_DO_START;
-				if (cc_node_connect_to_proxy(node, item->id) == CC_SUCCESS) {
-					cc_log("Connected to proxy");
-					break;
-				}
-				item = item->next;
-			}
+		if (node->stop_request != NULL && *node->stop_request) {
+			node->state = CC_NODE_STOP;
+			break;
 		}
 
-		// update timers and fire actors
+		// advance the proxy connection, update timers, expire pending msgs and fire actors
+		next_timer_timeout = CC_INACTIVITY_TIMEOUT * 1000;
+		cc_node_proxy_check(node, &next_timer_timeout);
 		cc_calvinsys_timers_check(node, &next_timer_timeout);
-		if (node->fire_actors(node)) {
-			// handle platform events
-			cc_platform_evt_wait(node, 1);
+		cc_node_pending_msgs_check(node, &next_timer_timeout);
+#if CC_USE_CHECKPOINTING
+		cc_node_checkpoint_check(node, &next_timer_timeout);
+#endif
+		if (node->fire_actors(node) || node->ready_actors != NULL) {
+			// handle platform events, wait at most a second or until the next timer and
+			// only poll (shortest wait) when actors are ready to be visited again
+			wait_timeout = node->ready_actors != NULL ? 1 : 1000;
+			cc_node_proxy_check(node, &wait_timeout);
+			cc_calvinsys_timers_check(node, &wait_timeout);
+			cc_node_pending_msgs_check(node, &wait_timeout);
+#if CC_USE_CHECKPOINTING
+			cc_node_checkpoint_check(node, &wait_timeout);
+#endif
+			if (wait_timeout > 0)
+				cc_platform_evt_wait(node, wait_timeout);
 			continue;
 		}
 
-		// get wait timeout, if no active timers about to fire use CC_INACTIVITY_TIMEOUT
-		wait_timeout = CC_INACTIVITY_TIMEOUT;
+		// get wait timeout, if no active timers, pending msgs or connection steps about to expire use CC_INACTIVITY_TIMEOUT
+		wait_timeout = CC_INACTIVITY_TIMEOUT * 1000;
+		cc_node_proxy_check(node, &wait_timeout);
 		cc_calvinsys_timers_check(node, &wait_timeout);
+		cc_node_pending_msgs_check(node, &wait_timeout);
+#if CC_USE_CHECKPOINTING
+		cc_node_checkpoint_check(node, &wait_timeout);
+#endif
 
-#if CC_USE_SLEEP
-		// Wait CC_INACTIVITY_TIMEOUT, if timeout try sleep
-		if (wait_timeout > CC_INACTIVITY_TIMEOUT)
-			wait_timeout = CC_INACTIVITY_TIMEOUT;
+		// a timer, pending msg or connection step expired, fire actors before waiting (0 would block indefinitely)
+		if (wait_timeout == 0)
+			continue;
+
+#if CC_USE_STORAGE
+		// create a restored actor per idle round, events are still handled in between
+		if (node->restore_actors != NULL) {
+			cc_node_restore_item(node, node->restore_actors);
+			cc_platform_evt_wait(node, 1);
+			continue;
+		}
 #endif
 
 		// wait for platform event
@@ -1051,11 +1997,12 @@ cc_result_t cc_node_run(cc_node_t *node, const char *script)
 		switch (waitstatus) {
 			case CC_PLATFORM_EVT_WAIT_TIMEOUT:
 #if CC_USE_SLEEP
-				sleep_timeout = CC_SLEEP_TIME;
+				sleep_timeout = CC_SLEEP_TIME * 1000;
 				cc_calvinsys_timers_check(node, &sleep_timeout);
-				if (sleep_timeout > CC_INACTIVITY_TIMEOUT) {
-					cc_log("Node: Idle for '%ld' seconds, trying sleep for '%ld' seconds", wait_timeout, sleep_timeout);
-					cc_node_enter_sleep(node, sleep_timeout);
+				// hosted nodes share the process and never deep sleep
+				if (node->stop_request == NULL && sleep_timeout > CC_INACTIVITY_TIMEOUT * 1000) {
+					cc_log("Node: Idle for '%ld' ms, trying sleep for '%ld' seconds", wait_timeout, sleep_timeout / 1000);
+					cc_node_enter_sleep(node, sleep_timeout / 1000);
 				}
 #endif
 				break;
@@ -1073,6 +2020,9 @@ cc_result_t cc_node_run(cc_node_t *node, const char *script)
 	cc_node_stop(node);
 #if CC_USE_STORAGE
 	cc_node_set_state(node, false);
+#endif
+#if CC_USE_CHECKPOINTING
+	cc_log("Node: Wrote %lu checkpoints, %llu bytes", (unsigned long)node->checkpoints_written, (unsigned long long)node->checkpoint_bytes);
 #endif
 	cc_platform_stop(node);
 	cc_node_free(node, false);
@@ -29,6 +29,10 @@
 
 #define CC_INDEFINITELY_TIMEOUT 0
 
+#if CC_USE_CHECKPOINTING
+#define CC_NODE_JOURNAL_SUFFIX ".journal"
+#endif
+
 typedef enum {
 	CC_NODE_DO_START,
 	CC_NODE_DO_SLEEP,
@@ -37,14 +41,30 @@ typedef enum {
 	CC_NODE_STOP
 } cc_node_state_t;
 
+// steps of connecting to a proxy, driven from the main loop
+typedef enum {
+	CC_NODE_PROXY_DISCONNECTED,
+	CC_NODE_PROXY_WAIT_INTERFACE,
+	CC_NODE_PROXY_CONNECTING,
+	CC_NODE_PROXY_JOINING,
+	CC_NODE_PROXY_TUNNELS,
+	CC_NODE_PROXY_SETUP,
+	CC_NODE_PROXY_CONNECTED
+} cc_node_proxy_state_t;
+
 typedef enum {
 	CC_NODE_STOP_CLEAN,
 	CC_NODE_STOP_MIGRATE
 } cc_node_stop_method_t;
 
+// reply handler, data is NULL if the request timed out
 typedef cc_result_t (*cc_msg_handler_t)(struct cc_node_t*, char*, size_t, void*);
 
+// request waiting for a reply, the slot is unused if id is empty
 typedef struct cc_pending_msg_t {
+	char id[CC_UUID_BUFFER_SIZE];
+	uint32_t hash;
+	uint64_t deadline;
 	cc_msg_handler_t handler;
 	void *msg_data;
 } cc_pending_msg_t;
@@ -54,7 +74,9 @@ typedef struct cc_node_t {
 	cc_node_stop_method_t stop_method;
 	char id[CC_UUID_BUFFER_SIZE];
 	char *attributes;
-	cc_list_t *pending_msgs;
+	cc_pending_msg_t pending_msgs[CC_MAX_PENDING_MSGS];
+	uint32_t nbr_of_pending_msgs;
+	uint64_t pending_msgs_deadline;
 	void *platform;
 	cc_link_t *proxy_link;
 	cc_list_t *links;
@@ -63,31 +85,81 @@ typedef struct cc_node_t {
 	cc_list_t *tunnels;
 	cc_list_t *actor_types;
 	cc_list_t *actors;
+	cc_actor_t *ready_actors;
+	cc_actor_t *ready_actors_tail;
+	uint32_t scheduler_pass;
+	cc_index_t actor_index;
+	cc_index_t port_index;
+	cc_index_t tunnel_index;
+	cc_index_t link_index;
 	cc_transport_client_t *transport_client;
 	cc_calvinsys_t *calvinsys;
 	cc_list_t *proxy_uris;
-	uint32_t seconds_since_epoch;
-	uint32_t time_at_sync;
+	cc_list_t *proxy_uri; // uri used or being tried
+	cc_list_t *proxy_transport_uri; // uri the transport client was created for
+	cc_node_proxy_state_t proxy_state;
+	uint64_t proxy_deadline; // end of the current connection step or backoff
+	uint32_t proxy_backoff; // ms to wait after all uris have failed
+	bool proxy_new;
+	uint64_t ms_since_epoch;
+	uint64_t time_at_sync;
 	bool (*fire_actors)(struct cc_node_t *node);
-#if CC_USE_FDS
-	fd_set fds;
+	volatile bool *stop_request; // set from another thread to stop a hosted node
+#if CC_USE_STORAGE
+	const char *state_file;
+	cc_list_t *restore_actors; // actors from the state not created yet, data is their record
+	char *restore_state; // mapped state file, kept while restore_actors refers to it
+	size_t restore_state_size;
+	char *restore_journal;
+#endif
+#if CC_USE_CHECKPOINTING
+	bool checkpoint_dirty; // links or tunnels changed
+	bool checkpoint_compact; // rewrite the state file on the next checkpoint
+	cc_list_t *checkpoint_removed; // ids of actors deleted since the last checkpoint
+	uint32_t checkpoint_epoch; // the journal only applies to the state file with the same epoch
+	uint32_t checkpoint_records;
+	size_t checkpoint_journal_size;
+	uint32_t checkpoint_changes; // handled messages not yet written
+	uint64_t checkpoint_deadline; // when the oldest unwritten change is written
+	uint64_t checkpoint_last; // time of the last checkpoint
+	uint32_t checkpoints_written;
+	uint64_t checkpoint_bytes; // bytes written by checkpoints
 #endif
 #if CC_USE_PYTHON
 	void *mpy_heap;
 #endif
 } cc_node_t;
 
+#if CC_USE_CHECKPOINTING
+#define cc_node_set_dirty(node) ((node)->checkpoint_dirty = true)
+#else
+#define cc_node_set_dirty(node) do {} while (0)
+#endif
+
 cc_result_t cc_node_add_pending_msg(cc_node_t *node, char *msg_uuid, cc_result_t (*handler)(cc_node_t *node, char *data, size_t data_len, void *msg_data), void *msg_data);
 void cc_node_remove_pending_msg(cc_node_t *node, char *msg_uuid);
 cc_pending_msg_t *cc_node_get_pending_msg(cc_node_t *node, const char *msg_uuid);
 bool cc_node_can_add_pending_msg(const cc_node_t *node);
-cc_result_t cc_node_handle_token(cc_port_t *port, const char *data, const size_t size, uint32_t sequencenbr);
-void cc_node_handle_token_reply(cc_node_t *node, char *port_id, uint32_t port_id_len, cc_port_reply_type_t reply_type, uint32_t sequencenbr);
+void cc_node_remove_pending_msgs_with_data(cc_node_t *node, const void *msg_data);
+void cc_node_pending_msgs_check(cc_node_t *node, uint32_t *timeout);
+cc_result_t cc_node_handle_token(cc_node_t *node, cc_port_t *port, const char *data, const size_t size, uint32_t sequencenbr);
+cc_result_t cc_node_handle_token_chunk(cc_node_t *node, cc_port_t *port, uint32_t sequencenbr, uint32_t size, uint32_t offset, const char *data, uint32_t len, bool *complete);
+void cc_node_handle_token_reply(cc_node_t *node, char *port_id, uint32_t port_id_len, cc_port_reply_type_t reply_type, uint32_t sequencenbr, uint32_t sequencenbr_end);
+void cc_node_handle_token_chunk_reply(cc_node_t *node, char *port_id, uint32_t port_id_len, uint32_t sequencenbr, uint32_t offset);
 cc_result_t cc_node_handle_message(cc_node_t *node, char *buffer, size_t len);
 cc_result_t cc_node_init(cc_node_t *node, const char *attributes, const char *proxy_uris);
 uint32_t cc_node_get_time(cc_node_t *node);
+uint64_t cc_node_get_time_ms(cc_node_t *node);
 cc_result_t cc_node_run(cc_node_t *node, const char *script);
 #if CC_USE_STORAGE
 void cc_node_set_state(cc_node_t *node, bool include_state);
+cc_result_t cc_node_restore_actor(cc_node_t *node, const char *actor_id, uint32_t actor_id_len);
+cc_result_t cc_node_restore_port(cc_node_t *node, const char *port_id, uint32_t port_id_len);
+void cc_node_restore_actors(cc_node_t *node);
+#endif
+#if CC_USE_CHECKPOINTING
+void cc_node_checkpoint(cc_node_t *node);
+void cc_node_checkpoint_changed(cc_node_t *node);
+void cc_node_checkpoint_check(cc_node_t *node, uint32_t *timeout);
 #endif
 #endif /* CC_NODE_H */
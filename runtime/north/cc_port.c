@@ -19,6 +19,7 @@
 #include "cc_port.h"
 #include "cc_node.h"
 #include "cc_proto.h"
+#include "scheduler/cc_scheduler.h"
 #include "coder/cc_coder.h"
 #include "runtime/south/platform/cc_platform.h"
 
@@ -26,6 +27,20 @@ static cc_port_t *cc_port_get_from_peer_port_id(struct cc_node_t *node, const ch
 static void cc_port_set_state(cc_port_t *port, cc_port_state_t state);
 static cc_result_t cc_port_get_tunnel(cc_node_t *node, cc_port_t *port);
 
+// a lookup or connect request timed out, retry if the port is still waiting for it
+static void cc_port_handle_reply_timeout(cc_node_t *node, const char *port_id, cc_port_state_t pending_state)
+{
+	cc_port_t *port = NULL;
+
+	port = cc_port_get(node, port_id, strnlen(port_id, CC_UUID_BUFFER_SIZE));
+	if (port == NULL || port->state != pending_state)
+		return;
+
+	cc_log_error("Port: Request for '%s' timed out", port->id);
+	cc_port_set_state(port, CC_PORT_DISCONNECTED);
+	cc_port_connect(node, port);
+}
+
 static cc_result_t cc_port_remove_reply_handler(cc_node_t *node, char *data, size_t data_len, void *msg_data)
 {
 	// No action
@@ -44,6 +59,9 @@ static cc_result_t cc_port_store_reply_handler(cc_node_t *node, char *data, size
 	uint32_t key_len = 0, status = 0;
 	cc_port_t *port = NULL;
 
+	if (data == NULL)
+		return CC_FAIL;
+
 	if (cc_coder_get_value_from_map(data, "value", &value) != CC_SUCCESS) {
 		cc_log_error("Failed to get 'value'");
 		return CC_FAIL;
@@ -87,6 +105,11 @@ static cc_result_t cc_port_get_peer_port_reply_handler(cc_node_t *node, char *da
 	char *value = NULL, *value_value = NULL, *key = NULL, *node_id = NULL;
 	uint32_t key_len = 0, node_id_len = 0;
 
+	if (data == NULL) {
+		cc_port_handle_reply_timeout(node, (char *)msg_data, CC_PORT_PENDING_LOOKUP);
+		return CC_SUCCESS;
+	}
+
 	if (cc_coder_get_value_from_map(data, "value", &value) != CC_SUCCESS) {
 		cc_log_error("Failed to get 'value'");
 		return CC_FAIL;
@@ -134,6 +157,11 @@ static cc_result_t cc_port_connect_reply_handler(cc_node_t *node, char *data, si
 	uint32_t status = 0, peer_port_id_len = 0;
 	cc_port_t *port = NULL;
 
+	if (data == NULL) {
+		cc_port_handle_reply_timeout(node, (char *)msg_data, CC_PORT_PENDING_CONNECT);
+		return CC_SUCCESS;
+	}
+
 	if (cc_coder_get_value_from_map(data, "value", &value) != CC_SUCCESS) {
 		cc_log_error("Failed to get 'value'");
 		return CC_FAIL;
@@ -162,8 +190,81 @@ static cc_result_t cc_port_connect_reply_handler(cc_node_t *node, char *data, si
 	return CC_SUCCESS;
 }
 
+void cc_port_clear_token_header(cc_port_t *port)
+{
+	if (port->token_header != NULL) {
+		cc_platform_mem_free((void *)port->token_header);
+		port->token_header = NULL;
+		port->token_header_len = 0;
+	}
+}
+
+static cc_result_t cc_port_buffer_sink_open(cc_port_t *port, uint32_t size)
+{
+	if (cc_platform_mem_alloc((void **)&port->chunk.buffer, size) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return CC_FAIL;
+	}
+
+	return CC_SUCCESS;
+}
+
+static cc_result_t cc_port_buffer_sink_write(cc_port_t *port, uint32_t offset, const char *data, uint32_t len)
+{
+	memcpy(port->chunk.buffer + offset, data, len);
+	return CC_SUCCESS;
+}
+
+static cc_result_t cc_port_buffer_sink_close(cc_port_t *port, bool complete, char **data, size_t *size)
+{
+	if (complete) {
+		*data = port->chunk.buffer;
+		*size = port->chunk.size;
+	} else
+		cc_platform_mem_free((void *)port->chunk.buffer);
+	port->chunk.buffer = NULL;
+
+	return CC_SUCCESS;
+}
+
+// reassembles chunked tokens in a buffer of the token size
+static const cc_port_sink_t cc_port_buffer_sink = {
+	cc_port_buffer_sink_open,
+	cc_port_buffer_sink_write,
+	cc_port_buffer_sink_close
+};
+
+// Chunked tokens to the port are reassembled in a buffer
+void cc_port_set_default_sink(cc_port_t *port)
+{
+	port->sink = &cc_port_buffer_sink;
+	port->sink_state = NULL;
+}
+
+void cc_port_clear_chunk(cc_port_t *port)
+{
+	char *data = NULL;
+	size_t size = 0;
+
+	if (!port->chunk.active)
+		return;
+
+	// outports resend the token from the start, inports drop the partial token
+	if (port->direction == CC_PORT_DIRECTION_OUT) {
+		cc_fifo_com_cancel_read(port->fifo, port->chunk.sequencenbr);
+		cc_actor_set_dirty(port->actor);
+	} else
+		port->sink->close(port, false, &data, &size);
+
+	memset(&port->chunk, 0, sizeof(cc_port_chunk_t));
+}
+
 void cc_port_set_state(cc_port_t *port, cc_port_state_t state)
 {
+	// peer and tunnel are only changed when the port is (re)connected
+	cc_port_clear_token_header(port);
+	cc_port_clear_chunk(port);
+
 	if (state == CC_PORT_ENABLED && port->state != CC_PORT_ENABLED) {
 		cc_log("Port: Enabled '%s'", port->id);
 		port->retries = 0;
@@ -305,6 +406,7 @@ cc_port_t *cc_port_create(cc_node_t *node, cc_actor_t *actor, char *obj_port, ch
 	port->actor = actor;
 	port->peer_port = NULL;
 	port->tunnel = NULL;
+	cc_port_set_default_sink(port);
 	strncpy(port->id, port_id, port_id_len);
 	port->id[port_id_len] = '\0';
 	strncpy(port->name, port_name, port_name_len);
@@ -359,6 +461,8 @@ void cc_port_free(cc_node_t *node, cc_port_t *port, bool remove_from_registry)
 {
 	cc_log("Port: Deleting '%s'", port->id);
 
+	cc_node_remove_pending_msgs_with_data(node, port->id);
+
 	if (remove_from_registry) {
 		if (cc_proto_send_remove_port(node, port, cc_port_remove_reply_handler) != CC_SUCCESS)
 			cc_log_error("Failed to remove port '%s'", port->id);
@@ -366,30 +470,24 @@ void cc_port_free(cc_node_t *node, cc_port_t *port, bool remove_from_registry)
 
 	if (port->tunnel != NULL)
 		cc_tunnel_remove_ref(node, port->tunnel);
+	cc_index_remove(&node->port_index, port->id, strnlen(port->id, CC_UUID_BUFFER_SIZE), port);
+	cc_port_clear_token_header(port);
+	cc_port_clear_chunk(port);
 	cc_fifo_free(port->fifo);
 	cc_platform_mem_free((void *)port);
 }
 
 cc_port_t *cc_port_get(cc_node_t *node, const char *port_id, uint32_t port_id_len)
 {
-	cc_list_t *port = NULL, *actors = node->actors;
-	cc_actor_t *actor = NULL;
-
-	while (actors != NULL) {
-		actor = (cc_actor_t *)actors->data;
+	cc_port_t *port = (cc_port_t *)cc_index_get(&node->port_index, port_id, port_id_len);
 
-		port = cc_list_get_n(actor->in_ports, port_id, port_id_len);
-		if (port != NULL)
-			return (cc_port_t *)port->data;
+#if CC_USE_STORAGE
+	// ports of restored actors are created with the actor when first used
+	if (port == NULL && node->restore_actors != NULL && cc_node_restore_port(node, port_id, port_id_len) == CC_SUCCESS)
+		port = (cc_port_t *)cc_index_get(&node->port_index, port_id, port_id_len);
+#endif
 
-		port = cc_list_get_n(actor->out_ports, port_id, port_id_len);
-		if (port != NULL)
-			return (cc_port_t *)port->data;
-
-		actors = actors->next;
-	}
-
-	return NULL;
+	return port;
 }
 
 cc_port_t *cc_port_get_from_peer_port_id(struct cc_node_t *node, const char *peer_port_id, uint32_t peer_port_id_len)
@@ -638,24 +736,137 @@ void cc_port_disconnect(cc_node_t *node, cc_port_t *port, bool unref_tunnel)
 	cc_fifo_cancel(port->fifo);
 }
 
+// Sends the next chunk of the token being transferred in chunks
+static cc_result_t cc_port_send_chunk(cc_node_t *node, cc_port_t *port)
+{
+	cc_token_t *token = NULL;
+	uint32_t len = 0;
+
+	token = cc_fifo_com_get(port->fifo, port->chunk.sequencenbr);
+	if (token == NULL) {
+		memset(&port->chunk, 0, sizeof(cc_port_chunk_t));
+		return CC_FAIL;
+	}
+
+	len = port->chunk.size - port->chunk.offset;
+	if (len > node->transport_client->token_chunk)
+		len = node->transport_client->token_chunk;
+
+	if (cc_proto_send_token_chunk(node, port, token, port->chunk.sequencenbr, port->chunk.offset, len) != CC_SUCCESS)
+		return CC_FAIL;
+
+	port->chunk.in_flight = true;
+
+	return CC_SUCCESS;
+}
+
+static bool cc_port_is_chunked(cc_node_t *node, cc_token_t *token)
+{
+	return node->transport_client->token_chunk > 0 && token->size > node->transport_client->token_chunk;
+}
+
+// Sends the token in one message or starts sending it in chunks if too large
+static cc_result_t cc_port_send_token(cc_node_t *node, cc_port_t *port, cc_token_t *token, uint32_t sequencenbr)
+{
+	if (!cc_port_is_chunked(node, token))
+		return cc_proto_send_token(node, port, token, sequencenbr);
+
+	port->chunk.active = true;
+	port->chunk.in_flight = false;
+	port->chunk.sequencenbr = sequencenbr;
+	port->chunk.size = token->size;
+	port->chunk.offset = 0;
+	if (cc_port_send_chunk(node, port) != CC_SUCCESS) {
+		memset(&port->chunk, 0, sizeof(cc_port_chunk_t));
+		return CC_FAIL;
+	}
+
+	return CC_SUCCESS;
+}
+
+// Send up to 'max' tokens in one message
+static void cc_port_transmit_batch(cc_node_t *node, cc_port_t *port, uint32_t max)
+{
+	cc_token_t *tokens[CC_TOKEN_BATCH_SIZE];
+	uint32_t sequencenbr = 0, first = 0, nbr_of_tokens = 0;
+	size_t size = 0;
+
+	while (nbr_of_tokens < max && cc_fifo_tokens_available(port->fifo, 1)) {
+		cc_fifo_com_peek(port->fifo, &tokens[nbr_of_tokens], &sequencenbr);
+		if (nbr_of_tokens == 0)
+			first = sequencenbr;
+		else if (size + tokens[nbr_of_tokens]->size > CC_TOKEN_BATCH_DATA_SIZE || cc_port_is_chunked(node, tokens[0])) {
+			cc_fifo_com_cancel_read(port->fifo, sequencenbr);
+			break;
+		}
+		size += tokens[nbr_of_tokens]->size;
+		nbr_of_tokens++;
+	}
+
+	if (nbr_of_tokens == 1) {
+		if (cc_port_send_token(node, port, tokens[0], first) != CC_SUCCESS)
+			cc_fifo_com_cancel_read(port->fifo, first);
+	} else if (cc_proto_send_token_batch(node, port, tokens, nbr_of_tokens, first) != CC_SUCCESS)
+		cc_fifo_com_cancel_read(port->fifo, first);
+}
+
+// Resend a nacked token or send new tokens if the window allows
+static void cc_port_transmit_remote(cc_node_t *node, cc_port_t *port)
+{
+	cc_token_t *token = NULL;
+	uint32_t sequencenbr = 0, window = 0;
+
+	// a chunked token is sent one chunk at a time, each chunk is acked before the next is sent
+	if (port->chunk.active) {
+		if (!port->chunk.in_flight && cc_port_send_chunk(node, port) != CC_SUCCESS)
+			cc_port_clear_chunk(port);
+		return;
+	}
+
+	if (cc_fifo_com_peek_nacked(port->fifo, &token, &sequencenbr)) {
+		if (cc_port_send_token(node, port, token, sequencenbr) != CC_SUCCESS)
+			cc_fifo_com_nack_read(port->fifo, sequencenbr, sequencenbr);
+		return;
+	}
+
+	if (cc_fifo_com_in_flight(port->fifo) >= CC_PORT_WINDOW_SIZE)
+		return;
+
+	window = CC_PORT_WINDOW_SIZE - cc_fifo_com_in_flight(port->fifo);
+	if (node->transport_client->token_batch > 1 && window > 1 && cc_fifo_tokens_available(port->fifo, 2))
+		cc_port_transmit_batch(node, port, window < node->transport_client->token_batch ? window : node->transport_client->token_batch);
+	else if (cc_fifo_tokens_available(port->fifo, 1)) {
+		cc_fifo_com_peek(port->fifo, &token, &sequencenbr);
+		if (cc_port_send_token(node, port, token, sequencenbr) != CC_SUCCESS)
+			cc_fifo_com_cancel_read(port->fifo, sequencenbr);
+	}
+}
+
 void cc_port_transmit(cc_node_t *node, cc_port_t *port)
 {
 	cc_token_t *token = NULL;
-	uint32_t sequencenbr = 0;
+	uint32_t sequencenbr = 0, tentative_read_pos = 0;
 
 	if (port->state == CC_PORT_ENABLED) {
 		if (port->actor->state == CC_ACTOR_ENABLED) {
 			if (port->direction == CC_PORT_DIRECTION_OUT) {
 				// send/move token
-				if (cc_fifo_tokens_available(port->fifo, 1)) {
+				if (port->tunnel != NULL) {
+					// the in-flight position is part of the checkpointed fifo
+					tentative_read_pos = port->fifo->tentative_read_pos;
+					cc_port_transmit_remote(node, port);
+					if (port->fifo->tentative_read_pos != tentative_read_pos)
+						cc_actor_set_dirty(port->actor);
+				} else if (cc_fifo_tokens_available(port->fifo, 1)) {
 					cc_fifo_com_peek(port->fifo, &token, &sequencenbr);
-					if (port->tunnel != NULL) {
-						if (cc_proto_send_token(node, port, token, sequencenbr) != CC_SUCCESS)
-							cc_fifo_com_cancel_read(port->fifo, sequencenbr);
-					} else if (port->peer_port != NULL) {
-						if (cc_fifo_write(port->peer_port->fifo, token->value, token->size) == CC_SUCCESS)
+					if (port->peer_port != NULL) {
+						if (cc_fifo_write_token(port->peer_port->fifo, token) == CC_SUCCESS) {
 							cc_fifo_commit_read(port->fifo, false);
-						else
+							// both fifos changed, checkpoint them together
+							cc_actor_set_dirty(port->actor);
+							cc_actor_set_dirty(port->peer_port->actor);
+							cc_scheduler_actor_ready(node, port->peer_port->actor);
+						} else
 							cc_fifo_cancel_commit(port->fifo);
 					} else {
 						cc_log_error("Port '%s' is enabled without a peer", port->id);
@@ -670,6 +881,22 @@ void cc_port_transmit(cc_node_t *node, cc_port_t *port)
 	}
 }
 
+size_t cc_port_get_prev_connections_size(const cc_port_t *port)
+{
+	size_t peer_id_len = strnlen(port->peer_id, CC_UUID_BUFFER_SIZE);
+	size_t size = 0;
+
+	size += cc_coder_sizeof_str(strnlen(port->id, CC_UUID_BUFFER_SIZE));
+	size += cc_coder_sizeof_array(1) + cc_coder_sizeof_array(2);
+	if (peer_id_len == 0)
+		size += cc_coder_sizeof_nil();
+	else
+		size += cc_coder_sizeof_str(peer_id_len);
+	size += cc_coder_sizeof_str(strnlen(port->peer_port_id, CC_UUID_BUFFER_SIZE));
+
+	return size;
+}
+
 char *cc_port_serialize_prev_connections(char *buffer, cc_port_t *port, const cc_node_t *node)
 {
 	size_t peer_id_len = strnlen(port->peer_id, CC_UUID_BUFFER_SIZE);
@@ -686,9 +913,59 @@ char *cc_port_serialize_prev_connections(char *buffer, cc_port_t *port, const cc
 	return buffer;
 }
 
+// Must be kept in line with cc_port_serialize_port
+size_t cc_port_get_serialized_size(const cc_port_t *port, bool include_state)
+{
+	size_t size = 0, id_len = strnlen(port->id, CC_UUID_BUFFER_SIZE);
+	size_t peer_port_id_len = strnlen(port->peer_port_id, CC_UUID_BUFFER_SIZE);
+	unsigned int nbr_port_attributes = 4, i_token = 0, slots = cc_fifo_get_serialized_slots(port->fifo);
+	cc_token_t empty = {NULL, 0, NULL}, *token = NULL;
+
+	if (include_state)
+		nbr_port_attributes += 1;
+
+	size += cc_coder_sizeof_key(port->name) + cc_coder_sizeof_map(nbr_port_attributes);
+	if (include_state)
+		size += cc_coder_sizeof_key("constrained_state") + cc_coder_sizeof_uint(port->state);
+	size += cc_coder_sizeof_key("id") + cc_coder_sizeof_str(id_len);
+	size += cc_coder_sizeof_key("name") + cc_coder_sizeof_str(strnlen(port->name, CC_MAX_PORT_NAME_LENGTH));
+	size += cc_coder_sizeof_key("queue") + cc_coder_sizeof_map(7);
+	size += cc_coder_sizeof_key("queuetype") + cc_coder_sizeof_str(11);
+	size += cc_coder_sizeof_key("write_pos") + cc_coder_sizeof_uint(port->fifo->write_pos);
+	size += cc_coder_sizeof_key("readers") + cc_coder_sizeof_array(1);
+	size += cc_coder_sizeof_key("N") + cc_coder_sizeof_uint(slots);
+	size += cc_coder_sizeof_key("tentative_read_pos") + cc_coder_sizeof_map(1);
+	size += cc_coder_sizeof_key("read_pos") + cc_coder_sizeof_map(1);
+	if (port->direction == CC_PORT_DIRECTION_IN) {
+		size += cc_coder_sizeof_str(id_len);
+		size += cc_coder_sizeof_key(port->id) + cc_coder_sizeof_uint(port->fifo->tentative_read_pos);
+		size += cc_coder_sizeof_key(port->id) + cc_coder_sizeof_uint(port->fifo->tentative_read_pos);
+	} else {
+		size += cc_coder_sizeof_str(peer_port_id_len);
+		size += cc_coder_sizeof_key(port->peer_port_id) + cc_coder_sizeof_uint(port->fifo->tentative_read_pos);
+		size += cc_coder_sizeof_key(port->peer_port_id) + cc_coder_sizeof_uint(port->fifo->read_pos);
+	}
+	size += cc_coder_sizeof_key("fifo") + cc_coder_sizeof_array(slots);
+	for (i_token = 0; i_token < slots; i_token++) {
+		token = cc_fifo_get_serialized_token(port->fifo, i_token);
+		size += cc_token_get_encoded_size(token != NULL ? token : &empty, false);
+	}
+	size += cc_coder_sizeof_key("properties") + cc_coder_sizeof_map(3);
+	size += cc_coder_sizeof_key("nbr_peers") + cc_coder_sizeof_uint(1);
+	size += cc_coder_sizeof_key("direction");
+	if (port->direction == CC_PORT_DIRECTION_IN)
+		size += cc_coder_sizeof_str(2);
+	else
+		size += cc_coder_sizeof_str(3);
+	size += cc_coder_sizeof_key("routing") + cc_coder_sizeof_str(7);
+
+	return size;
+}
+
 char *cc_port_serialize_port(char *buffer, cc_port_t *port, bool include_state)
 {
-	unsigned int nbr_port_attributes = 4, i_token = 0;
+	unsigned int nbr_port_attributes = 4, i_token = 0, slots = cc_fifo_get_serialized_slots(port->fifo);
+	cc_token_t empty = {NULL, 0, NULL}, *token = NULL;
 
 	if (include_state)
 		nbr_port_attributes += 1;
@@ -698,7 +975,7 @@ char *cc_port_serialize_port(char *buffer, cc_port_t *port, bool include_state)
 		if (include_state)
 			buffer = cc_coder_encode_kv_uint(buffer, "constrained_state", port->state);
 		buffer = cc_coder_encode_kv_str(buffer, "id", port->id, strnlen(port->id, CC_UUID_BUFFER_SIZE));
-		buffer = cc_coder_encode_kv_str(buffer, "name", port->name, strnlen(port->name, CC_UUID_BUFFER_SIZE));
+		buffer = cc_coder_encode_kv_str(buffer, "name", port->name, strnlen(port->name, CC_MAX_PORT_NAME_LENGTH));
 		buffer = cc_coder_encode_kv_map(buffer, "queue", 7);
 		{
 			buffer = cc_coder_encode_kv_str(buffer, "queuetype", "fanout_fifo", 11);
@@ -710,7 +987,7 @@ char *cc_port_serialize_port(char *buffer, cc_port_t *port, bool include_state)
 				else
 					buffer = cc_coder_encode_str(buffer, port->peer_port_id, strnlen(port->peer_port_id, CC_UUID_BUFFER_SIZE));
 			}
-			buffer = cc_coder_encode_kv_uint(buffer, "N", port->fifo->size);
+			buffer = cc_coder_encode_kv_uint(buffer, "N", slots);
 			buffer = cc_coder_encode_kv_map(buffer, "tentative_read_pos", 1);
 			{
 				if (port->direction == CC_PORT_DIRECTION_IN)
@@ -725,10 +1002,12 @@ char *cc_port_serialize_port(char *buffer, cc_port_t *port, bool include_state)
 				else
 					buffer = cc_coder_encode_kv_uint(buffer, port->peer_port_id, port->fifo->read_pos);
 			}
-			buffer = cc_coder_encode_kv_array(buffer, "fifo", port->fifo->size);
+			buffer = cc_coder_encode_kv_array(buffer, "fifo", slots);
 			{
-				for (i_token = 0; i_token < port->fifo->size; i_token++)
-					buffer = cc_token_encode(buffer, &port->fifo->tokens[i_token], false);
+				for (i_token = 0; i_token < slots; i_token++) {
+					token = cc_fifo_get_serialized_token(port->fifo, i_token);
+					buffer = cc_token_encode(buffer, token != NULL ? token : &empty, false);
+				}
 			}
 		}
 		buffer = cc_coder_encode_kv_map(buffer, "properties", 3);
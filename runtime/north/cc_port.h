@@ -46,6 +46,32 @@ typedef enum {
 	CC_PORT_REPLY_TYPE_ABORT
 } cc_port_reply_type_t;
 
+struct cc_port_t;
+
+/**
+ * struct cc_port_sink_t - Receives the data of chunked tokens on an inport
+ * @open: a token of size bytes starts, prepare to receive it
+ * @write: write len bytes of token data at offset
+ * @close: the transfer ended, if complete hand over the data to put in the fifo
+ *
+ * The default sink reassembles the token in a buffer allocated at open,
+ * actors may set their own sink, for example one that streams to a file.
+ */
+typedef struct cc_port_sink_t {
+	cc_result_t (*open)(struct cc_port_t *port, uint32_t size);
+	cc_result_t (*write)(struct cc_port_t *port, uint32_t offset, const char *data, uint32_t len);
+	cc_result_t (*close)(struct cc_port_t *port, bool complete, char **data, size_t *size);
+} cc_port_sink_t;
+
+typedef struct cc_port_chunk_t {
+	bool active;
+	bool in_flight; // outports, a chunk is sent and not yet acked
+	uint32_t sequencenbr;
+	uint32_t size;
+	uint32_t offset; // outports, offset of the next chunk to send, inports, bytes received
+	char *buffer; // inports, reassembly buffer of the default sink
+} cc_port_chunk_t;
+
 typedef struct cc_port_t {
 	char id[CC_UUID_BUFFER_SIZE];
 	char name[CC_MAX_PORT_NAME_LENGTH];
@@ -58,6 +84,13 @@ typedef struct cc_port_t {
 	cc_fifo_t *fifo;
 	uint8_t retries;
 	struct cc_actor_t *actor;
+	char *token_header; // encoded TOKEN message up to the token data, built on the first send after the port is enabled
+	uint32_t token_header_len;
+	uint32_t token_header_cmd_offset;
+	uint32_t token_header_seq_offset;
+	cc_port_chunk_t chunk; // token transferred in chunks, if any
+	const cc_port_sink_t *sink;
+	void *sink_state;
 } cc_port_t;
 
 cc_port_t *cc_port_create(struct cc_node_t *node, struct cc_actor_t *actor, char *obj_port, char *obj_prev_connections, cc_port_direction_t direction, char *obj_connection_list);
@@ -70,6 +103,11 @@ cc_result_t cc_port_handle_disconnect(struct cc_node_t *node, const char *port_i
 cc_result_t cc_port_handle_connect(struct cc_node_t *node, const char *port_id, uint32_t port_id_len, const char *tunnel_id, uint32_t tunnel_id_len);
 void cc_port_disconnect(struct cc_node_t *node, cc_port_t *port, bool unref_tunnel);
 void cc_port_transmit(struct cc_node_t *node, cc_port_t *port);
+void cc_port_clear_token_header(cc_port_t *port);
+void cc_port_set_default_sink(cc_port_t *port);
+void cc_port_clear_chunk(cc_port_t *port);
+size_t cc_port_get_prev_connections_size(const cc_port_t *port);
+size_t cc_port_get_serialized_size(const cc_port_t *port, bool include_state);
 char *cc_port_serialize_prev_connections(char *buffer, cc_port_t *port, const struct cc_node_t *node);
 char *cc_port_serialize_port(char *buffer, cc_port_t *port, bool include_state);
 
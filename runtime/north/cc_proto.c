@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "cc_proto.h"
 #include "coder/cc_coder.h"
@@ -26,23 +27,73 @@
 #define STRING_FALSE		"false"
 #define STRING_IN				"in"
 #define STRING_OUT			"out"
-#define NBR_OF_COMMANDS	9
+#define NBR_OF_COMMANDS	8
+
+// keys of the message root, decoded once per message
+enum {
+	PROTO_KEY_CMD,
+	PROTO_KEY_MSG_UUID,
+	PROTO_KEY_FROM_RT_UUID,
+	PROTO_KEY_TUNNEL_ID,
+	PROTO_KEY_VALUE,
+	PROTO_NBR_OF_KEYS
+};
+
+static const cc_coder_key_t proto_keys[PROTO_NBR_OF_KEYS] = {
+	CC_CODER_KEY("cmd"),
+	CC_CODER_KEY("msg_uuid"),
+	CC_CODER_KEY("from_rt_uuid"),
+	CC_CODER_KEY("tunnel_id"),
+	CC_CODER_KEY("value")
+};
+
+// keys of the 'value' map of TUNNEL_DATA messages
+enum {
+	PROTO_DATA_KEY_CMD,
+	PROTO_DATA_KEY_MSG_UUID,
+	PROTO_DATA_KEY_PEER_PORT_ID,
+	PROTO_DATA_KEY_PORT_ID,
+	PROTO_DATA_KEY_SEQUENCENBR,
+	PROTO_DATA_KEY_SEQUENCENBR_END,
+	PROTO_DATA_KEY_TOKEN,
+	PROTO_DATA_KEY_TOKENS,
+	PROTO_DATA_KEY_VALUE,
+	PROTO_DATA_KEY_METHOD,
+	PROTO_DATA_KEY_CHUNK,
+	PROTO_DATA_KEY_OFFSET,
+	PROTO_NBR_OF_DATA_KEYS
+};
+
+static const cc_coder_key_t proto_data_keys[PROTO_NBR_OF_DATA_KEYS] = {
+	CC_CODER_KEY("cmd"),
+	CC_CODER_KEY("msg_uuid"),
+	CC_CODER_KEY("peer_port_id"),
+	CC_CODER_KEY("port_id"),
+	CC_CODER_KEY("sequencenbr"),
+	CC_CODER_KEY("sequencenbr_end"),
+	CC_CODER_KEY("token"),
+	CC_CODER_KEY("tokens"),
+	CC_CODER_KEY("value"),
+	CC_CODER_KEY("method"),
+	CC_CODER_KEY("chunk"),
+	CC_CODER_KEY("offset")
+};
 
 struct command_handler_t {
 	char command[50];
-	cc_result_t (*handler)(cc_node_t *node, char *data, size_t data_len);
+	cc_result_t (*handler)(cc_node_t *node, char *data, size_t data_len, char **values);
 };
 
-static cc_result_t cc_proto_parse_reply(cc_node_t *node, char *data, size_t data_len);
-static cc_result_t cc_proto_parse_tunnel_data(cc_node_t *node, char *data, size_t data_len);
-static cc_result_t cc_proto_parse_actor_new(cc_node_t *node, char *data, size_t data_len);
-static cc_result_t cc_proto_parse_app_destroy(cc_node_t *node, char *data, size_t data_len);
-static cc_result_t cc_proto_parse_port_disconnect(cc_node_t *node, char *data, size_t data_len);
-static cc_result_t cc_proto_parse_port_connect(cc_node_t *node, char *data, size_t data_len);
-static cc_result_t cc_proto_parse_tunnel_new(cc_node_t *node, char *data, size_t data_len);
-static cc_result_t cc_proto_parse_actor_migrate(cc_node_t *node, char *data, size_t data_len);
+static cc_result_t cc_proto_parse_reply(cc_node_t *node, char *data, size_t data_len, char **values);
+static cc_result_t cc_proto_parse_tunnel_data(cc_node_t *node, char *data, size_t data_len, char **values);
+static cc_result_t cc_proto_parse_actor_new(cc_node_t *node, char *data, size_t data_len, char **values);
+static cc_result_t cc_proto_parse_app_destroy(cc_node_t *node, char *data, size_t data_len, char **values);
+static cc_result_t cc_proto_parse_port_disconnect(cc_node_t *node, char *data, size_t data_len, char **values);
+static cc_result_t cc_proto_parse_port_connect(cc_node_t *node, char *data, size_t data_len, char **values);
+static cc_result_t cc_proto_parse_tunnel_new(cc_node_t *node, char *data, size_t data_len, char **values);
+static cc_result_t cc_proto_parse_actor_migrate(cc_node_t *node, char *data, size_t data_len, char **values);
 
-struct command_handler_t command_handlers[NBR_OF_COMMANDS] = {
+static const struct command_handler_t command_handlers[NBR_OF_COMMANDS] = {
 	{"REPLY", cc_proto_parse_reply},
 	{"TUNNEL_DATA", cc_proto_parse_tunnel_data},
 	{"ACTOR_NEW", cc_proto_parse_actor_new},
@@ -65,10 +116,12 @@ cc_result_t cc_proto_send_join_request(const cc_node_t *node, cc_transport_clien
 	w = buffer + transport_client->prefix_len;
 	size = snprintf(w,
 		600 - transport_client->prefix_len,
-		"{\"cmd\": \"JOIN_REQUEST\", \"id\": \"%s\", \"sid\": \"%s\", \"serializers\": [\"%s\"]}",
+		"{\"cmd\": \"JOIN_REQUEST\", \"id\": \"%s\", \"sid\": \"%s\", \"serializers\": [\"%s\"], \"token_batch\": %d, \"token_chunk\": %d}",
 		node->id,
 		msg_uuid,
-		serializer);
+		serializer,
+		CC_TOKEN_BATCH_SIZE,
+		CC_TOKEN_CHUNK_SIZE);
 
 	return cc_transport_send(transport_client, buffer, size + transport_client->prefix_len);
 }
@@ -321,7 +374,7 @@ cc_result_t cc_proto_send_tunnel_destroy(cc_node_t *node, cc_tunnel_t *tunnel, c
 		w = cc_coder_encode_kv_str(w, "tunnel_id", tunnel->id, strnlen(tunnel->id, CC_UUID_BUFFER_SIZE));
 	}
 
-	if (cc_node_add_pending_msg(node, msg_uuid, handler, tunnel->id) == CC_SUCCESS) {
+	if (cc_node_add_pending_msg(node, msg_uuid, handler, NULL) == CC_SUCCESS) {
 		if (cc_transport_send(node->transport_client, buffer, w - buffer) == CC_SUCCESS)
 			return CC_SUCCESS;
 		cc_node_remove_pending_msg(node, msg_uuid);
@@ -507,13 +560,12 @@ cc_result_t cc_proto_send_port_disconnect_reply(const cc_node_t *node, char *msg
 	return cc_transport_send(node->transport_client, buffer, w - buffer);
 }
 
-cc_result_t cc_proto_send_token(const cc_node_t *node, cc_port_t *port, cc_token_t *token, uint32_t sequencenbr)
+// Encodes the TOKEN message of the port up to the token data, the sequencenbr
+// has a fixed size placeholder value
+static cc_result_t cc_proto_build_token_header(const cc_node_t *node, cc_port_t *port)
 {
-	char buffer[1000], *w = NULL;
-
-	memset(buffer, 0, 1000);
+	char buffer[400], *w = buffer;
 
-	w = buffer + node->transport_client->prefix_len;
 	w = cc_coder_encode_map(w, 5);
 	{
 		w = cc_coder_encode_kv_str(w, "to_rt_uuid", port->peer_id, strnlen(port->peer_id, CC_UUID_BUFFER_SIZE));
@@ -522,17 +574,116 @@ cc_result_t cc_proto_send_token(const cc_node_t *node, cc_port_t *port, cc_token
 		w = cc_coder_encode_kv_str(w, "tunnel_id", port->tunnel->id, strnlen(port->tunnel->id, CC_UUID_BUFFER_SIZE));
 		w = cc_coder_encode_kv_map(w, "value", 5);
 		{
-			w = cc_coder_encode_kv_str(w, "cmd", "TOKEN", 5);
-			w = cc_coder_encode_kv_uint(w, "sequencenbr", sequencenbr);
 			w = cc_coder_encode_kv_str(w, "port_id", port->id, strnlen(port->id, CC_UUID_BUFFER_SIZE));
 			w = cc_coder_encode_kv_str(w, "peer_port_id", port->peer_port_id, strnlen(port->peer_port_id, CC_UUID_BUFFER_SIZE));
-			w = cc_token_encode(w, token, true);
+			port->token_header_cmd_offset = w - buffer;
+			w = cc_coder_encode_kv_str(w, "cmd", "TOKEN", 5);
+			w = cc_coder_encode_str(w, "sequencenbr", 11);
+			port->token_header_seq_offset = w - buffer;
+			w = cc_coder_encode_uint32(w, 0);
+			w = cc_coder_encode_kv_map(w, "token", 2);
+			{
+				w = cc_coder_encode_kv_str(w, "type", "Token", 5);
+				w = cc_coder_encode_str(w, "data", 4);
+			}
 		}
 	}
 
+	if (cc_platform_mem_alloc((void **)&port->token_header, w - buffer) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return CC_FAIL;
+	}
+
+	memcpy(port->token_header, buffer, w - buffer);
+	port->token_header_len = w - buffer;
+
+	return CC_SUCCESS;
+}
+
+// Sends the prefix, the cached header and the token data as separate segments
+cc_result_t cc_proto_send_token(const cc_node_t *node, cc_port_t *port, cc_token_t *token, uint32_t sequencenbr)
+{
+	char prefix[node->transport_client->prefix_len], nil[1];
+	cc_transport_iovec_t iov[3];
+
+	if (port->token_header == NULL && cc_proto_build_token_header(node, port) != CC_SUCCESS)
+		return CC_FAIL;
+
+	memset(prefix, 0, sizeof(prefix));
+	cc_coder_encode_uint32(port->token_header + port->token_header_seq_offset, sequencenbr);
+
+	iov[0].base = prefix;
+	iov[0].len = sizeof(prefix);
+	iov[1].base = port->token_header;
+	iov[1].len = port->token_header_len;
+	if (token->size != 0) {
+		iov[2].base = token->value;
+		iov[2].len = token->size;
+	} else {
+		iov[2].base = nil;
+		iov[2].len = cc_coder_encode_nil(nil) - nil;
+	}
+
+	return cc_transport_sendv(node->transport_client, iov, 3);
+}
+
+cc_result_t cc_proto_send_token_batch(const cc_node_t *node, cc_port_t *port, cc_token_t **tokens, uint32_t nbr_of_tokens, uint32_t sequencenbr)
+{
+	char buffer[600 + CC_TOKEN_BATCH_DATA_SIZE + CC_TOKEN_BATCH_SIZE * 20], *w = NULL;
+	uint32_t i = 0;
+
+	if (port->token_header == NULL && cc_proto_build_token_header(node, port) != CC_SUCCESS)
+		return CC_FAIL;
+
+	memset(buffer, 0, node->transport_client->prefix_len);
+
+	// the envelope is shared with TOKEN up to the cmd
+	w = buffer + node->transport_client->prefix_len;
+	memcpy(w, port->token_header, port->token_header_cmd_offset);
+	w += port->token_header_cmd_offset;
+	w = cc_coder_encode_kv_str(w, "cmd", "TOKEN_BATCH", 11);
+	w = cc_coder_encode_kv_uint(w, "sequencenbr", sequencenbr);
+	w = cc_coder_encode_kv_array(w, "tokens", nbr_of_tokens);
+	for (i = 0; i < nbr_of_tokens; i++)
+		w = cc_token_encode(w, tokens[i], false);
+
 	return cc_transport_send(node->transport_client, buffer, w - buffer);
 }
 
+// Sends len bytes of the token data at offset as a TOKEN_CHUNK, the data is
+// sent as a separate segment
+cc_result_t cc_proto_send_token_chunk(const cc_node_t *node, cc_port_t *port, cc_token_t *token, uint32_t sequencenbr, uint32_t offset, uint32_t len)
+{
+	char buffer[600], *w = NULL;
+	cc_transport_iovec_t iov[2];
+
+	if (port->token_header == NULL && cc_proto_build_token_header(node, port) != CC_SUCCESS)
+		return CC_FAIL;
+
+	memset(buffer, 0, node->transport_client->prefix_len);
+
+	// the envelope is shared with TOKEN up to the cmd
+	w = buffer + node->transport_client->prefix_len;
+	memcpy(w, port->token_header, port->token_header_cmd_offset);
+	w += port->token_header_cmd_offset;
+	w = cc_coder_encode_kv_str(w, "cmd", "TOKEN_CHUNK", 11);
+	w = cc_coder_encode_kv_uint(w, "sequencenbr", sequencenbr);
+	w = cc_coder_encode_kv_map(w, "chunk", 3);
+	{
+		w = cc_coder_encode_kv_uint(w, "offset", offset);
+		w = cc_coder_encode_kv_uint(w, "size", token->size);
+		w = cc_coder_encode_str(w, "data", 4);
+		w = cc_coder_encode_bin_header(w, len);
+	}
+
+	iov[0].base = buffer;
+	iov[0].len = w - buffer;
+	iov[1].base = token->value + offset;
+	iov[1].len = len;
+
+	return cc_transport_sendv(node->transport_client, iov, 2);
+}
+
 cc_result_t cc_proto_send_port_connect(cc_node_t *node, cc_port_t *port, cc_msg_handler_t handler)
 {
 	char buffer[1000], *w = NULL, msg_uuid[CC_UUID_BUFFER_SIZE];
@@ -592,7 +743,7 @@ cc_result_t cc_proto_send_port_disconnect(cc_node_t *node, cc_port_t *port, cc_m
 		w = cc_coder_encode_kv_nil(w, "peer_port_dir");
 	}
 
-	if (cc_node_add_pending_msg(node, msg_uuid, handler, port->id) == CC_SUCCESS) {
+	if (cc_node_add_pending_msg(node, msg_uuid, handler, NULL) == CC_SUCCESS) {
 		if (cc_transport_send(node->transport_client, buffer, w - buffer) == CC_SUCCESS)
 			return CC_SUCCESS;
 		cc_node_remove_pending_msg(node, msg_uuid);
@@ -601,18 +752,39 @@ cc_result_t cc_proto_send_port_disconnect(cc_node_t *node, cc_port_t *port, cc_m
 	return CC_FAIL;
 }
 
+static size_t cc_proto_sizeof_kv_str(const char *key, uint32_t len)
+{
+	return cc_coder_sizeof_key(key) + cc_coder_sizeof_str(len);
+}
+
+static size_t cc_proto_sizeof_ports(cc_list_t *ports)
+{
+	cc_port_t *port = NULL;
+	size_t size = 0;
+
+	while (ports != NULL) {
+		port = (cc_port_t *)ports->data;
+		size += cc_coder_sizeof_map(2);
+		size += cc_proto_sizeof_kv_str("id", strlen(port->id));
+		size += cc_proto_sizeof_kv_str("name", strlen(port->name));
+		ports = ports->next;
+	}
+
+	return size;
+}
+
 cc_result_t cc_proto_send_set_actor(cc_node_t *node, const cc_actor_t*actor, cc_msg_handler_t handler)
 {
 	int key_len = 0;
-	char buffer[1000], *w = NULL, key[50] = "", msg_uuid[CC_UUID_BUFFER_SIZE];
+	char *buffer = NULL, *w = NULL, key[50] = "", msg_uuid[CC_UUID_BUFFER_SIZE];
 	cc_list_t *list = NULL;
 	cc_port_t *port = NULL;
-	uint32_t ninports = 0, noutports = 0, replication_len = 0;
+	uint32_t ninports = 0, noutports = 0, replication_id_len = 0, replication_master_len = 0;
 	uint32_t replication_index = 0;
-	char *obj_replication_id = NULL, *replication_str = NULL;
+	char *obj_replication_id = NULL, *replication_id = NULL, *replication_master = NULL, *tmp = NULL;
 	cc_list_t *item = NULL;
-
-	memset(buffer, 0, 1000);
+	size_t size = 0;
+	cc_result_t result = CC_FAIL;
 
 	key_len = snprintf(key, 50, "actor-%s", actor->id);
 
@@ -621,6 +793,48 @@ cc_result_t cc_proto_send_set_actor(cc_node_t *node, const cc_actor_t*actor, cc_
 	ninports = cc_list_count(actor->in_ports);
 	noutports = cc_list_count(actor->out_ports);
 
+	item = cc_list_get(actor->private_attributes, "_replication_id");
+	if (item != NULL && cc_coder_type_of(item->data) == CC_CODER_MAP) {
+		obj_replication_id = item->data;
+		if (cc_coder_decode_string_from_map(obj_replication_id, "id", &replication_id, &replication_id_len) != CC_SUCCESS)
+			replication_id = NULL;
+		if (cc_coder_decode_string_from_map(obj_replication_id, "original_actor_id", &replication_master, &replication_master_len) != CC_SUCCESS)
+			replication_master = NULL;
+		if (cc_coder_get_value_from_map(obj_replication_id, "index", &tmp) != CC_SUCCESS ||
+			cc_coder_decode_uint(tmp, &replication_index) != CC_SUCCESS)
+			replication_index = 0;
+	}
+
+	size = node->transport_client->prefix_len + cc_coder_sizeof_map(5);
+	size += cc_proto_sizeof_kv_str("from_rt_uuid", strnlen(node->id, CC_UUID_BUFFER_SIZE));
+	size += cc_proto_sizeof_kv_str("to_rt_uuid", strnlen(node->proxy_link->peer_id, CC_UUID_BUFFER_SIZE));
+	size += cc_proto_sizeof_kv_str("cmd", 11);
+	size += cc_proto_sizeof_kv_str("tunnel_id", strnlen(node->storage_tunnel->id, CC_UUID_BUFFER_SIZE));
+	size += cc_coder_sizeof_key("value") + cc_coder_sizeof_map(4);
+	size += cc_proto_sizeof_kv_str("msg_uuid", strnlen(msg_uuid, CC_UUID_BUFFER_SIZE));
+	size += cc_proto_sizeof_kv_str("cmd", 3);
+	size += cc_proto_sizeof_kv_str("key", key_len);
+	size += cc_coder_sizeof_key("value") + cc_coder_sizeof_map(obj_replication_id == NULL ? 6 : 9);
+	size += cc_coder_sizeof_key("is_shadow") + cc_coder_sizeof_bool(false);
+	size += cc_proto_sizeof_kv_str("name", strlen(actor->name));
+	size += cc_proto_sizeof_kv_str("node_id", strlen(node->id));
+	size += cc_proto_sizeof_kv_str("type", strlen(actor->type));
+	size += cc_coder_sizeof_key("inports") + cc_coder_sizeof_array(ninports) + cc_proto_sizeof_ports(actor->in_ports);
+	size += cc_coder_sizeof_key("outports") + cc_coder_sizeof_array(noutports) + cc_proto_sizeof_ports(actor->out_ports);
+	if (obj_replication_id != NULL) {
+		size += cc_coder_sizeof_key("replication_id");
+		size += replication_id != NULL ? cc_coder_sizeof_str(replication_id_len) : cc_coder_sizeof_nil();
+		size += cc_coder_sizeof_key("replication_master_id");
+		size += replication_master != NULL ? cc_coder_sizeof_str(replication_master_len) : cc_coder_sizeof_nil();
+		size += cc_coder_sizeof_key("replication_index") + cc_coder_sizeof_uint(replication_index);
+	}
+
+	if (cc_platform_mem_alloc((void **)&buffer, size) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return CC_FAIL;
+	}
+	memset(buffer, 0, node->transport_client->prefix_len);
+
 	w = buffer + node->transport_client->prefix_len;
 	w = cc_coder_encode_map(w, 5);
 	{
@@ -633,12 +847,10 @@ cc_result_t cc_proto_send_set_actor(cc_node_t *node, const cc_actor_t*actor, cc_
 			w = cc_coder_encode_kv_str(w, "msg_uuid", msg_uuid, strnlen(msg_uuid, CC_UUID_BUFFER_SIZE));
 			w = cc_coder_encode_kv_str(w, "cmd", "SET", 3);
 			w = cc_coder_encode_kv_str(w, "key", key, key_len);
-			item = cc_list_get(actor->private_attributes, "_replication_id");
-			if (item == NULL || cc_coder_type_of(item->data) != CC_CODER_MAP) {
+			if (obj_replication_id == NULL)
 				w = cc_coder_encode_kv_map(w, "value", 6);
-			} else {
+			else
 				w = cc_coder_encode_kv_map(w, "value", 9);
-			}
 			{
 				w = cc_coder_encode_kv_bool(w, "is_shadow", false);
 				w = cc_coder_encode_kv_str(w, "name", actor->name, strlen(actor->name));
@@ -666,24 +878,16 @@ cc_result_t cc_proto_send_set_actor(cc_node_t *node, const cc_actor_t*actor, cc_
 						list = list->next;
 					}
 				}
-				if (item != NULL && cc_coder_type_of(item->data) == CC_CODER_MAP) {
-					obj_replication_id = item->data;
-					if (cc_coder_decode_string_from_map(obj_replication_id, "id", &replication_str, &replication_len) == CC_SUCCESS) {
-						w = cc_coder_encode_kv_str(w, "replication_id", replication_str, replication_len);
-					} else {
+				if (obj_replication_id != NULL) {
+					if (replication_id != NULL)
+						w = cc_coder_encode_kv_str(w, "replication_id", replication_id, replication_id_len);
+					else
 						w = cc_coder_encode_kv_nil(w, "replication_id");
-					}
-					if (cc_coder_decode_string_from_map(obj_replication_id, "original_actor_id", &replication_str, &replication_len) == CC_SUCCESS) {
-						w = cc_coder_encode_kv_str(w, "replication_master_id", replication_str, replication_len);
-					} else {
+					if (replication_master != NULL)
+						w = cc_coder_encode_kv_str(w, "replication_master_id", replication_master, replication_master_len);
+					else
 						w = cc_coder_encode_kv_nil(w, "replication_master_id");
-					}
-					if (cc_coder_get_value_from_map(obj_replication_id, "index", &replication_str) == CC_SUCCESS &&
-						cc_coder_decode_uint(replication_str, &replication_index) == CC_SUCCESS) {
-						w = cc_coder_encode_kv_uint(w, "replication_index", replication_index);
-					} else {
-						w = cc_coder_encode_kv_uint(w, "replication_index", 0);
-					}
+					w = cc_coder_encode_kv_uint(w, "replication_index", replication_index);
 				}
 			}
 		}
@@ -691,11 +895,14 @@ cc_result_t cc_proto_send_set_actor(cc_node_t *node, const cc_actor_t*actor, cc_
 
 	if (cc_node_add_pending_msg(node, msg_uuid, handler, actor->id) == CC_SUCCESS) {
 		if (cc_transport_send(node->transport_client, buffer, w - buffer) == CC_SUCCESS)
-			return CC_SUCCESS;
-		cc_node_remove_pending_msg(node, msg_uuid);
+			result = CC_SUCCESS;
+		else
+			cc_node_remove_pending_msg(node, msg_uuid);
 	}
 
-	return CC_FAIL;
+	cc_platform_mem_free(buffer);
+
+	return result;
 }
 
 cc_result_t cc_proto_send_remove_actor(cc_node_t *node, cc_actor_t*actor, cc_msg_handler_t handler)
@@ -950,7 +1157,7 @@ cc_result_t cc_proto_send_remove_port(cc_node_t *node, cc_port_t *port, cc_msg_h
 		}
 	}
 
-	if (cc_node_add_pending_msg(node, msg_uuid, handler, port->id) == CC_SUCCESS) {
+	if (cc_node_add_pending_msg(node, msg_uuid, handler, NULL) == CC_SUCCESS) {
 		if (cc_transport_send(node->transport_client, buffer, w - buffer) == CC_SUCCESS)
 			return CC_SUCCESS;
 		cc_node_remove_pending_msg(node, msg_uuid);
@@ -961,10 +1168,31 @@ cc_result_t cc_proto_send_remove_port(cc_node_t *node, cc_port_t *port, cc_msg_h
 
 cc_result_t cc_proto_send_actor_new(cc_node_t *node, cc_actor_t *actor, char *to_rt_uuid, uint32_t to_rt_uuid_len, cc_msg_handler_t handler)
 {
-	char buffer[3000] = {0}, *w = NULL, msg_uuid[CC_UUID_BUFFER_SIZE];
+	char *buffer = NULL, *w = NULL, msg_uuid[CC_UUID_BUFFER_SIZE];
+	size_t size = 0, actor_size = 0;
+	cc_result_t result = CC_FAIL;
 
 	cc_gen_uuid(msg_uuid, "MSGID_");
 
+	actor_size = cc_actor_get_serialized_size(node, actor, false);
+	if (actor_size == 0) {
+		cc_log_error("Failed to serialize actor");
+		return CC_FAIL;
+	}
+
+	size = node->transport_client->prefix_len + cc_coder_sizeof_map(5);
+	size += cc_proto_sizeof_kv_str("to_rt_uuid", to_rt_uuid_len);
+	size += cc_proto_sizeof_kv_str("from_rt_uuid", strnlen(node->id, CC_UUID_BUFFER_SIZE));
+	size += cc_proto_sizeof_kv_str("cmd", 9);
+	size += cc_proto_sizeof_kv_str("msg_uuid", strnlen(msg_uuid, CC_UUID_BUFFER_SIZE));
+	size += actor_size;
+
+	if (cc_platform_mem_alloc((void **)&buffer, size) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return CC_FAIL;
+	}
+	memset(buffer, 0, node->transport_client->prefix_len);
+
 	w = buffer + node->transport_client->prefix_len;
 	w = cc_coder_encode_map(w, 5);
 	{
@@ -975,25 +1203,34 @@ cc_result_t cc_proto_send_actor_new(cc_node_t *node, cc_actor_t *actor, char *to
 		w = cc_actor_serialize(node, actor, w, false);
 	}
 
+	if (w == NULL) {
+		cc_log_error("Failed to serialize actor");
+		cc_platform_mem_free(buffer);
+		return CC_FAIL;
+	}
+
 	if (cc_node_add_pending_msg(node, msg_uuid, handler, actor->id) == CC_SUCCESS) {
 		if (cc_transport_send(node->transport_client, buffer, w - buffer) == CC_SUCCESS)
-			return CC_SUCCESS;
-		cc_node_remove_pending_msg(node, msg_uuid);
+			result = CC_SUCCESS;
+		else
+			cc_node_remove_pending_msg(node, msg_uuid);
 	}
 
-	return CC_FAIL;
+	cc_platform_mem_free(buffer);
+
+	return result;
 }
 
-static cc_result_t cc_proto_parse_reply(cc_node_t *node, char *data, size_t data_len)
+static cc_result_t cc_proto_parse_reply(cc_node_t *node, char *data, size_t data_len, char **values)
 {
-	cc_result_t result = CC_SUCCESS;
-	char *tmp = NULL, *r = data, msg_uuid[CC_UUID_BUFFER_SIZE];
-	cc_pending_msg_t *pending_msg = NULL;
+	char *tmp = NULL, msg_uuid[CC_UUID_BUFFER_SIZE];
+	cc_pending_msg_t *pending_msg = NULL, msg;
 	uint32_t len = 0;
 
-	memset(msg_uuid, 0, CC_UUID_BUFFER_SIZE);
+	if (values[PROTO_KEY_MSG_UUID] == NULL || cc_coder_decode_str(values[PROTO_KEY_MSG_UUID], &tmp, &len) != CC_SUCCESS)
+		return CC_FAIL;
 
-	if (cc_coder_decode_string_from_map(r, "msg_uuid", &tmp, &len) != CC_SUCCESS)
+	if (len >= CC_UUID_BUFFER_SIZE)
 		return CC_FAIL;
 
 	strncpy(msg_uuid, tmp, len);
@@ -1005,147 +1242,284 @@ static cc_result_t cc_proto_parse_reply(cc_node_t *node, char *data, size_t data
 		return CC_SUCCESS;
 	}
 
-	result = pending_msg->handler(node, data, data_len, pending_msg->msg_data);
+	// the handler may add or remove pending msgs
+	msg = *pending_msg;
 	cc_node_remove_pending_msg(node, msg_uuid);
-	return result;
+	return msg.handler(node, data, data_len, msg.msg_data);
 }
 
-static cc_result_t proto_parse_token(cc_node_t *node, char *root)
+// Encodes a reply to the TUNNEL_DATA message in values up to and including the
+// cmd in the 'value' map, the caller encodes the remaining nbr_of_items
+static char *proto_encode_token_reply(cc_node_t *node, char *buffer, char **values, char **data_values, const char *cmd, uint32_t nbr_of_items)
+{
+	char *w = buffer;
+	char *from_rt_uuid = NULL, *tunnel_id = NULL, *port_id = NULL, *peer_port_id = NULL;
+	uint32_t from_rt_uuid_len = 0, tunnel_id_len = 0, port_id_len = 0, peer_port_id_len = 0;
+
+	if (values[PROTO_KEY_FROM_RT_UUID] == NULL || cc_coder_decode_str(values[PROTO_KEY_FROM_RT_UUID], &from_rt_uuid, &from_rt_uuid_len) != CC_SUCCESS) {
+		cc_log_error("Failed to decode 'from_rt_uuid'");
+		return NULL;
+	}
+
+	if (values[PROTO_KEY_TUNNEL_ID] == NULL || cc_coder_decode_str(values[PROTO_KEY_TUNNEL_ID], &tunnel_id, &tunnel_id_len) != CC_SUCCESS) {
+		cc_log_error("Failed to decode 'tunnel_id'");
+		return NULL;
+	}
+
+	if (data_values[PROTO_DATA_KEY_PEER_PORT_ID] == NULL || cc_coder_decode_str(data_values[PROTO_DATA_KEY_PEER_PORT_ID], &port_id, &port_id_len) != CC_SUCCESS) {
+		cc_log_error("Failed to decode 'peer_port_id'");
+		return NULL;
+	}
+
+	if (data_values[PROTO_DATA_KEY_PORT_ID] == NULL || cc_coder_decode_str(data_values[PROTO_DATA_KEY_PORT_ID], &peer_port_id, &peer_port_id_len) != CC_SUCCESS) {
+		cc_log_error("Failed to decode 'port_id'");
+		return NULL;
+	}
+
+	w = cc_coder_encode_map(w, 5);
+	w = cc_coder_encode_kv_str(w, "to_rt_uuid", from_rt_uuid, from_rt_uuid_len);
+	w = cc_coder_encode_kv_str(w, "from_rt_uuid", node->id, strnlen(node->id, CC_UUID_BUFFER_SIZE));
+	w = cc_coder_encode_kv_str(w, "cmd", "TUNNEL_DATA", 11);
+	w = cc_coder_encode_kv_str(w, "tunnel_id", tunnel_id, tunnel_id_len);
+	w = cc_coder_encode_kv_map(w, "value", 3 + nbr_of_items);
+	w = cc_coder_encode_kv_str(w, "peer_port_id", port_id, port_id_len);
+	w = cc_coder_encode_kv_str(w, "port_id", peer_port_id, peer_port_id_len);
+	w = cc_coder_encode_kv_str(w, "cmd", cmd, strlen(cmd));
+
+	return w;
+}
+
+// Acks/nacks the tokens with sequence numbers first to last
+static cc_result_t proto_send_token_reply(cc_node_t *node, char **values, char **data_values, uint32_t first, uint32_t last, bool ack)
+{
+	char respbuffer[400], *w = NULL;
+
+	memset(respbuffer, 0, 400);
+	w = proto_encode_token_reply(node, respbuffer + node->transport_client->prefix_len, values, data_values, "TOKEN_REPLY", first == last ? 2 : 3);
+	if (w == NULL)
+		return CC_FAIL;
+
+	w = cc_coder_encode_kv_uint(w, "sequencenbr", first);
+	if (first != last)
+		w = cc_coder_encode_kv_uint(w, "sequencenbr_end", last);
+	w = cc_coder_encode_kv_str(w, "value", ack ? "ACK" : "NACK", ack ? 3 : 4);
+
+	return cc_transport_send(node->transport_client, respbuffer, w - respbuffer);
+}
+
+// Acks a chunk of a token, offset is where the next chunk starts
+static cc_result_t proto_send_token_chunk_reply(cc_node_t *node, char **values, char **data_values, uint32_t sequencenbr, uint32_t offset)
 {
 	char respbuffer[400], *w = NULL;
-	char *obj_value = NULL, *obj_token = NULL, *obj_data = NULL;
-	char *from_rt_uuid = NULL, *tunnel_id = NULL, *port_id = NULL;
-	char *peer_port_id = NULL, *r = root;
-	uint32_t sequencenbr = 0, port_id_len = 0, peer_port_id_len = 0;
-	uint32_t from_rt_uuid_len = 0, tunnel_id_len = 0;
+
+	memset(respbuffer, 0, 400);
+	w = proto_encode_token_reply(node, respbuffer + node->transport_client->prefix_len, values, data_values, "TOKEN_CHUNK_REPLY", 2);
+	if (w == NULL)
+		return CC_FAIL;
+
+	w = cc_coder_encode_kv_uint(w, "sequencenbr", sequencenbr);
+	w = cc_coder_encode_kv_uint(w, "offset", offset);
+
+	return cc_transport_send(node->transport_client, respbuffer, w - respbuffer);
+}
+
+static cc_result_t proto_parse_token(cc_node_t *node, char **values, char **data_values)
+{
+	char *obj_data = NULL, *port_id = NULL;
+	uint32_t sequencenbr = 0, port_id_len = 0;
 	size_t size = 0;
 	cc_port_t *port = NULL;
 	bool ack = false;
 
-	if (cc_coder_decode_string_from_map(r, "from_rt_uuid", &from_rt_uuid, &from_rt_uuid_len) != CC_SUCCESS) {
-		cc_log_error("Failed to decode 'from_rt_uuid'");
+	if (data_values[PROTO_DATA_KEY_PEER_PORT_ID] == NULL || cc_coder_decode_str(data_values[PROTO_DATA_KEY_PEER_PORT_ID], &port_id, &port_id_len) != CC_SUCCESS) {
+		cc_log_error("Failed to decode 'peer_port_id'");
 		return CC_FAIL;
 	}
 
-	if (cc_coder_decode_string_from_map(r, "tunnel_id", &tunnel_id, &tunnel_id_len) != CC_SUCCESS) {
-		cc_log_error("Failed to decode 'tunnel_id'");
+	if (data_values[PROTO_DATA_KEY_SEQUENCENBR] == NULL || cc_coder_decode_uint(data_values[PROTO_DATA_KEY_SEQUENCENBR], &sequencenbr) != CC_SUCCESS) {
+		cc_log_error("Failed to decode 'sequencenbr'");
 		return CC_FAIL;
 	}
 
-	if (cc_coder_get_value_from_map(r, "value", &obj_value) != CC_SUCCESS) {
-		cc_log_error("Failed to decode 'value'");
+	if (data_values[PROTO_DATA_KEY_TOKEN] == NULL || cc_coder_get_value_from_map(data_values[PROTO_DATA_KEY_TOKEN], "data", &obj_data) != CC_SUCCESS) {
+		cc_log_error("Failed to decode 'data'");
 		return CC_FAIL;
 	}
 
-	if (cc_coder_decode_string_from_map(obj_value, "peer_port_id", &port_id, &port_id_len) != CC_SUCCESS) {
+	port = cc_port_get(node, port_id, port_id_len);
+	if (port != NULL) {
+		size = cc_coder_get_size_of_value(obj_data);
+		if (cc_node_handle_token(node, port, obj_data, size, sequencenbr) == CC_SUCCESS)
+			ack = true;
+	}
+
+	return proto_send_token_reply(node, values, data_values, sequencenbr, sequencenbr, ack);
+}
+
+static cc_result_t proto_parse_token_batch(cc_node_t *node, char **values, char **data_values)
+{
+	char *obj_tokens = NULL, *obj_token = NULL, *obj_data = NULL, *port_id = NULL;
+	uint32_t sequencenbr = 0, port_id_len = 0, nbr_of_tokens = 0, i = 0;
+	cc_port_t *port = NULL;
+
+	if (data_values[PROTO_DATA_KEY_PEER_PORT_ID] == NULL || cc_coder_decode_str(data_values[PROTO_DATA_KEY_PEER_PORT_ID], &port_id, &port_id_len) != CC_SUCCESS) {
 		cc_log_error("Failed to decode 'peer_port_id'");
 		return CC_FAIL;
 	}
 
-	if (cc_coder_decode_string_from_map(obj_value, "port_id", &peer_port_id, &peer_port_id_len) != CC_SUCCESS) {
-		cc_log_error("Failed to decode 'port_id'");
+	if (data_values[PROTO_DATA_KEY_SEQUENCENBR] == NULL || cc_coder_decode_uint(data_values[PROTO_DATA_KEY_SEQUENCENBR], &sequencenbr) != CC_SUCCESS) {
+		cc_log_error("Failed to decode 'sequencenbr'");
 		return CC_FAIL;
 	}
 
-	if (cc_coder_decode_uint_from_map(obj_value, "sequencenbr", &sequencenbr) != CC_SUCCESS) {
-		cc_log_error("Failed to decode 'sequencenbr'");
+	obj_tokens = data_values[PROTO_DATA_KEY_TOKENS];
+	if (obj_tokens == NULL || cc_coder_type_of(obj_tokens) != CC_CODER_ARRAY) {
+		cc_log_error("Failed to decode 'tokens'");
+		return CC_FAIL;
+	}
+
+	nbr_of_tokens = cc_coder_decode_array(&obj_tokens);
+	if (nbr_of_tokens == 0)
+		return CC_SUCCESS;
+
+	// accept tokens in order until one is rejected, duplicates are acked without being stored
+	port = cc_port_get(node, port_id, port_id_len);
+	if (port != NULL) {
+		for (i = 0, obj_token = obj_tokens; i < nbr_of_tokens; i++, cc_coder_decode_array_next(&obj_token)) {
+			if (cc_coder_get_value_from_map(obj_token, "data", &obj_data) != CC_SUCCESS)
+				break;
+			if (cc_node_handle_token(node, port, obj_data, cc_coder_get_size_of_value(obj_data), sequencenbr + i) != CC_SUCCESS)
+				break;
+		}
+	}
+
+	if (i > 0 && proto_send_token_reply(node, values, data_values, sequencenbr, sequencenbr + i - 1, true) != CC_SUCCESS)
+		return CC_FAIL;
+
+	// the rejected token and the ones after it are resent by the sender
+	if (i < nbr_of_tokens)
+		return proto_send_token_reply(node, values, data_values, sequencenbr + i, sequencenbr + nbr_of_tokens - 1, false);
+
+	return CC_SUCCESS;
+}
+
+static cc_result_t proto_parse_token_chunk(cc_node_t *node, char **values, char **data_values)
+{
+	char *obj_chunk = NULL, *data = NULL, *port_id = NULL;
+	uint32_t sequencenbr = 0, port_id_len = 0, offset = 0, size = 0, len = 0;
+	cc_port_t *port = NULL;
+	bool complete = false;
+
+	if (data_values[PROTO_DATA_KEY_PEER_PORT_ID] == NULL || cc_coder_decode_str(data_values[PROTO_DATA_KEY_PEER_PORT_ID], &port_id, &port_id_len) != CC_SUCCESS) {
+		cc_log_error("Failed to decode 'peer_port_id'");
 		return CC_FAIL;
 	}
 
-	if (cc_coder_get_value_from_map(obj_value, "token", &obj_token) != CC_SUCCESS) {
-		cc_log_error("Failed to decode 'token'");
+	if (data_values[PROTO_DATA_KEY_SEQUENCENBR] == NULL || cc_coder_decode_uint(data_values[PROTO_DATA_KEY_SEQUENCENBR], &sequencenbr) != CC_SUCCESS) {
+		cc_log_error("Failed to decode 'sequencenbr'");
 		return CC_FAIL;
 	}
 
-	if (cc_coder_get_value_from_map(obj_token, "data", &obj_data) != CC_SUCCESS) {
-		cc_log_error("Failed to decode 'data'");
+	obj_chunk = data_values[PROTO_DATA_KEY_CHUNK];
+	if (obj_chunk == NULL ||
+		cc_coder_decode_uint_from_map(obj_chunk, "offset", &offset) != CC_SUCCESS ||
+		cc_coder_decode_uint_from_map(obj_chunk, "size", &size) != CC_SUCCESS ||
+		cc_coder_decode_bin_from_map(obj_chunk, "data", &data, &len) != CC_SUCCESS) {
+		cc_log_error("Failed to decode 'chunk'");
 		return CC_FAIL;
 	}
 
+	// intermediate chunks are acked with the next offset, the last one acks the token
 	port = cc_port_get(node, port_id, port_id_len);
-	if (port != NULL) {
-		size = cc_coder_get_size_of_value(obj_data);
-		if (cc_node_handle_token(port, obj_data, size, sequencenbr) == CC_SUCCESS)
-			ack = true;
+	if (port != NULL && cc_node_handle_token_chunk(node, port, sequencenbr, size, offset, data, len, &complete) == CC_SUCCESS) {
+		if (!complete)
+			return proto_send_token_chunk_reply(node, values, data_values, sequencenbr, offset + len);
+		return proto_send_token_reply(node, values, data_values, sequencenbr, sequencenbr, true);
 	}
 
-	memset(respbuffer, 0, 400);
-	w = respbuffer + node->transport_client->prefix_len;
-	w = cc_coder_encode_map(w, 5);
-	{
-		w = cc_coder_encode_kv_str(w, "to_rt_uuid", from_rt_uuid, from_rt_uuid_len);
-		w = cc_coder_encode_kv_str(w, "from_rt_uuid", node->id, strnlen(node->id, CC_UUID_BUFFER_SIZE));
-		w = cc_coder_encode_kv_str(w, "cmd", "TUNNEL_DATA", 11);
-		w = cc_coder_encode_kv_str(w, "tunnel_id", tunnel_id, tunnel_id_len);
-		w = cc_coder_encode_kv_map(w, "value", 5);
-		{
-			w = cc_coder_encode_kv_str(w, "cmd", "TOKEN_REPLY", 11);
-			w = cc_coder_encode_kv_uint(w, "sequencenbr", sequencenbr);
-			w = cc_coder_encode_kv_str(w, "peer_port_id", port_id, port_id_len);
-			w = cc_coder_encode_kv_str(w, "port_id", peer_port_id, peer_port_id_len);
-			w = cc_coder_encode_kv_str(w, "value", ack ? "ACK" : "NACK", ack ? 3 : 4);
-		}
-	}
+	return proto_send_token_reply(node, values, data_values, sequencenbr, sequencenbr, false);
+}
 
-	return cc_transport_send(node->transport_client, respbuffer, w - respbuffer);
+static cc_result_t proto_parse_token_chunk_reply(cc_node_t *node, char **data_values)
+{
+	char *port_id = NULL;
+	uint32_t sequencenbr = 0, offset = 0, port_id_len = 0;
+
+	if (data_values[PROTO_DATA_KEY_PORT_ID] == NULL || cc_coder_decode_str(data_values[PROTO_DATA_KEY_PORT_ID], &port_id, &port_id_len) != CC_SUCCESS)
+		return CC_FAIL;
+
+	if (data_values[PROTO_DATA_KEY_SEQUENCENBR] == NULL || cc_coder_decode_uint(data_values[PROTO_DATA_KEY_SEQUENCENBR], &sequencenbr) != CC_SUCCESS)
+		return CC_FAIL;
+
+	if (data_values[PROTO_DATA_KEY_OFFSET] == NULL || cc_coder_decode_uint(data_values[PROTO_DATA_KEY_OFFSET], &offset) != CC_SUCCESS)
+		return CC_FAIL;
+
+	cc_node_handle_token_chunk_reply(node, port_id, port_id_len, sequencenbr, offset);
+
+	return CC_SUCCESS;
 }
 
-static cc_result_t proto_parse_token_reply(cc_node_t *node, char *root)
+static cc_result_t proto_parse_token_reply(cc_node_t *node, char **data_values)
 {
-	char *value = NULL, *r = root, *port_id = NULL, *status = NULL;
-	uint32_t sequencenbr = 0, port_id_len = 0, status_len = 0;
+	char *port_id = NULL, *status = NULL;
+	uint32_t sequencenbr = 0, sequencenbr_end = 0, port_id_len = 0, status_len = 0;
+	cc_port_reply_type_t reply_type = CC_PORT_REPLY_TYPE_ACK;
 
 	cc_log_debug("proto_parse_token_reply");
 
-	if (cc_coder_get_value_from_map(r, "value", &value) != CC_SUCCESS)
+	if (data_values[PROTO_DATA_KEY_PORT_ID] == NULL || cc_coder_decode_str(data_values[PROTO_DATA_KEY_PORT_ID], &port_id, &port_id_len) != CC_SUCCESS)
 		return CC_FAIL;
 
-	if (cc_coder_decode_string_from_map(value, "port_id", &port_id, &port_id_len) != CC_SUCCESS)
+	if (data_values[PROTO_DATA_KEY_VALUE] == NULL || cc_coder_decode_str(data_values[PROTO_DATA_KEY_VALUE], &status, &status_len) != CC_SUCCESS)
 		return CC_FAIL;
 
-	if (cc_coder_decode_string_from_map(value, "value", &status, &status_len) != CC_SUCCESS)
+	if (data_values[PROTO_DATA_KEY_SEQUENCENBR] == NULL || cc_coder_decode_uint(data_values[PROTO_DATA_KEY_SEQUENCENBR], &sequencenbr) != CC_SUCCESS)
 		return CC_FAIL;
 
-	if (cc_coder_decode_uint_from_map(value, "sequencenbr", &sequencenbr) != CC_SUCCESS)
-		return CC_FAIL;
+	// batched replies covers sequencenbr to sequencenbr_end
+	sequencenbr_end = sequencenbr;
+	if (data_values[PROTO_DATA_KEY_SEQUENCENBR_END] != NULL) {
+		if (cc_coder_decode_uint(data_values[PROTO_DATA_KEY_SEQUENCENBR_END], &sequencenbr_end) != CC_SUCCESS)
+			return CC_FAIL;
+		if (sequencenbr_end < sequencenbr) {
+			cc_log_error("Invalid sequence range");
+			return CC_FAIL;
+		}
+	}
 
-	if (strncmp(status, "ACK", status_len) == 0) {
-		cc_node_handle_token_reply(node, port_id, port_id_len, CC_PORT_REPLY_TYPE_ACK, sequencenbr);
-		return CC_SUCCESS;
-	} else if (strncmp(status, "NACK", status_len) == 0) {
-		cc_node_handle_token_reply(node, port_id, port_id_len, CC_PORT_REPLY_TYPE_NACK, sequencenbr);
-		return CC_SUCCESS;
-	} else if (strncmp(status, "ABORT", status_len) == 0) {
-		cc_node_handle_token_reply(node, port_id, port_id_len, CC_PORT_REPLY_TYPE_ABORT, sequencenbr);
-		return CC_SUCCESS;
+	if (strncmp(status, "ACK", status_len) == 0)
+		reply_type = CC_PORT_REPLY_TYPE_ACK;
+	else if (strncmp(status, "NACK", status_len) == 0)
+		reply_type = CC_PORT_REPLY_TYPE_NACK;
+	else if (strncmp(status, "ABORT", status_len) == 0)
+		reply_type = CC_PORT_REPLY_TYPE_ABORT;
+	else {
+		cc_log_error("Unknown status '%.*s'", (int)status_len, status);
+		return CC_FAIL;
 	}
-	cc_log_error("Unknown status '%s'", status);
 
-	return CC_FAIL;
+	cc_node_handle_token_reply(node, port_id, port_id_len, reply_type, sequencenbr, sequencenbr_end);
+
+	return CC_SUCCESS;
 }
 
-static cc_result_t proto_parse_destroy(cc_node_t *node, char *root)
+static cc_result_t proto_parse_destroy(cc_node_t *node, char **values, char **data_values)
 {
-	char *r = root, respbuffer[400], *w = NULL;
-	char *from_rt_uuid = NULL, *tunnel_id = NULL, *obj_value = NULL, *method = NULL;
+	char respbuffer[400], *w = NULL;
+	char *from_rt_uuid = NULL, *tunnel_id = NULL, *method = NULL;
 	uint32_t method_len = 0, from_rt_uuid_len = 0, tunnel_id_len = 0;
 
-	if (cc_coder_decode_string_from_map(r, "from_rt_uuid", &from_rt_uuid, &from_rt_uuid_len) != CC_SUCCESS) {
+	if (values[PROTO_KEY_FROM_RT_UUID] == NULL || cc_coder_decode_str(values[PROTO_KEY_FROM_RT_UUID], &from_rt_uuid, &from_rt_uuid_len) != CC_SUCCESS) {
 		cc_log_error("Failed to decode 'from_rt_uuid'");
 		return CC_FAIL;
 	}
 
-	if (cc_coder_decode_string_from_map(r, "tunnel_id", &tunnel_id, &tunnel_id_len) != CC_SUCCESS) {
+	if (values[PROTO_KEY_TUNNEL_ID] == NULL || cc_coder_decode_str(values[PROTO_KEY_TUNNEL_ID], &tunnel_id, &tunnel_id_len) != CC_SUCCESS) {
 		cc_log_error("Failed to decode 'tunnel_id'");
 		return CC_FAIL;
 	}
 
-	if (cc_coder_get_value_from_map(r, "value", &obj_value) != CC_SUCCESS) {
-		cc_log_error("Failed to decode 'value'");
-		return CC_FAIL;
-	}
-
-	if (cc_coder_decode_string_from_map(obj_value, "method", &method, &method_len) != CC_SUCCESS) {
+	if (data_values[PROTO_DATA_KEY_METHOD] == NULL || cc_coder_decode_str(data_values[PROTO_DATA_KEY_METHOD], &method, &method_len) != CC_SUCCESS) {
 		cc_log_error("Failed to decode 'method'");
 		return CC_FAIL;
 	}
@@ -1177,20 +1551,20 @@ static cc_result_t proto_parse_destroy(cc_node_t *node, char *root)
 	return cc_transport_send(node->transport_client, respbuffer, w - respbuffer);
 }
 
-static cc_result_t cc_proto_parse_tunnel_data(cc_node_t *node, char *root, size_t len)
+static cc_result_t cc_proto_parse_tunnel_data(cc_node_t *node, char *root, size_t len, char **values)
 {
-	char msg_uuid[CC_UUID_BUFFER_SIZE], *tmp = NULL, *value = NULL, *cmd = NULL, *r = root;
-	cc_pending_msg_t *pending_msg = NULL;
+	char msg_uuid[CC_UUID_BUFFER_SIZE], *tmp = NULL, *cmd = NULL;
+	char *data_values[PROTO_NBR_OF_DATA_KEYS];
+	cc_pending_msg_t *pending_msg = NULL, msg;
 	uint32_t msg_uuid_len = 0, cmd_len = 0;
-	cc_result_t result = CC_FAIL;
 
-	if (cc_coder_get_value_from_map(r, "value", &value) != CC_SUCCESS) {
+	if (values[PROTO_KEY_VALUE] == NULL || cc_coder_decode_map_keys(values[PROTO_KEY_VALUE], proto_data_keys, PROTO_NBR_OF_DATA_KEYS, data_values) != CC_SUCCESS) {
 		cc_log_error("Failed to get 'value'");
 		return CC_FAIL;
 	}
 
-	if (cc_coder_has_key(value, "msg_uuid")) {
-		if (cc_coder_decode_string_from_map(value, "msg_uuid", &tmp, &msg_uuid_len) != CC_SUCCESS) {
+	if (data_values[PROTO_DATA_KEY_MSG_UUID] != NULL) {
+		if (cc_coder_decode_str(data_values[PROTO_DATA_KEY_MSG_UUID], &tmp, &msg_uuid_len) != CC_SUCCESS || msg_uuid_len >= CC_UUID_BUFFER_SIZE) {
 			cc_log_error("Failed to get 'msg_uuid'");
 			return CC_FAIL;
 		}
@@ -1204,21 +1578,27 @@ static cc_result_t cc_proto_parse_tunnel_data(cc_node_t *node, char *root, size_
 			return CC_FAIL;
 		}
 
-		result = pending_msg->handler(node, root, len, pending_msg->msg_data);
+		msg = *pending_msg;
 		cc_node_remove_pending_msg(node, msg_uuid);
-		return result;
+		return msg.handler(node, root, len, msg.msg_data);
 	}
 
-	if (cc_coder_has_key(value, "cmd")) {
-		if (cc_coder_decode_string_from_map(value, "cmd", &cmd, &cmd_len) != CC_SUCCESS)
+	if (data_values[PROTO_DATA_KEY_CMD] != NULL) {
+		if (cc_coder_decode_str(data_values[PROTO_DATA_KEY_CMD], &cmd, &cmd_len) != CC_SUCCESS)
 			return CC_FAIL;
 
-		if (strncmp(cmd, "TOKEN_REPLY", 11) == 0)
-			return proto_parse_token_reply(node, root);
-		else if (strncmp(cmd, "TOKEN", 5) == 0)
-			return proto_parse_token(node, root);
-		else if (strncmp(cmd, "DESTROY", 7) == 0)
-			return proto_parse_destroy(node, root);
+		if (cmd_len == 11 && strncmp(cmd, "TOKEN_REPLY", 11) == 0)
+			return proto_parse_token_reply(node, data_values);
+		else if (cmd_len == 11 && strncmp(cmd, "TOKEN_BATCH", 11) == 0)
+			return proto_parse_token_batch(node, values, data_values);
+		else if (cmd_len == 11 && strncmp(cmd, "TOKEN_CHUNK", 11) == 0)
+			return proto_parse_token_chunk(node, values, data_values);
+		else if (cmd_len == 17 && strncmp(cmd, "TOKEN_CHUNK_REPLY", 17) == 0)
+			return proto_parse_token_chunk_reply(node, data_values);
+		else if (cmd_len == 5 && strncmp(cmd, "TOKEN", 5) == 0)
+			return proto_parse_token(node, values, data_values);
+		else if (cmd_len == 7 && strncmp(cmd, "DESTROY", 7) == 0)
+			return proto_parse_destroy(node, values, data_values);
 		cc_log_error("Unhandled tunnel cmd");
 		return CC_FAIL;
 	}
@@ -1227,7 +1607,7 @@ static cc_result_t cc_proto_parse_tunnel_data(cc_node_t *node, char *root, size_
 	return CC_FAIL;
 }
 
-static cc_result_t cc_proto_parse_actor_new(cc_node_t *node, char *root, size_t len)
+static cc_result_t cc_proto_parse_actor_new(cc_node_t *node, char *root, size_t len, char **values)
 {
 	cc_result_t result = CC_SUCCESS;
 	cc_actor_t *actor = NULL;
@@ -1300,7 +1680,7 @@ static cc_result_t cc_proto_send_req_match_with_actor_reqs(cc_node_t *node, cc_a
 	return cc_proto_send_req_match(node, actor, buffer, w - buffer, cc_actor_req_match_reply_handler);
 }
 
-static cc_result_t cc_proto_parse_actor_migrate(cc_node_t *node, char *root, size_t len)
+static cc_result_t cc_proto_parse_actor_migrate(cc_node_t *node, char *root, size_t len, char **values)
 {
 	cc_result_t result = CC_FAIL;
 	char *r = root, *from_rt_uuid = NULL, *actor_id = NULL, msg_uuid[CC_UUID_BUFFER_SIZE], *tmp = NULL;
@@ -1381,7 +1761,7 @@ static cc_result_t cc_proto_parse_actor_migrate(cc_node_t *node, char *root, siz
 	return result;
 }
 
-static cc_result_t cc_proto_parse_app_destroy(cc_node_t *node, char *root, size_t len)
+static cc_result_t cc_proto_parse_app_destroy(cc_node_t *node, char *root, size_t len, char **values)
 {
 	cc_result_t result = CC_SUCCESS;
 	char *r = root, *from_rt_uuid = NULL, msg_uuid[CC_UUID_BUFFER_SIZE], *tmp = NULL;
@@ -1423,7 +1803,7 @@ static cc_result_t cc_proto_parse_app_destroy(cc_node_t *node, char *root, size_
 	return result;
 }
 
-static cc_result_t cc_proto_parse_port_disconnect(cc_node_t *node, char *root, size_t len)
+static cc_result_t cc_proto_parse_port_disconnect(cc_node_t *node, char *root, size_t len, char **values)
 {
 	cc_result_t result = CC_SUCCESS;
 	char *r = root, *from_rt_uuid = NULL, *msg_uuid = NULL, *peer_port_id = NULL;
@@ -1450,7 +1830,7 @@ static cc_result_t cc_proto_parse_port_disconnect(cc_node_t *node, char *root, s
 	return result;
 }
 
-static cc_result_t cc_proto_parse_port_connect(cc_node_t *node, char *root, size_t len)
+static cc_result_t cc_proto_parse_port_connect(cc_node_t *node, char *root, size_t len, char **values)
 {
 	cc_result_t result = CC_SUCCESS;
 	char *r = root, *from_rt_uuid = NULL, *msg_uuid = NULL;
@@ -1481,7 +1861,7 @@ static cc_result_t cc_proto_parse_port_connect(cc_node_t *node, char *root, size
 	return result;
 }
 
-static cc_result_t cc_proto_parse_tunnel_new(cc_node_t *node, char *root, size_t len)
+static cc_result_t cc_proto_parse_tunnel_new(cc_node_t *node, char *root, size_t len, char **values)
 {
 	cc_result_t result = CC_SUCCESS;
 	char *r = root, *from_rt_uuid = NULL, *msg_uuid = NULL;
@@ -1535,8 +1915,8 @@ static cc_result_t proto_handle_join_reply(cc_node_t *node, char *buffer, uint32
 {
 	char *serializer = NULL;
 	jsmn_parser parser;
-	jsmntok_t tokens[10], *token = NULL;
-	int res = 0;
+	jsmntok_t tokens[16], *token = NULL;
+	int res = 0, token_batch = 1, token_chunk = 0;
 
 	jsmn_init(&parser);
 	res = jsmn_parse(&parser, buffer, buffer_len, tokens, sizeof(tokens) / sizeof(tokens[0]));
@@ -1575,6 +1955,31 @@ static cc_result_t proto_handle_join_reply(cc_node_t *node, char *buffer, uint32
 
 	memset(node->transport_client->peer_id, 0, CC_UUID_BUFFER_SIZE);
 	strncpy(node->transport_client->peer_id, buffer + token->start, token->end - token->start);
+
+	// token batching is used if supported by the peer
+	token = cc_json_get_dict_value(buffer, &tokens[0], parser.toknext, "token_batch", 11);
+	if (token != NULL && token->type == JSMN_PRIMITIVE) {
+		token_batch = atoi(buffer + token->start);
+		if (token_batch > CC_TOKEN_BATCH_SIZE)
+			token_batch = CC_TOKEN_BATCH_SIZE;
+		if (token_batch < 1)
+			token_batch = 1;
+	}
+	node->transport_client->token_batch = token_batch;
+	cc_log_debug("Proto: Token batch size '%d'", token_batch);
+
+	// large tokens are sent in chunks of the smallest of the supported sizes
+	token = cc_json_get_dict_value(buffer, &tokens[0], parser.toknext, "token_chunk", 11);
+	if (token != NULL && token->type == JSMN_PRIMITIVE) {
+		token_chunk = atoi(buffer + token->start);
+		if (token_chunk > CC_TOKEN_CHUNK_SIZE)
+			token_chunk = CC_TOKEN_CHUNK_SIZE;
+		if (token_chunk < 0)
+			token_chunk = 0;
+	}
+	node->transport_client->token_chunk = token_chunk;
+	cc_log_debug("Proto: Token chunk size '%d'", token_chunk);
+
 	node->transport_client->state = CC_TRANSPORT_ENABLED;
 
 	return CC_SUCCESS;
@@ -1582,30 +1987,34 @@ static cc_result_t proto_handle_join_reply(cc_node_t *node, char *buffer, uint32
 
 cc_result_t cc_proto_parse_message(cc_node_t *node, char *data, size_t data_len)
 {
-	char *cmd = NULL, *r = data, msg_uuid[CC_UUID_BUFFER_SIZE], *tmp = NULL, *from_rt_uuid = NULL;
+	char *cmd = NULL, msg_uuid[CC_UUID_BUFFER_SIZE], *tmp = NULL, *from_rt_uuid = NULL;
+	char *values[PROTO_NBR_OF_KEYS];
 	int i = 0;
 	uint32_t cmd_len = 0, msg_uuid_len = 0, from_rt_uuid_len = 0;
 
 	if (node->transport_client->state != CC_TRANSPORT_ENABLED)
 		return proto_handle_join_reply(node, data, data_len);
 
-	if (cc_coder_decode_string_from_map(r, "cmd", &cmd, &cmd_len) != CC_SUCCESS)
+	if (cc_coder_decode_map_keys(data, proto_keys, PROTO_NBR_OF_KEYS, values) != CC_SUCCESS)
+		return CC_FAIL;
+
+	if (values[PROTO_KEY_CMD] == NULL || cc_coder_decode_str(values[PROTO_KEY_CMD], &cmd, &cmd_len) != CC_SUCCESS)
 		return CC_FAIL;
 
 	for (i = 0; i < NBR_OF_COMMANDS; i++) {
-		if (strncmp(cmd, command_handlers[i].command, cmd_len) == 0)
-			return command_handlers[i].handler(node, data, data_len);
+		if (strlen(command_handlers[i].command) == cmd_len && strncmp(cmd, command_handlers[i].command, cmd_len) == 0)
+			return command_handlers[i].handler(node, data, data_len, values);
 	}
 
 	cc_log_error("Unhandled command");
 
-	if (cc_coder_decode_string_from_map(r, "msg_uuid", &tmp, &msg_uuid_len) != CC_SUCCESS)
+	if (values[PROTO_KEY_MSG_UUID] == NULL || cc_coder_decode_str(values[PROTO_KEY_MSG_UUID], &tmp, &msg_uuid_len) != CC_SUCCESS || msg_uuid_len >= CC_UUID_BUFFER_SIZE)
 		return CC_FAIL;
 
 	strncpy(msg_uuid, tmp, msg_uuid_len);
 	msg_uuid[msg_uuid_len] = '\0';
 
-	if (cc_coder_decode_string_from_map(r, "from_rt_uuid", &from_rt_uuid, &from_rt_uuid_len) != CC_SUCCESS)
+	if (values[PROTO_KEY_FROM_RT_UUID] == NULL || cc_coder_decode_str(values[PROTO_KEY_FROM_RT_UUID], &from_rt_uuid, &from_rt_uuid_len) != CC_SUCCESS)
 		return CC_FAIL;
 
 	return proto_send_reply(node, msg_uuid, from_rt_uuid, from_rt_uuid_len, 500);
@@ -36,6 +36,8 @@ cc_result_t cc_proto_send_tunnel_destroy(cc_node_t *node, cc_tunnel_t *tunnel, c
 cc_result_t cc_proto_send_port_connect(cc_node_t *node, cc_port_t *port, cc_msg_handler_t handler);
 cc_result_t cc_proto_send_port_disconnect(cc_node_t *node, cc_port_t *port, cc_msg_handler_t handler);
 cc_result_t cc_proto_send_token(const cc_node_t *node, cc_port_t *port, cc_token_t *token, uint32_t sequencenbr);
+cc_result_t cc_proto_send_token_batch(const cc_node_t *node, cc_port_t *port, cc_token_t **tokens, uint32_t nbr_of_tokens, uint32_t sequencenbr);
+cc_result_t cc_proto_send_token_chunk(const cc_node_t *node, cc_port_t *port, cc_token_t *token, uint32_t sequencenbr, uint32_t offset, uint32_t len);
 cc_result_t cc_proto_send_token_reply(const cc_node_t *node, cc_port_t *port, uint32_t sequencenbr, bool ack);
 cc_result_t cc_proto_send_set_actor(cc_node_t *node, const cc_actor_t*actor, cc_msg_handler_t handler);
 cc_result_t cc_proto_send_set_port(cc_node_t *node, cc_port_t *port, cc_msg_handler_t handler);
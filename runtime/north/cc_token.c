@@ -16,19 +16,59 @@
 #include <stdlib.h>
 #include "cc_token.h"
 #include "cc_common.h"
+#include "cc_transport.h"
 #include "runtime/south/platform/cc_platform.h"
 #include "coder/cc_coder.h"
 
 void cc_token_set_data(cc_token_t *token, char *data, const size_t size)
+{
+	cc_token_set_ref(token, data, size, NULL);
+}
+
+void cc_token_set_ref(cc_token_t *token, char *data, const size_t size, struct cc_transport_rx_buffer_t *rx_buffer)
 {
 	if (token->value != NULL) {
 		cc_log_debug("Token not freed");
-		cc_platform_mem_free(token->value);
-		token->value = NULL;
+		cc_token_free(token);
 	}
 
 	token->value = data;
 	token->size = size;
+	token->rx_buffer = rx_buffer;
+	if (rx_buffer != NULL)
+		cc_transport_rx_buffer_ref(rx_buffer);
+}
+
+void cc_token_move(cc_token_t *to, cc_token_t *from)
+{
+	if (to->value != NULL) {
+		cc_log_debug("Token not freed");
+		cc_token_free(to);
+	}
+
+	to->value = from->value;
+	to->size = from->size;
+	to->rx_buffer = from->rx_buffer;
+	from->value = NULL;
+	from->size = 0;
+	from->rx_buffer = NULL;
+}
+
+size_t cc_token_get_encoded_size(const cc_token_t *token, bool with_key)
+{
+	size_t size = cc_coder_sizeof_map(2);
+
+	if (with_key)
+		size += cc_coder_sizeof_key("token");
+
+	size += cc_coder_sizeof_key("type") + cc_coder_sizeof_str(5);
+	size += cc_coder_sizeof_key("data");
+	if (token->size != 0)
+		size += token->size;
+	else
+		size += cc_coder_sizeof_nil();
+
+	return size;
 }
 
 char *cc_token_encode(char *buffer, cc_token_t *token, bool with_key)
@@ -50,8 +90,12 @@ char *cc_token_encode(char *buffer, cc_token_t *token, bool with_key)
 void cc_token_free(cc_token_t *token)
 {
 	if (token->value != NULL) {
-		cc_platform_mem_free(token->value);
+		if (token->rx_buffer != NULL)
+			cc_transport_rx_buffer_unref(token->rx_buffer);
+		else
+			cc_platform_mem_free(token->value);
 		token->value = NULL;
 		token->size = 0;
+		token->rx_buffer = NULL;
 	}
 }
@@ -21,12 +21,18 @@
 #include <stddef.h>
 #include "cc_common.h"
 
+struct cc_transport_rx_buffer_t;
+
 typedef struct cc_token_t {
 	char *value;
 	size_t size;
+	struct cc_transport_rx_buffer_t *rx_buffer; // set if value points into a received frame
 } cc_token_t;
 
 void cc_token_set_data(cc_token_t *token, char *data, const size_t size);
+void cc_token_set_ref(cc_token_t *token, char *data, const size_t size, struct cc_transport_rx_buffer_t *rx_buffer);
+void cc_token_move(cc_token_t *to, cc_token_t *from);
+size_t cc_token_get_encoded_size(const cc_token_t *token, bool with_key);
 char *cc_token_encode(char *buffer, cc_token_t *token, bool with_key);
 void cc_token_free(cc_token_t *token);
 
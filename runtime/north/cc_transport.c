@@ -22,6 +22,9 @@
 #include "cc_proto.h"
 #include "runtime/south/platform/cc_platform.h"
 
+// messages sent with cc_transport_sendv up to this size are gathered on the stack
+#define CC_TRANSPORT_GATHER_BUFFER_SIZE	1000
+
 unsigned int cc_transport_get_message_len(const char *buffer)
 {
 	unsigned int value =
@@ -40,53 +43,113 @@ static int cc_transport_recv(cc_transport_client_t *transport_client, char *buff
 	return transport_client->recv(transport_client, buffer, size);
 }
 
-cc_result_t cc_transport_handle_data(cc_node_t *node, cc_transport_client_t *transport_client, cc_result_t (*handler)(cc_node_t *node, char *data, size_t size))
+void cc_transport_rx_buffer_ref(cc_transport_rx_buffer_t *rx_buffer)
 {
-	char prefix_buffer[4];
-	int read = 0, msg_size = 0, to_read = 0;
-
-	memset(prefix_buffer, 0, 4);
-
-	while (true) {
-		if (transport_client->rx_buffer.buffer != NULL)
-			to_read = transport_client->rx_buffer.size - transport_client->rx_buffer.pos;
-		else {
-			read = cc_transport_recv(transport_client, prefix_buffer, 4);
-			if (read < 4) {
-				cc_log_error("Failed to read packet header, status '%d'", read);
-				return CC_FAIL;
-			}
-			msg_size = cc_transport_get_message_len(prefix_buffer);
-
-			if (cc_platform_mem_alloc((void **)&transport_client->rx_buffer.buffer, msg_size) != CC_SUCCESS) {
-				cc_log_error("Failed to allocate memory");
-				return CC_FAIL;
-			}
-
-			transport_client->rx_buffer.pos = 0;
-			transport_client->rx_buffer.size = msg_size;
-			to_read = msg_size;
-		}
+	rx_buffer->refcount++;
+}
 
-		read = cc_transport_recv(transport_client, transport_client->rx_buffer.buffer + transport_client->rx_buffer.pos, to_read);
-		if (read <= 0){
-			cc_log_error("Failed to read payload, status '%d'", read);
-			return CC_FAIL;
-		}
+void cc_transport_rx_buffer_unref(cc_transport_rx_buffer_t *rx_buffer)
+{
+	if (rx_buffer->refcount > 0)
+		rx_buffer->refcount--;
+
+	if (rx_buffer->refcount == 0)
+		cc_platform_mem_free((void *)rx_buffer);
+}
+
+cc_transport_rx_buffer_t *cc_transport_rx_buffer_get(cc_transport_client_t *transport_client, const char *data, size_t size)
+{
+	cc_transport_rx_buffer_t *rx_buffer = transport_client->rx_buffer.buffer;
+
+	if (rx_buffer != NULL && data >= rx_buffer->data && data + size <= rx_buffer->data + transport_client->rx_buffer.size)
+		return rx_buffer;
 
-		transport_client->rx_buffer.pos = transport_client->rx_buffer.pos + read;
+	return NULL;
+}
+
+// Make room for at least 'size' bytes after the buffered data
+static cc_result_t cc_transport_reserve(cc_transport_client_t *transport_client, unsigned int size)
+{
+	cc_transport_buffer_t *rx_buffer = &transport_client->rx_buffer;
+	cc_transport_rx_buffer_t *buffer = NULL;
+	unsigned int capacity = 0, pending = rx_buffer->size - rx_buffer->pos;
 
-		if (transport_client->rx_buffer.pos == transport_client->rx_buffer.size) {
-			cc_log_debug("Transport: Packet received '%d' bytes", transport_client->rx_buffer.size);
-			handler(node, transport_client->rx_buffer.buffer, transport_client->rx_buffer.size);
-			cc_platform_mem_free(transport_client->rx_buffer.buffer);
-			transport_client->rx_buffer.pos = 0;
-			transport_client->rx_buffer.size = 0;
-			transport_client->rx_buffer.buffer = NULL;
+	if (rx_buffer->buffer != NULL && rx_buffer->buffer->refcount == 1) {
+		if (rx_buffer->pos > 0) {
+			// move the partial frame to the start of the buffer
+			memmove(rx_buffer->buffer->data, rx_buffer->buffer->data + rx_buffer->pos, pending);
+			rx_buffer->size = pending;
+			rx_buffer->pos = 0;
+		}
+
+		if (rx_buffer->buffer->capacity - rx_buffer->size >= size)
 			return CC_SUCCESS;
-		} else
+	}
+
+	// grow, or leave the buffer to the tokens referencing it
+	capacity = pending + size;
+	if (cc_platform_mem_alloc((void **)&buffer, sizeof(cc_transport_rx_buffer_t) + capacity) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return CC_FAIL;
+	}
+	buffer->refcount = 1;
+	buffer->capacity = capacity;
+
+	if (rx_buffer->buffer != NULL) {
+		memcpy(buffer->data, rx_buffer->buffer->data + rx_buffer->pos, pending);
+		cc_transport_rx_buffer_unref(rx_buffer->buffer);
+	}
+	rx_buffer->buffer = buffer;
+	rx_buffer->pos = 0;
+	rx_buffer->size = pending;
+
+	return CC_SUCCESS;
+}
+
+cc_result_t cc_transport_handle_data(cc_node_t *node, cc_transport_client_t *transport_client, cc_result_t (*handler)(cc_node_t *node, char *data, size_t size))
+{
+	cc_transport_buffer_t *rx_buffer = &transport_client->rx_buffer;
+	int read = 0;
+	unsigned int msg_size = 0, to_read = CC_TRANSPORT_RX_BUFFER_SIZE;
+
+	// a partial frame larger than the chunk size needs room for the remainder
+	if (rx_buffer->size - rx_buffer->pos >= CC_TRANSPORT_LEN_PREFIX_SIZE) {
+		msg_size = cc_transport_get_message_len(rx_buffer->buffer->data + rx_buffer->pos);
+		if (msg_size + CC_TRANSPORT_LEN_PREFIX_SIZE - (rx_buffer->size - rx_buffer->pos) > to_read)
+			to_read = msg_size + CC_TRANSPORT_LEN_PREFIX_SIZE - (rx_buffer->size - rx_buffer->pos);
+	}
+
+	if (cc_transport_reserve(transport_client, to_read) != CC_SUCCESS)
+		return CC_FAIL;
+
+	read = cc_transport_recv(transport_client, rx_buffer->buffer->data + rx_buffer->size, rx_buffer->buffer->capacity - rx_buffer->size);
+	if (read <= 0) {
+		cc_log_error("Failed to read data, status '%d'", read);
+		return CC_FAIL;
+	}
+	rx_buffer->size += read;
+
+	// dispatch all complete frames, a partial frame is kept until the next call
+	while (rx_buffer->size - rx_buffer->pos >= CC_TRANSPORT_LEN_PREFIX_SIZE) {
+		msg_size = cc_transport_get_message_len(rx_buffer->buffer->data + rx_buffer->pos);
+		if (rx_buffer->size - rx_buffer->pos - CC_TRANSPORT_LEN_PREFIX_SIZE < msg_size) {
 			cc_log_debug("Transport: Fragment received");
+			break;
+		}
+
+		cc_log_debug("Transport: Packet received '%d' bytes", msg_size);
+		rx_buffer->pos += CC_TRANSPORT_LEN_PREFIX_SIZE + msg_size;
+		handler(node, rx_buffer->buffer->data + rx_buffer->pos - msg_size, msg_size);
+		if (rx_buffer->buffer == NULL)
+			return CC_SUCCESS; // disconnected by handler
 	}
+
+	if (rx_buffer->pos == rx_buffer->size && rx_buffer->buffer->refcount == 1) {
+		rx_buffer->pos = 0;
+		rx_buffer->size = 0;
+	}
+
+	return CC_SUCCESS;
 }
 
 void cc_transport_set_length_prefix(char *buffer, size_t size)
@@ -97,15 +160,17 @@ void cc_transport_set_length_prefix(char *buffer, size_t size)
 	buffer[3] = size & 0xFF;
 }
 
-cc_result_t cc_transport_send(cc_transport_client_t *transport_client, char *buffer, int size)
+// Sending is only possible on an established connection, local actors keep
+// running and trying to send while the node reconnects
+static bool cc_transport_is_connected(const cc_transport_client_t *transport_client)
 {
-	if (transport_client == NULL) {
-		cc_log_error("Transport client is NULL");
-		return CC_FAIL;
-	}
-
-	cc_transport_set_length_prefix(buffer, size - CC_TRANSPORT_LEN_PREFIX_SIZE);
+	return transport_client->state == CC_TRANSPORT_CONNECTED ||
+		transport_client->state == CC_TRANSPORT_PENDING ||
+		transport_client->state == CC_TRANSPORT_ENABLED;
+}
 
+static cc_result_t cc_transport_send_buffer(cc_transport_client_t *transport_client, char *buffer, int size)
+{
 #ifdef CC_TLS_ENABLED
 	if (crypto_tls_send(transport_client, buffer, size) == size)
 		return CC_SUCCESS;
@@ -119,6 +184,80 @@ cc_result_t cc_transport_send(cc_transport_client_t *transport_client, char *buf
 	return CC_FAIL;
 }
 
+cc_result_t cc_transport_send(cc_transport_client_t *transport_client, char *buffer, int size)
+{
+	if (transport_client == NULL) {
+		cc_log_error("Transport client is NULL");
+		return CC_FAIL;
+	}
+
+	if (!cc_transport_is_connected(transport_client)) {
+		cc_log_debug("Transport: Not connected");
+		return CC_FAIL;
+	}
+
+	cc_transport_set_length_prefix(buffer, size - CC_TRANSPORT_LEN_PREFIX_SIZE);
+
+	return cc_transport_send_buffer(transport_client, buffer, size);
+}
+
+cc_result_t cc_transport_sendv(cc_transport_client_t *transport_client, const cc_transport_iovec_t *iov, int iovcnt)
+{
+	char stack_buffer[CC_TRANSPORT_GATHER_BUFFER_SIZE], *buffer = stack_buffer;
+	cc_result_t result = CC_FAIL;
+	size_t size = 0, pos = 0;
+	int i = 0;
+
+	if (transport_client == NULL) {
+		cc_log_error("Transport client is NULL");
+		return CC_FAIL;
+	}
+
+	if (!cc_transport_is_connected(transport_client)) {
+		cc_log_debug("Transport: Not connected");
+		return CC_FAIL;
+	}
+
+	if (iovcnt < 1 || iovcnt > CC_TRANSPORT_MAX_IOVEC || iov[0].len < CC_TRANSPORT_LEN_PREFIX_SIZE) {
+		cc_log_error("Invalid segments");
+		return CC_FAIL;
+	}
+
+	for (i = 0; i < iovcnt; i++)
+		size += iov[i].len;
+
+	cc_transport_set_length_prefix(iov[0].base, size - CC_TRANSPORT_LEN_PREFIX_SIZE);
+
+#ifndef CC_TLS_ENABLED
+	if (transport_client->sendv != NULL) {
+		if (transport_client->sendv(transport_client, iov, iovcnt) == (int)size)
+			return CC_SUCCESS;
+		cc_log_error("Failed to send data");
+		return CC_FAIL;
+	}
+#endif
+
+	// gather the segments, on the stack if they fit
+	if (size > CC_TRANSPORT_GATHER_BUFFER_SIZE) {
+		if (cc_platform_mem_alloc((void **)&buffer, size) != CC_SUCCESS) {
+			cc_log_error("Failed to allocate memory");
+			return CC_FAIL;
+		}
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		memcpy(buffer + pos, iov[i].base, iov[i].len);
+		pos += iov[i].len;
+	}
+
+	result = cc_transport_send_buffer(transport_client, buffer, size);
+
+	if (buffer != stack_buffer)
+		cc_platform_mem_free((void *)buffer);
+
+	return result;
+}
+
 cc_result_t cc_transport_join(cc_node_t *node, cc_transport_client_t *transport_client)
 {
 	char *serializer = NULL;
@@ -137,6 +276,8 @@ cc_result_t cc_transport_join(cc_node_t *node, cc_transport_client_t *transport_
 		return CC_FAIL;
 	}
 
+	transport_client->token_batch = 1;
+	transport_client->token_chunk = 0;
 	if (cc_proto_send_join_request(node, transport_client, serializer) != CC_SUCCESS) {
 		cc_log_error("Failed to send join request");
 		cc_platform_mem_free((void *)serializer);
@@ -180,7 +321,7 @@ void cc_transport_disconnect(struct cc_node_t *node, cc_transport_client_t *tran
 	transport_client->rx_buffer.pos = 0;
 	transport_client->rx_buffer.size = 0;
 	if (transport_client->rx_buffer.buffer != NULL) {
-		cc_platform_mem_free(transport_client->rx_buffer.buffer);
+		cc_transport_rx_buffer_unref(transport_client->rx_buffer.buffer);
 		transport_client->rx_buffer.buffer = NULL;
 	}
 }
@@ -26,12 +26,14 @@
 
 #define CC_TRANSPORT_LEN_PREFIX_SIZE	4
 #define CC_TRANSPORT_RX_BUFFER_SIZE		512
+#define CC_TRANSPORT_MAX_IOVEC				8
 
 struct cc_node_t;
 
 typedef enum {
 	CC_TRANSPORT_INTERFACE_DOWN,
 	CC_TRANSPORT_INTERFACE_UP,
+	CC_TRANSPORT_CONNECTING,
 	CC_TRANSPORT_CONNECTED,
 	CC_TRANSPORT_DISCONNECTED,
 	CC_TRANSPORT_PENDING,
@@ -45,10 +47,32 @@ typedef enum {
 	CC_TRANSPORT_SPRITZER_TYPE
 } cc_transport_type_t;
 
+/**
+ * struct cc_transport_rx_buffer_t - Reference counted receive buffer
+ * @refcount: references held by the transport client and tokens pointing into data
+ * @capacity: size of data
+ * @data: received frames
+ */
+typedef struct cc_transport_rx_buffer_t {
+	uint32_t refcount;
+	unsigned int capacity;
+	char data[];
+} cc_transport_rx_buffer_t;
+
+/**
+ * struct cc_transport_iovec_t - A segment of a message
+ * @base: start of the segment
+ * @len: length of the segment
+ */
+typedef struct cc_transport_iovec_t {
+	char *base;
+	size_t len;
+} cc_transport_iovec_t;
+
 typedef struct cc_transport_buffer_t {
-	char *buffer;
-	unsigned int pos;		// read/write pos
-	unsigned int size;	// message size
+	cc_transport_rx_buffer_t *buffer;
+	unsigned int pos;		// start of the first unhandled frame
+	unsigned int size;	// number of bytes received
 } cc_transport_buffer_t;
 
 /**
@@ -57,12 +81,15 @@ typedef struct cc_transport_buffer_t {
  * @uri: URI to connect to
  * @peer_id: ID of peer runtime
  * @state: current state
- * @rx_buffer: receive buffer
+ * @rx_buffer: receive buffer, may hold several frames and a trailing partial frame
  * @client_state: implementation specific state
  * @prefix_len: the length of the prefix header
+ * @token_batch: max number of tokens in a TOKEN_BATCH message, negotiated when joining
+ * @token_chunk: max size of a TOKEN_CHUNK, 0 if not supported by the peer, negotiated when joining
  * @crypto: TLS session data if enabled
  * @connect: function to connect to peer
  * @send: function to send data
+ * @sendv: function to send data from several segments, optional
  * @recv: function to receive data
  * @disconnect: function to disconnect from peer
  * @free: function to free cc_transport_client_t
@@ -72,14 +99,17 @@ typedef struct cc_transport_client_t {
 	char uri[CC_MAX_URI_LEN];
 	char peer_id[CC_UUID_BUFFER_SIZE];
 	volatile cc_transport_state_t state;
-	cc_transport_buffer_t rx_buffer; // used to assemble fragmented messages
+	cc_transport_buffer_t rx_buffer; // used to batch and assemble fragmented messages
 	void *client_state;
 	uint8_t prefix_len;
+	uint32_t token_batch;
+	uint32_t token_chunk;
 #ifdef CC_TLS_ENABLED
 	crypto_t crypto;
 #endif
 	cc_result_t (*connect)(struct cc_node_t *node, struct cc_transport_client_t *transport_client);
 	int (*send)(struct cc_transport_client_t *transport_client, char *buffer, size_t size);
+	int (*sendv)(struct cc_transport_client_t *transport_client, const cc_transport_iovec_t *iov, int iovcnt);
 	int (*recv)(struct cc_transport_client_t *transport_client, char *buffer, size_t size);
 	void (*disconnect)(struct cc_node_t *node, struct cc_transport_client_t *transport_client);
 	void (*free)(struct cc_transport_client_t *transport_client);
@@ -114,6 +144,31 @@ void cc_transport_set_length_prefix(char *buffer, size_t size);
  */
 unsigned int cc_transport_get_message_len(const char *buffer);
 
+/**
+ * cc_transport_rx_buffer_ref() - Take a reference to a receive buffer
+ * @rx_buffer the receive buffer
+ */
+void cc_transport_rx_buffer_ref(cc_transport_rx_buffer_t *rx_buffer);
+
+/**
+ * cc_transport_rx_buffer_unref() - Release a reference, the buffer is freed with the last reference
+ * @rx_buffer the receive buffer
+ */
+void cc_transport_rx_buffer_unref(cc_transport_rx_buffer_t *rx_buffer);
+
+/**
+ * cc_transport_rx_buffer_get() - Get the receive buffer holding data
+ * @transport_client the transport client
+ * @data the data
+ * @size the size of the data
+ *
+ * Used by message handlers to reference data in the frame being handled
+ * instead of copying it.
+ *
+ * Return: the receive buffer or NULL if data is not in the receive buffer
+ */
+cc_transport_rx_buffer_t *cc_transport_rx_buffer_get(cc_transport_client_t *transport_client, const char *data, size_t size);
+
 /**
  * cc_transport_send() - Send data on transport client
  * @transport_client the transport client
@@ -125,10 +180,26 @@ unsigned int cc_transport_get_message_len(const char *buffer);
 cc_result_t cc_transport_send(cc_transport_client_t *transport_client, char *buffer, int size);
 
 /**
- * cc_transport_handle_data() - Reads data and calls handler when a compelete message has been received
+ * cc_transport_sendv() - Send a message made of several segments on transport client
+ * @transport_client the transport client
+ * @iov the segments, the first starts with prefix_len bytes reserved for the prefix
+ * @iovcnt the number of segments, at most CC_TRANSPORT_MAX_IOVEC
+ *
+ * Transports without sendv, and TLS, get the segments copied into one buffer.
+ *
+ * @Return: SUCCESS/FAIL
+ */
+cc_result_t cc_transport_sendv(cc_transport_client_t *transport_client, const cc_transport_iovec_t *iov, int iovcnt);
+
+/**
+ * cc_transport_handle_data() - Reads available data and calls handler for each complete message
  * @transport_client the transport client
  * @handler the handler to be called when a message has been received
  *
+ * Data is read in chunks of at least CC_TRANSPORT_RX_BUFFER_SIZE bytes, all
+ * complete messages are handled and a partial message is kept until the
+ * next call.
+ *
  * @Return: SUCCESS/FAIL
  */
 cc_result_t cc_transport_handle_data(struct cc_node_t *node, cc_transport_client_t *transport_client, cc_result_t (*handler)(struct cc_node_t *node, char *data, size_t size));
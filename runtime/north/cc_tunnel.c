@@ -19,18 +19,13 @@
 #include "cc_proto.h"
 #include "cc_node.h"
 #include "cc_link.h"
+#include "scheduler/cc_scheduler.h"
 #include "coder/cc_coder.h"
 #include "runtime/south/platform/cc_platform.h"
 
 cc_tunnel_t *cc_tunnel_get_from_id(cc_node_t *node, const char *tunnel_id, uint32_t tunnel_id_len)
 {
-	cc_list_t *item = NULL;
-
-	item = cc_list_get_n(node->tunnels, tunnel_id, tunnel_id_len);
-	if (item != NULL)
-		return (cc_tunnel_t *)item->data;
-
-	return NULL;
+	return (cc_tunnel_t *)cc_index_get(&node->tunnel_index, tunnel_id, tunnel_id_len);
 }
 
 cc_tunnel_t *cc_tunnel_get_from_peerid_and_type(cc_node_t *node, const char *peer_id, uint32_t peer_id_len, cc_tunnel_type_t type)
@@ -62,6 +57,17 @@ static cc_result_t tunnel_request_handler(cc_node_t *node, char *data, size_t da
 	char *value = NULL, *tunnel_id = NULL, *data_value = NULL;
 	cc_tunnel_t *tunnel = NULL;
 
+	if (data == NULL) {
+		// retry until the tunnel is removed
+		tunnel = (cc_tunnel_t *)msg_data;
+		cc_log_error("Tunnel request for '%s' timed out", tunnel->id);
+		if (cc_proto_send_tunnel_request(node, tunnel, tunnel_request_handler) != CC_SUCCESS) {
+			tunnel->state = CC_TUNNEL_DISCONNECTED;
+			cc_node_set_dirty(node);
+			cc_scheduler_all_ready(node);
+		}
+		return CC_SUCCESS;
+	}
 
 	if (cc_coder_get_value_from_map(data, "value", &value) != CC_SUCCESS) {
 		cc_log_error("Failed to get 'value'");
@@ -98,6 +104,23 @@ static cc_result_t tunnel_request_handler(cc_node_t *node, char *data, size_t da
 		cc_log_error("Failed to connect tunnel '%s'", tunnel->id);
 		tunnel->state = CC_TUNNEL_DISCONNECTED;
 	}
+	cc_node_set_dirty(node);
+
+	// ports waiting for the tunnel
+	cc_scheduler_all_ready(node);
+
+	return CC_SUCCESS;
+}
+
+cc_result_t cc_tunnel_connect(cc_node_t *node, cc_tunnel_t *tunnel)
+{
+	if (cc_proto_send_tunnel_request(node, tunnel, tunnel_request_handler) != CC_SUCCESS) {
+		cc_log_error("Failed to send tunnel request");
+		return CC_FAIL;
+	}
+
+	tunnel->state = CC_TUNNEL_PENDING;
+	cc_node_set_dirty(node);
 
 	return CC_SUCCESS;
 }
@@ -138,14 +161,9 @@ cc_tunnel_t *cc_tunnel_create(cc_node_t *node, cc_tunnel_type_t type, cc_tunnel_
 		tunnel->id[tunnel_id_len] = '\0';
 	}
 
-	if (state != CC_TUNNEL_ENABLED) {
-		if (cc_proto_send_tunnel_request(node, tunnel, tunnel_request_handler) == CC_SUCCESS)
-			tunnel->state = CC_TUNNEL_PENDING;
-		else {
-			cc_log_error("Failed to send tunnel request");
-			cc_platform_mem_free((void *)tunnel);
-			return NULL;
-		}
+	if (state != CC_TUNNEL_ENABLED && cc_tunnel_connect(node, tunnel) != CC_SUCCESS) {
+		cc_platform_mem_free((void *)tunnel);
+		return NULL;
 	}
 
 	if (cc_list_add(&node->tunnels, tunnel->id, (void *)tunnel, sizeof(cc_tunnel_t)) == NULL) {
@@ -154,7 +172,15 @@ cc_tunnel_t *cc_tunnel_create(cc_node_t *node, cc_tunnel_type_t type, cc_tunnel_
 		return NULL;
 	}
 
+	if (cc_index_add(&node->tunnel_index, tunnel->id, strnlen(tunnel->id, CC_UUID_BUFFER_SIZE), tunnel) != CC_SUCCESS) {
+		cc_log_error("Failed to index tunnel");
+		cc_list_remove(&node->tunnels, tunnel->id);
+		cc_platform_mem_free((void *)tunnel);
+		return NULL;
+	}
+
 	cc_link_add_ref(link);
+	cc_node_set_dirty(node);
 
 	if (tunnel->type == CC_TUNNEL_TYPE_STORAGE)
 		cc_log("Tunnel: Created '%s', type 'storage' peer '%s'", tunnel->id, tunnel->link->peer_id);
@@ -166,6 +192,15 @@ cc_tunnel_t *cc_tunnel_create(cc_node_t *node, cc_tunnel_type_t type, cc_tunnel_
 	return tunnel;
 }
 
+size_t cc_tunnel_get_serialized_size(const cc_tunnel_t *tunnel)
+{
+	return cc_coder_sizeof_map(4) +
+		cc_coder_sizeof_key("id") + cc_coder_sizeof_str(strnlen(tunnel->id, CC_UUID_BUFFER_SIZE)) +
+		cc_coder_sizeof_key("peer_id") + cc_coder_sizeof_str(strnlen(tunnel->link->peer_id, CC_UUID_BUFFER_SIZE)) +
+		cc_coder_sizeof_key("state") + cc_coder_sizeof_uint(tunnel->state) +
+		cc_coder_sizeof_key("type") + cc_coder_sizeof_uint(tunnel->type);
+}
+
 char *cc_tunnel_serialize(const cc_tunnel_t *tunnel, char *buffer)
 {
 	buffer = cc_coder_encode_map(buffer, 4);
@@ -211,10 +246,13 @@ void cc_tunnel_free(cc_node_t *node, cc_tunnel_t *tunnel, bool unref_link)
 {
 	if (tunnel != NULL) {
 		cc_log("Tunnel: Deleting '%s'", tunnel->id);
+		cc_node_remove_pending_msgs_with_data(node, tunnel);
 		if (unref_link && tunnel->link != NULL)
 			cc_link_remove_ref(node, tunnel->link);
 		cc_list_remove(&node->tunnels, tunnel->id);
+		cc_index_remove(&node->tunnel_index, tunnel->id, strnlen(tunnel->id, CC_UUID_BUFFER_SIZE), tunnel);
 		cc_platform_mem_free((void *)tunnel);
+		cc_node_set_dirty(node);
 	}
 }
 
@@ -250,10 +288,18 @@ cc_result_t cc_tunnel_handle_tunnel_new_request(cc_node_t *node, char *peer_id,
 			return CC_SUCCESS;
 		}
 
-		if (cc_uuid_is_higher(tunnel_id, tunnel_id_len, tunnel->id, strnlen(tunnel->id, CC_UUID_BUFFER_SIZE)))
+		if (cc_uuid_is_higher(tunnel_id, tunnel_id_len, tunnel->id, strnlen(tunnel->id, CC_UUID_BUFFER_SIZE))) {
+			// the id is the index key
+			cc_index_remove(&node->tunnel_index, tunnel->id, strnlen(tunnel->id, CC_UUID_BUFFER_SIZE), tunnel);
 			strncpy(tunnel->id, tunnel_id, tunnel_id_len);
+			tunnel->id[tunnel_id_len] = '\0';
+			if (cc_index_add(&node->tunnel_index, tunnel->id, tunnel_id_len, tunnel) != CC_SUCCESS)
+				cc_log_error("Failed to index tunnel");
+		}
 
 		tunnel->state = CC_TUNNEL_ENABLED;
+		cc_node_set_dirty(node);
+		cc_scheduler_all_ready(node);
 	} else {
 		tunnel = cc_tunnel_create(node, CC_TUNNEL_TYPE_TOKEN, CC_TUNNEL_ENABLED, peer_id, peer_id_len, tunnel_id, tunnel_id_len);
 		if (tunnel == NULL) {
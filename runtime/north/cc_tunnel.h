@@ -41,7 +41,9 @@ typedef struct cc_tunnel_t {
 	cc_tunnel_type_t type;
 } cc_tunnel_t;
 
+cc_result_t cc_tunnel_connect(struct cc_node_t *node, cc_tunnel_t *tunnel);
 cc_tunnel_t *cc_tunnel_create(struct cc_node_t *node, cc_tunnel_type_t type, cc_tunnel_state_t state, char *peer_id, uint32_t peer_id_len, char *tunnel_id, uint32_t tunnel_id_len);
+size_t cc_tunnel_get_serialized_size(const cc_tunnel_t *tunnel);
 char *cc_tunnel_serialize(const cc_tunnel_t *tunnel, char *buffer);
 cc_tunnel_t *cc_tunnel_deserialize(struct cc_node_t *node, char *buffer);
 cc_tunnel_t *cc_tunnel_get_from_id(struct cc_node_t *node, const char *tunnel_id, uint32_t tunnel_id_len);
@@ -33,6 +33,14 @@ typedef enum {
   CC_CODER_NIL
 } cc_coder_type_t;
 
+// map key to look up with cc_coder_decode_map_keys
+typedef struct cc_coder_key_t {
+	const char *key;
+	uint32_t key_len;
+} cc_coder_key_t;
+
+#define CC_CODER_KEY(key) {key, sizeof(key) - 1}
+
 cc_coder_type_t cc_coder_type_of(char *buffer);
 bool cc_coder_has_key(char *buffer, const char *key);
 uint32_t cc_coder_sizeof_bool(bool value);
@@ -42,12 +50,19 @@ uint32_t cc_coder_sizeof_double(double value);
 uint32_t cc_coder_sizeof_float(float value);
 uint32_t cc_coder_sizeof_str(uint32_t len);
 uint32_t cc_coder_sizeof_nil(void);
+uint32_t cc_coder_sizeof_bin(uint32_t len);
+uint32_t cc_coder_sizeof_map(uint32_t items);
+uint32_t cc_coder_sizeof_array(uint32_t items);
+uint32_t cc_coder_sizeof_key(const char *key);
 size_t cc_coder_get_size_of_value(char *value);
+size_t cc_coder_check_value(char *value, size_t len);
 uint32_t cc_coder_get_size_of_array(char *buffer);
 char *cc_coder_encode_map(char *buffer, uint32_t items);
 char *cc_coder_encode_str(char *buffer, const char *data, uint32_t len);
 char *cc_coder_encode_bin(char *buffer, const char *data, uint32_t len);
+char *cc_coder_encode_bin_header(char *buffer, uint32_t len);
 char *cc_coder_encode_uint(char *buffer, uint32_t data);
+char *cc_coder_encode_uint32(char *buffer, uint32_t data);
 char *cc_coder_encode_int(char *buffer, uint32_t data);
 char *cc_coder_encode_double(char *buffer, double data);
 char *cc_coder_encode_float(char *buffer, float data);
@@ -68,6 +83,7 @@ char *cc_coder_encode_kv_value(char *buffer, const char *key, const char *value,
 cc_result_t cc_coder_get_value_from_array(char *buffer, uint32_t index, char **value);
 cc_result_t cc_coder_get_value_from_map_n(char *buffer, const char *key, uint32_t key_len, char **value);
 cc_result_t cc_coder_get_value_from_map(char *buffer, const char *key, char **value);
+cc_result_t cc_coder_decode_map_keys(char *buffer, const cc_coder_key_t *keys, uint32_t nbr_of_keys, char **values);
 cc_result_t cc_coder_decode_bool(char *buffer, bool *value);
 cc_result_t cc_coder_decode_uint(char *buffer, uint32_t *value);
 cc_result_t cc_coder_decode_bin(char *buffer, char **value, uint32_t *len);
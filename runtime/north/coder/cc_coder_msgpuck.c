@@ -96,6 +96,27 @@ uint32_t cc_coder_sizeof_nil(void)
 	return mp_sizeof_nil();
 }
 
+uint32_t cc_coder_sizeof_bin(uint32_t len)
+{
+	return mp_sizeof_bin(len) + len;
+}
+
+uint32_t cc_coder_sizeof_map(uint32_t items)
+{
+	return mp_sizeof_map(items);
+}
+
+uint32_t cc_coder_sizeof_array(uint32_t items)
+{
+	return mp_sizeof_array(items);
+}
+
+// Size of the key written by the cc_coder_encode_kv_* functions
+uint32_t cc_coder_sizeof_key(const char *key)
+{
+	return cc_coder_sizeof_str(strlen(key));
+}
+
 char *cc_coder_encode_map(char *buffer, uint32_t items)
 {
 	return mp_encode_map(buffer, items);
@@ -111,11 +132,24 @@ char *cc_coder_encode_bin(char *buffer, const char *data, uint32_t len)
 	return mp_encode_bin(buffer, data, len);
 }
 
+// Encodes the header of a bin of len bytes, the data is written separately
+char *cc_coder_encode_bin_header(char *buffer, uint32_t len)
+{
+	return mp_encode_binl(buffer, len);
+}
+
 char *cc_coder_encode_uint(char *buffer, uint32_t data)
 {
 	return mp_encode_uint(buffer, data);
 }
 
+// Always uses the 5 byte encoding so the value can be overwritten in place
+char *cc_coder_encode_uint32(char *buffer, uint32_t data)
+{
+	buffer = mp_store_u8(buffer, 0xce);
+	return mp_store_u32(buffer, data);
+}
+
 char *cc_coder_encode_int(char *buffer, uint32_t data)
 {
 	return mp_encode_int(buffer, data);
@@ -290,6 +324,35 @@ cc_result_t cc_coder_get_value_from_map(char *buffer, const char *key, char **va
 		return cc_coder_get_value_from_map_n(buffer, key, strlen(key), value);
 }
 
+// Sets values[i] to the value of keys[i] or NULL if not in the map, the map is only walked once
+cc_result_t cc_coder_decode_map_keys(char *buffer, const cc_coder_key_t *keys, uint32_t nbr_of_keys, char **values)
+{
+	char *r = buffer, *key = NULL;
+	uint32_t i = 0, j = 0, map_size = 0, key_len = 0;
+
+	for (j = 0; j < nbr_of_keys; j++)
+		values[j] = NULL;
+
+	if (mp_typeof(*r) != MP_MAP)
+		return CC_FAIL;
+
+	map_size = mp_decode_map((const char **)&r);
+	for (i = 0; i < map_size; i++) {
+		if (mp_typeof(*r) != MP_STR)
+			return CC_FAIL;
+		key = (char *)mp_decode_str((const char **)&r, &key_len);
+		for (j = 0; j < nbr_of_keys; j++) {
+			if (values[j] == NULL && keys[j].key_len == key_len && memcmp(keys[j].key, key, key_len) == 0) {
+				values[j] = r;
+				break;
+			}
+		}
+		mp_next((const char **)&r);
+	}
+
+	return CC_SUCCESS;
+}
+
 cc_result_t cc_coder_decode_str(char *buffer, char **value, uint32_t *len)
 {
 	char *r = buffer;
@@ -548,6 +611,17 @@ size_t cc_coder_get_size_of_value(char *value)
 	return next - value;
 }
 
+// Size of the value or 0 if it is not complete within len bytes
+size_t cc_coder_check_value(char *value, size_t len)
+{
+	const char *next = value;
+
+	if (len == 0 || mp_check(&next, value + len) != 0)
+		return 0;
+
+	return next - value;
+}
+
 uint32_t cc_coder_decode_map(char **data)
 {
 	return mp_decode_map((const char **)data);
@@ -19,6 +19,44 @@
 #include <stdbool.h>
 #include "runtime/north/cc_node.h"
 
+/**
+ * fire_actors() - Fire actors and transmit tokens
+ * @node the node object
+ *
+ * Installed as node->fire_actors, the implementation is selected at build
+ * time with SCHEDULER=<np_scheduler|rq_scheduler>.
+ *
+ * Return: true if an actor fired
+ */
 bool fire_actors(cc_node_t *node);
 
+/**
+ * cc_scheduler_actor_ready() - Mark an actor as ready to be scheduled
+ * @node the node object
+ * @actor the actor
+ *
+ * Called when a token is written to one of the actors in-ports, a token
+ * sent from one of its out-ports is acked/nacked, one of its timers trigger
+ * or its state changes.
+ */
+void cc_scheduler_actor_ready(cc_node_t *node, cc_actor_t *actor);
+
+/**
+ * cc_scheduler_actor_removed() - Remove an actor from the scheduler
+ * @node the node object
+ * @actor the actor
+ *
+ * Called before an actor is freed.
+ */
+void cc_scheduler_actor_removed(cc_node_t *node, cc_actor_t *actor);
+
+/**
+ * cc_scheduler_all_ready() - Mark all actors as ready to be scheduled
+ * @node the node object
+ *
+ * Used for events without a known owner such as tunnel state changes and
+ * calvinsys file descriptor events.
+ */
+void cc_scheduler_all_ready(cc_node_t *node);
+
 #endif /* SCHEDULER_H */
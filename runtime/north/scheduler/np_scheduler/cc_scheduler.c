@@ -37,6 +37,7 @@ bool fire_actors(cc_node_t *node)
 		if (actor->state == CC_ACTOR_ENABLED) {
 			if (actor->fire(actor)) {
 				cc_log("Scheduler: Fired '%s', time '%ld'", actor->id, cc_node_get_time(node));
+				cc_actor_set_dirty(actor);
 				fired = true;
 			}
 		}
@@ -59,3 +60,16 @@ bool fire_actors(cc_node_t *node)
 
 	return fired;
 }
+
+void cc_scheduler_actor_ready(cc_node_t *node, cc_actor_t *actor)
+{
+	// All actors are visited on each pass
+}
+
+void cc_scheduler_actor_removed(cc_node_t *node, cc_actor_t *actor)
+{
+}
+
+void cc_scheduler_all_ready(cc_node_t *node)
+{
+}
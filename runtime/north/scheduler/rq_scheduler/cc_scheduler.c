@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2016 Ericsson AB
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "runtime/north/scheduler/cc_scheduler.h"
+#include "runtime/north/cc_actor.h"
+#include "runtime/north/cc_port.h"
+#include "runtime/north/cc_fifo.h"
+#include "runtime/north/cc_common.h"
+#include "calvinsys/cc_calvinsys.h"
+
+/** Ready queue actor scheduler
+ *
+ * Only actors marked as ready by an event (token written to an in-port,
+ * token acked/nacked, timer triggered, state changed) are visited, and
+ * actors polling calvinsys objects without events are visited in the passes
+ * where one of the objects can be read.
+ * Actors still ready after a pass are visited in the next pass without the
+ * node waiting for events.
+ */
+void cc_scheduler_actor_ready(cc_node_t *node, cc_actor_t *actor)
+{
+	if (actor == NULL || actor->ready)
+		return;
+
+	actor->ready = true;
+	actor->next_ready = NULL;
+	if (node->ready_actors_tail != NULL)
+		node->ready_actors_tail->next_ready = actor;
+	else
+		node->ready_actors = actor;
+	node->ready_actors_tail = actor;
+}
+
+void cc_scheduler_actor_removed(cc_node_t *node, cc_actor_t *actor)
+{
+	cc_actor_t *item = node->ready_actors, *prev = NULL;
+
+	if (!actor->ready)
+		return;
+
+	while (item != NULL) {
+		if (item == actor) {
+			if (prev == NULL)
+				node->ready_actors = item->next_ready;
+			else
+				prev->next_ready = item->next_ready;
+			if (node->ready_actors_tail == item)
+				node->ready_actors_tail = prev;
+			break;
+		}
+		prev = item;
+		item = item->next_ready;
+	}
+
+	actor->ready = false;
+	actor->next_ready = NULL;
+}
+
+void cc_scheduler_all_ready(cc_node_t *node)
+{
+	cc_list_t *actors = node->actors;
+
+	while (actors != NULL) {
+		cc_scheduler_actor_ready(node, (cc_actor_t *)actors->data);
+		actors = actors->next;
+	}
+}
+
+static cc_actor_t *cc_scheduler_next_ready(cc_node_t *node)
+{
+	cc_actor_t *actor = node->ready_actors;
+
+	if (actor == NULL)
+		return NULL;
+
+	node->ready_actors = actor->next_ready;
+	if (node->ready_actors == NULL)
+		node->ready_actors_tail = NULL;
+	actor->ready = false;
+	actor->next_ready = NULL;
+
+	return actor;
+}
+
+// Returns true if tokens were sent and more are waiting
+static bool cc_scheduler_transmit(cc_node_t *node, cc_list_t *ports)
+{
+	bool pending = false;
+	cc_port_t *port = NULL;
+	uint32_t read_pos = 0;
+
+	while (ports != NULL) {
+		port = (cc_port_t *)ports->data;
+		read_pos = port->fifo->tentative_read_pos;
+		cc_port_transmit(node, port);
+		if (port->direction == CC_PORT_DIRECTION_OUT && port->state == CC_PORT_ENABLED) {
+			if (port->fifo->tentative_read_pos != read_pos && cc_fifo_tokens_available(port->fifo, 1))
+				pending = true;
+		}
+		ports = ports->next;
+	}
+
+	return pending;
+}
+
+// Queues the actor for the next pass
+static void cc_scheduler_defer(cc_actor_t *actor, cc_actor_t **deferred, cc_actor_t **deferred_tail)
+{
+	actor->ready = true;
+	actor->next_ready = NULL;
+	if (*deferred_tail != NULL)
+		(*deferred_tail)->next_ready = actor;
+	else
+		*deferred = actor;
+	*deferred_tail = actor;
+}
+
+bool fire_actors(cc_node_t *node)
+{
+	bool fired = false, pending = false;
+	cc_actor_t *actor = NULL, *deferred = NULL, *deferred_tail = NULL;
+	cc_list_t *ports = NULL;
+	cc_port_t *port = NULL;
+
+	// actors marked as ready while firing, such as the local peer of a fired actor,
+	// are visited in the same pass but each actor at most once per pass
+	node->scheduler_pass++;
+	cc_calvinsys_ready_polled(node->calvinsys);
+	while ((actor = cc_scheduler_next_ready(node)) != NULL) {
+		if (actor->scheduler_pass == node->scheduler_pass) {
+			cc_scheduler_defer(actor, &deferred, &deferred_tail);
+			continue;
+		}
+		actor->scheduler_pass = node->scheduler_pass;
+
+		if (actor->state == CC_ACTOR_DO_DELETE) {
+			cc_actor_free(node, actor, true);
+			continue;
+		}
+
+		pending = false;
+		if (actor->state == CC_ACTOR_ENABLED) {
+			if (actor->fire(actor)) {
+				cc_log("Scheduler: Fired '%s', time '%ld'", actor->id, cc_node_get_time(node));
+				cc_actor_set_dirty(actor);
+				fired = true;
+				pending = true;
+
+				// consumed tokens frees slots for local producers
+				ports = actor->in_ports;
+				while (ports != NULL) {
+					port = (cc_port_t *)ports->data;
+					if (port->peer_port != NULL)
+						cc_scheduler_actor_ready(node, port->peer_port->actor);
+					ports = ports->next;
+				}
+			}
+		}
+
+		if (cc_scheduler_transmit(node, actor->in_ports))
+			pending = true;
+
+		if (cc_scheduler_transmit(node, actor->out_ports))
+			pending = true;
+
+		if (pending && !actor->ready)
+			cc_scheduler_defer(actor, &deferred, &deferred_tail);
+	}
+
+	node->ready_actors = deferred;
+	node->ready_actors_tail = deferred_tail;
+
+	return fired;
+}
@@ -107,6 +107,13 @@ static char *cc_gyroscope_serialize(char *id, cc_calvinsys_obj_t *obj, char *buf
 	return buffer;
 }
 
+static size_t cc_gyroscope_get_serialized_size(char *id, cc_calvinsys_obj_t *obj)
+{
+	cc_android_sensor_data_t *data_acc = (cc_android_sensor_data_t *)obj->state;
+
+	return cc_coder_sizeof_key("obj") + cc_coder_sizeof_map(1) + cc_coder_sizeof_key("period") + cc_coder_sizeof_uint(data_acc->period);
+}
+
 cc_result_t cc_gyroscope_open(cc_calvinsys_obj_t *obj, cc_list_t *kwargs)
 {
 	cc_android_sensor_data_t *data_acc = NULL;
@@ -147,6 +154,7 @@ cc_result_t cc_gyroscope_open(cc_calvinsys_obj_t *obj, cc_list_t *kwargs)
 	obj->close = gyroscope_close;
 	obj->state = (void *)data_acc;
 	obj->serialize = cc_gyroscope_serialize;
+	obj->get_serialized_size = cc_gyroscope_get_serialized_size;
 
 	ASensorEventQueue_setEventRate(data_acc->queue, data_acc->sensor, (int32_t)period);
 	ASensorEventQueue_enableSensor(data_acc->queue, data_acc->sensor);
@@ -176,6 +176,15 @@ static int platform_android_socket_fd_handler(int fd, int events, void *data)
 	return 1; // Always return 1, since 0  will unregister the FD in the looper
 }
 
+static int platform_android_socket_connect_handler(int fd, int events, void *data)
+{
+	cc_node_t *node = (cc_node_t *)data;
+
+	cc_transport_socket_connect_done(node->transport_client);
+
+	return 0; // the fd is added again for input when connected
+}
+
 #if (CC_USE_SLEEP == 1)
 void cc_platform_deepsleep(cc_node_t *node)
 {
@@ -183,7 +192,7 @@ void cc_platform_deepsleep(cc_node_t *node)
 }
 #endif
 
-cc_platform_evt_wait_status_t cc_platform_evt_wait(cc_node_t *node, uint32_t timeout_seconds)
+cc_platform_evt_wait_status_t cc_platform_evt_wait(cc_node_t *node, uint32_t timeout_ms)
 {
 	cc_platform_android_t *platform = (cc_platform_android_t *)node->platform;
 	int poll_result;
@@ -205,12 +214,21 @@ cc_platform_evt_wait_status_t cc_platform_evt_wait(cc_node_t *node, uint32_t tim
 				sleep(5);
 			}
 		}
+	} else if (node->transport_client != NULL && node->transport_client->state == CC_TRANSPORT_CONNECTING) {
+		// the socket is writable when the connect completes
+		if (ALooper_addFd(platform->looper,
+			((cc_transport_socket_client_t *)node->transport_client->client_state)->fd,
+			ALOOPER_POLL_CALLBACK, ALOOPER_EVENT_OUTPUT,
+			&platform_android_socket_connect_handler, node) != 1) {
+			cc_log_error("Could not add socket fd");
+			sleep(5);
+		}
 	} else {
 		sleep(10);
 		return CC_PLATFORM_EVT_WAIT_TIMEOUT;
 	}
 
-	poll_result = ALooper_pollOnce(timeout_seconds == CC_INDEFINITELY_TIMEOUT ? -1 : timeout_seconds, NULL, NULL, NULL);
+	poll_result = ALooper_pollOnce(timeout_ms == CC_INDEFINITELY_TIMEOUT ? -1 : (int)timeout_ms, NULL, NULL, NULL);
 	if (poll_result == ALOOPER_POLL_CALLBACK || poll_result == ALOOPER_POLL_TIMEOUT)
 		return CC_PLATFORM_EVT_WAIT_DATA_READ;
 
@@ -548,6 +566,11 @@ cc_result_t cc_platform_stop(cc_node_t *node)
 
 cc_result_t cc_platform_mem_alloc(void **buffer, uint32_t size)
 {
+#if CC_USE_SLAB
+	if (cc_slab_alloc(buffer, size) == CC_SUCCESS)
+		return CC_SUCCESS;
+#endif
+
 	*buffer = malloc(size);
 	if (*buffer == NULL) {
 		cc_log_error("Failed to allocate '%ld' memory", (unsigned long)size);
@@ -570,16 +593,21 @@ void *cc_platform_mem_calloc(size_t nitems, size_t size)
 
 void cc_platform_mem_free(void *buffer)
 {
+#if CC_USE_SLAB
+	if (cc_slab_free(buffer))
+		return;
+#endif
+
 	free(buffer);
 }
 
-uint32_t cc_platform_get_time(void)
+uint64_t cc_platform_get_time_ms(void)
 {
-	struct timeval value;
+	struct timespec value;
 
-	gettimeofday(&value, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &value);
 
-	return value.tv_sec;
+	return (uint64_t)value.tv_sec * 1000 + value.tv_nsec / 1000000;
 }
 
 #if CC_USE_STORAGE
@@ -680,6 +708,37 @@ cc_result_t cc_platform_file_write(const char *path, char *buffer, size_t size)
 	return CC_SUCCESS;
 }
 
+cc_result_t cc_platform_file_append(const char *path, char *buffer, size_t size)
+{
+	FILE *fp = NULL;
+	size_t len = 0;
+
+	if (cc_platform_create_dirs(path) != CC_SUCCESS)
+		return CC_FAIL;
+
+	fp = fopen(path, "a");
+	if (fp == NULL)
+		return CC_FAIL;
+
+	len = fwrite(buffer, 1, size, fp);
+	if (fclose(fp) != 0 || len != size) {
+		cc_log_error("Failed to append to '%s'", path);
+		return CC_FAIL;
+	}
+
+	return CC_SUCCESS;
+}
+
+cc_result_t cc_platform_file_map(const char *path, char **buffer, size_t *len)
+{
+	return cc_platform_file_read(path, buffer, len);
+}
+
+void cc_platform_file_unmap(char *buffer, size_t len)
+{
+	cc_platform_mem_free(buffer);
+}
+
 cc_result_t cc_platform_file_del(const char *path)
 {
 	if (unlink(path) < 0)
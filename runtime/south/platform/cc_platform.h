@@ -90,7 +90,7 @@ void cc_platform_mem_free(void *buffer);
 /**
  * cc_platform_evt_wait() - Wait for an event
  * @node the node
- * @timeout_seconds time in seconds to block waiting for an event
+ * @timeout_ms time in milliseconds to block waiting for an event, 0 blocks indefinitely
  *
  * The call should block waiting for:
  * - Data is available on a transport interface, received data handled by calling transport_handle_data defined in transport.h.
@@ -99,7 +99,63 @@ void cc_platform_mem_free(void *buffer);
  *
  * Return: CC_PLATFORM_EVT_WAIT_DATA_READ if data was read, CC_PLATFORM_EVT_WAIT_FAIL on error, CC_PLATFORM_EVT_WAIT_TIMEOUT on timeout
  */
-cc_platform_evt_wait_status_t cc_platform_evt_wait(struct cc_node_t *node, uint32_t timeout_seconds);
+cc_platform_evt_wait_status_t cc_platform_evt_wait(struct cc_node_t *node, uint32_t timeout_ms);
+
+#if CC_USE_FDS
+#define CC_PLATFORM_EVENT_READ (1 << 0)
+#define CC_PLATFORM_EVENT_WRITE (1 << 1)
+
+typedef cc_result_t (*cc_platform_event_handler_t)(struct cc_node_t *node, int fd, uint32_t events, void *data);
+
+/**
+ * cc_platform_add_event_source() - Wait for events on a descriptor
+ * @node the node
+ * @fd the descriptor
+ * @events CC_PLATFORM_EVENT_READ/CC_PLATFORM_EVENT_WRITE
+ * @handler called from cc_platform_evt_wait() with the ready events
+ * @data passed to handler
+ *
+ * The descriptor stays registered until removed and must be removed before
+ * it is closed. A failing handler fails cc_platform_evt_wait().
+ *
+ * Return: CC_SUCCESS/CC_FAILURE
+ */
+cc_result_t cc_platform_add_event_source(struct cc_node_t *node, int fd, uint32_t events, cc_platform_event_handler_t handler, void *data);
+
+/**
+ * cc_platform_modify_event_source() - Change the events waited for on a descriptor
+ * @node the node
+ * @fd the descriptor
+ * @events CC_PLATFORM_EVENT_READ/CC_PLATFORM_EVENT_WRITE, 0 to pause
+ *
+ * Return: CC_SUCCESS/CC_FAILURE
+ */
+cc_result_t cc_platform_modify_event_source(struct cc_node_t *node, int fd, uint32_t events);
+
+/**
+ * cc_platform_remove_event_source() - Stop waiting for events on a descriptor
+ * @node the node
+ * @fd the descriptor
+ *
+ * Can be called from a handler.
+ */
+void cc_platform_remove_event_source(struct cc_node_t *node, int fd);
+#endif
+
+#if CC_USE_WORKERS
+/**
+ * cc_platform_submit_work() - Run a blocking operation off the node loop
+ * @node the node
+ * @work called on a worker thread, must not use the node or allocate with cc_platform_mem_alloc
+ * @done called from cc_platform_evt_wait() when work has returned
+ * @data passed to work and done
+ *
+ * Submitted work is completed before cc_platform_stop() returns.
+ *
+ * Return: CC_SUCCESS/CC_FAILURE
+ */
+cc_result_t cc_platform_submit_work(struct cc_node_t *node, void (*work)(void *data), void (*done)(struct cc_node_t *node, void *data), void *data);
+#endif
 
 /**
  * cc_platform_stop() - Called when the platform stops
@@ -118,11 +174,13 @@ cc_result_t cc_platform_stop(struct cc_node_t *node);
 cc_result_t cc_platform_node_started(struct cc_node_t *node);
 
 /**
- * cc_platform_get_time() - Get system time (s)
+ * cc_platform_get_time_ms() - Get monotonic system time (ms)
+ *
+ * The time must not be affected by changes of the wall clock.
  *
- * Return: System time in seconds since boot/reset
+ * Return: System time in milliseconds since boot/reset
  */
-uint32_t cc_platform_get_time(void);
+uint64_t cc_platform_get_time_ms(void);
 
 #if CC_USE_SLEEP
 /**
@@ -151,6 +209,24 @@ cc_stat_t cc_platform_file_stat(const char *path);
  */
 cc_result_t cc_platform_file_read(const char *path, char **buffer, size_t *len);
 
+/**
+ * cc_platform_file_map() - Map file content to buffer, the content is read if
+ * the platform cannot map files
+ * @path the path
+ * @buffer the mapped content
+ * @len size of the content
+ *
+ * Return: CC_SUCCESS if success or CC_FAIL on failure
+ */
+cc_result_t cc_platform_file_map(const char *path, char **buffer, size_t *len);
+
+/**
+ * cc_platform_file_unmap() - Release content from cc_platform_file_map()
+ * @buffer the mapped content
+ * @len size of the content
+ */
+void cc_platform_file_unmap(char *buffer, size_t len);
+
 /**
  * cc_platform_file_write() - Write to file pointed by path
  * @path the path
@@ -161,6 +237,17 @@ cc_result_t cc_platform_file_read(const char *path, char **buffer, size_t *len);
  */
 cc_result_t cc_platform_file_write(const char *path, char *buffer, size_t size);
 
+/**
+ * cc_platform_file_append() - Append to file pointed by path, the file is
+ * created if it does not exist
+ * @path the path
+ * @buffer buffer to write
+ * @size size of the buffer
+ *
+ * Return: CC_SUCCESS if success or CC_FAIL on failure
+ */
+cc_result_t cc_platform_file_append(const char *path, char *buffer, size_t size);
+
 /**
  * cc_platform_file_del() - Delete file pointed by path
  * @path the path
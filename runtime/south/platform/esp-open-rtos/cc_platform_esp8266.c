@@ -122,6 +122,11 @@ cc_result_t cc_platform_late_init(cc_node_t *node, const char *args)
 
 cc_result_t cc_platform_mem_alloc(void **buffer, uint32_t size)
 {
+#if CC_USE_SLAB
+	if (cc_slab_alloc(buffer, size) == CC_SUCCESS)
+		return CC_SUCCESS;
+#endif
+
 	*buffer = malloc(size);
 	if (*buffer == NULL) {
 		cc_log_error("Failed to allocate '%ld' bytes", (unsigned long)size);
@@ -144,18 +149,23 @@ void *cc_platform_mem_calloc(size_t nitems, size_t size)
 
 void cc_platform_mem_free(void *buffer)
 {
+#if CC_USE_SLAB
+	if (cc_slab_free(buffer))
+		return;
+#endif
+
 	free(buffer);
 }
 
-cc_platform_evt_wait_status_t cc_platform_evt_wait(struct cc_node_t *node, uint32_t timeout_seconds)
+cc_platform_evt_wait_status_t cc_platform_evt_wait(struct cc_node_t *node, uint32_t timeout_ms)
 {
 	fd_set fds;
 	int fd = 0;
 	struct timeval tv, *tv_ref = NULL;
 
-	if (timeout_seconds > 0) {
-		tv.tv_sec = timeout_seconds;
-		tv.tv_usec = 0;
+	if (timeout_ms > 0) {
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
 		tv_ref = &tv;
 	}
 
@@ -175,9 +185,20 @@ cc_platform_evt_wait_status_t cc_platform_evt_wait(struct cc_node_t *node, uint3
 			}
 			return CC_PLATFORM_EVT_WAIT_DATA_READ;
 		}
+	} else if (node->transport_client != NULL && node->transport_client->state == CC_TRANSPORT_CONNECTING) {
+		// the socket is writable when the connect completes
+		FD_SET(((cc_transport_socket_client_t *)node->transport_client->client_state)->fd, &fds);
+		fd = ((cc_transport_socket_client_t *)node->transport_client->client_state)->fd;
+
+		select(fd + 1, NULL, &fds, NULL, tv_ref);
+
+		if (FD_ISSET(fd, &fds)) {
+			cc_transport_socket_connect_done(node->transport_client);
+			return CC_PLATFORM_EVT_WAIT_DATA_READ;
+		}
 	} else {
-		if (timeout_seconds > 0)
-			vTaskDelay((timeout_seconds * 1000) / portTICK_PERIOD_MS);
+		if (timeout_ms > 0)
+			vTaskDelay(timeout_ms / portTICK_PERIOD_MS);
 	}
 
 	return CC_PLATFORM_EVT_WAIT_TIMEOUT;
@@ -230,6 +251,28 @@ cc_result_t cc_platform_file_write(const char *path, char *buffer, size_t size)
 	return result;
 }
 
+cc_result_t cc_platform_file_append(const char *path, char *buffer, size_t size)
+{
+	cc_result_t result = CC_SUCCESS;
+	spiffs_file fd;
+	int res = 0;
+
+	fd = SPIFFS_open(&fs, path, SPIFFS_CREAT | SPIFFS_APPEND | SPIFFS_RDWR, 0);
+	if (fd < 0) {
+		cc_log_error("Failed to open '%s', errno '%i'", path, SPIFFS_errno(&fs));
+		return CC_FAIL;
+	}
+
+	res = SPIFFS_write(&fs, fd, buffer, size);
+	if (res != size) {
+		cc_log_error("Failed to append to '%s' status '%d'", path, res);
+		result = CC_FAIL;
+	}
+	SPIFFS_close(&fs, fd);
+
+	return result;
+}
+
 cc_result_t cc_platform_file_read(const char *path, char **buffer, size_t *size)
 {
 	size_t read = 0;
@@ -261,6 +304,16 @@ cc_result_t cc_platform_file_read(const char *path, char **buffer, size_t *size)
 	return CC_SUCCESS;
 }
 
+cc_result_t cc_platform_file_map(const char *path, char **buffer, size_t *len)
+{
+	return cc_platform_file_read(path, buffer, len);
+}
+
+void cc_platform_file_unmap(char *buffer, size_t len)
+{
+	cc_platform_mem_free(buffer);
+}
+
 cc_result_t cc_platform_file_del(const char *path)
 {
 	// TODO: Implement
@@ -275,9 +328,10 @@ void cc_platform_deepsleep(uint32_t time)
 }
 #endif
 
-uint32_t cc_platform_get_time()
+uint64_t cc_platform_get_time_ms(void)
 {
-	return sdk_system_get_time() / 1000000;
+	// sdk_system_get_time() wraps after ~71 minutes, use the tick count
+	return (uint64_t)xTaskGetTickCount() * portTICK_PERIOD_MS;
 }
 
 static cc_result_t cc_platform_esp_get_config(void)
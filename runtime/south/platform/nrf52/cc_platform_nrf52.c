@@ -274,7 +274,7 @@ void cc_platform_init(void)
 	cc_log("Platform initialized");
 }
 
-cc_platform_evt_wait_status_t cc_platform_evt_wait(cc_node_t *node, uint32_t timeout_seconds)
+cc_platform_evt_wait_status_t cc_platform_evt_wait(cc_node_t *node, uint32_t timeout_ms)
 {
 	if (sd_app_evt_wait() != ERR_OK) {
 		cc_log_error("Failed to wait for event");
@@ -297,6 +297,11 @@ cc_platform_evt_wait_status_t cc_platform_evt_wait(cc_node_t *node, uint32_t tim
 
 cc_result_t cc_platform_mem_alloc(void **buffer, uint32_t size)
 {
+#if CC_USE_SLAB
+	if (cc_slab_alloc(buffer, size) == CC_SUCCESS)
+		return CC_SUCCESS;
+#endif
+
 	*buffer = malloc(size);
 	if (*buffer == NULL) {
 		cc_log_error("Failed to allocate '%ld'", (unsigned long)size);
@@ -308,10 +313,15 @@ cc_result_t cc_platform_mem_alloc(void **buffer, uint32_t size)
 
 void cc_platform_mem_free(void *buffer)
 {
+#if CC_USE_SLAB
+	if (cc_slab_free(buffer))
+		return;
+#endif
+
 	free(buffer);
 }
 
-uint32_t cc_platform_get_seconds(cc_node_t *node)
+uint64_t cc_platform_get_time_ms(void)
 {
  // TODO: Implement
  return 0;
@@ -172,15 +172,15 @@ cc_result_t cc_platform_late_init(cc_node_t *node, const char *args)
 	return CC_SUCCESS;
 }
 
-cc_platform_evt_wait_status_t cc_platform_evt_wait(cc_node_t *node, uint32_t timeout_seconds)
+cc_platform_evt_wait_status_t cc_platform_evt_wait(cc_node_t *node, uint32_t timeout_ms)
 {
   fd_set fds;
   int fd = 0;
   struct timeval tv, *tv_ref = NULL;
 
-  if (timeout_seconds > 0) {
-    tv.tv_sec = timeout_seconds;
-    tv.tv_usec = 0;
+  if (timeout_ms > 0) {
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
     tv_ref = &tv;
   }
 
@@ -208,6 +208,11 @@ cc_platform_evt_wait_status_t cc_platform_evt_wait(cc_node_t *node, uint32_t tim
 
 cc_result_t cc_platform_mem_alloc(void **buffer, uint32_t size)
 {
+#if CC_USE_SLAB
+  if (cc_slab_alloc(buffer, size) == CC_SUCCESS)
+    return CC_SUCCESS;
+#endif
+
   *buffer = malloc(size);
   if (*buffer == NULL) {
     cc_log_error("Failed to allocate '%ld'", (unsigned long)size);
@@ -231,16 +236,21 @@ void *cc_platform_mem_calloc(size_t nitems, size_t size)
 
 void cc_platform_mem_free(void *buffer)
 {
+#if CC_USE_SLAB
+  if (cc_slab_free(buffer))
+    return;
+#endif
+
   free(buffer);
 }
 
-uint32_t cc_platform_get_time(void)
+uint64_t cc_platform_get_time_ms(void)
 {
-	struct timeval value;
+	struct timespec value;
 
-	gettimeofday(&value, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &value);
 
-	return value.tv_sec;
+	return (uint64_t)value.tv_sec * 1000 + value.tv_nsec / 1000000;
 }
 
 #if CC_USE_SLEEP
@@ -350,6 +360,37 @@ cc_result_t cc_platform_file_write(const char *path, char *buffer, size_t size)
 	return CC_SUCCESS;
 }
 
+cc_result_t cc_platform_file_append(const char *path, char *buffer, size_t size)
+{
+	FILE *fp = NULL;
+	size_t len = 0;
+
+	if (cc_platform_create_dirs(path) != CC_SUCCESS)
+		return CC_FAIL;
+
+	fp = fopen(path, "a");
+	if (fp == NULL)
+		return CC_FAIL;
+
+	len = fwrite(buffer, 1, size, fp);
+	if (fclose(fp) != 0 || len != size) {
+		cc_log_error("Failed to append to '%s'", path);
+		return CC_FAIL;
+	}
+
+	return CC_SUCCESS;
+}
+
+cc_result_t cc_platform_file_map(const char *path, char **buffer, size_t *len)
+{
+	return cc_platform_file_read(path, buffer, len);
+}
+
+void cc_platform_file_unmap(char *buffer, size_t len)
+{
+	cc_platform_mem_free(buffer);
+}
+
 cc_result_t cc_platform_file_del(const char *path)
 {
 	if (unlink(path) < 0)
@@ -28,6 +28,7 @@
 #include "runtime/north/cc_node.h"
 #include "runtime/north/coder/cc_coder.h"
 #include "runtime/north/cc_actor_store.h"
+#include "runtime/north/scheduler/cc_scheduler.h"
 #include "runtime/south/platform/cc_platform.h"
 #include "jsmn/jsmn.h"
 
@@ -37,6 +38,15 @@ typedef struct cc_coap_state_t {
 	int fd;
 	coap_uri_t uri;
 	uint16_t message_id;
+	bool readable;
+	char ip[40];
+	char port[10];
+#if CC_USE_WORKERS
+	cc_calvinsys_obj_t *obj;
+	cc_result_t setup_result;
+	bool setting_up;
+	bool closed;
+#endif
 } cc_coap_state_t;
 
 static cc_result_t cc_coap_send_pdu(struct cc_calvinsys_obj_t *obj, bool start)
@@ -92,7 +102,15 @@ static cc_result_t cc_coap_send_pdu(struct cc_calvinsys_obj_t *obj, bool start)
 
 static bool cc_coap_can_read(struct cc_calvinsys_obj_t *obj)
 {
-	return FD_ISSET(((cc_coap_state_t *)obj->state)->fd, &obj->capability->calvinsys->node->fds) != 0;
+	return ((cc_coap_state_t *)obj->state)->readable;
+}
+
+// Stop waiting for the socket until the owning actor has read the response
+static cc_result_t cc_coap_handle_event(struct cc_calvinsys_obj_t *obj, int fd, uint32_t events)
+{
+	((cc_coap_state_t *)obj->state)->readable = true;
+
+	return cc_calvinsys_modify_event_source(obj->capability->calvinsys, fd, 0);
 }
 
 static cc_result_t cc_coap_send_ack(int fd, coap_pdu_t *request)
@@ -133,13 +151,13 @@ static cc_result_t cc_coap_read(struct cc_calvinsys_obj_t *obj, char **data, siz
 	char *w = NULL;
 
 	n = recv(state->fd, buffer, 512, 0);
+	state->readable = false;
+	cc_calvinsys_modify_event_source(obj->capability->calvinsys, state->fd, CC_PLATFORM_EVENT_READ);
 	if (n < 0) {
 		cc_log_error("Failed to read data");
 		return CC_FAIL;
 	}
 
-	FD_CLR(state->fd, &obj->capability->calvinsys->node->fds);
-
 	pdu = coap_pdu_init(0, 0, 0, n - 4);
 	if (!pdu) {
 		cc_log_error("Failed to init PDU");
@@ -188,7 +206,13 @@ static cc_result_t cc_coap_read(struct cc_calvinsys_obj_t *obj, char **data, siz
 
 static bool cc_coap_can_write(struct cc_calvinsys_obj_t *obj)
 {
+#if CC_USE_WORKERS
+	cc_coap_state_t *state = (cc_coap_state_t *)obj->state;
+
+	return !state->setting_up && state->fd >= 0;
+#else
 	return true;
+#endif
 }
 
 static cc_result_t cc_coap_write(struct cc_calvinsys_obj_t *obj, char *data, size_t size)
@@ -199,16 +223,21 @@ static cc_result_t cc_coap_write(struct cc_calvinsys_obj_t *obj, char *data, siz
 static cc_result_t cc_coap_close(struct cc_calvinsys_obj_t *obj)
 {
 	cc_coap_state_t *state = (cc_coap_state_t *)obj->state;
-	cc_calvinsys_t *sys = obj->capability->calvinsys;
-	int i = 0;
 
-	for (i = 0; i < CC_CALVINSYS_MAX_FDS; i++) {
-		if (sys->fds[i] == state->fd) {
-			sys->fds[i] = -1;
-			break;
-		}
+#if CC_USE_WORKERS
+	// freed when the setup completes
+	if (state->setting_up) {
+		state->closed = true;
+		return CC_SUCCESS;
+	}
+
+	if (state->fd < 0) {
+		cc_platform_mem_free(state);
+		return CC_SUCCESS;
 	}
+#endif
 
+	cc_calvinsys_remove_event_source(obj->capability->calvinsys, state->fd);
 	cc_coap_send_pdu(obj, false);
 	close(state->fd);
 	cc_platform_mem_free(state);
@@ -276,8 +305,6 @@ static cc_result_t cc_coap_setup(int *fd, char *ip, char *port)
 
 static cc_result_t cc_coap_init(char *init_args, cc_coap_state_t *state)
 {
-	char ip[40] = {0};
-	char port[10] = {0};
 	char *uri = NULL;
 	uint32_t len = 0;
 
@@ -291,35 +318,54 @@ static cc_result_t cc_coap_init(char *init_args, cc_coap_state_t *state)
 		return CC_FAIL;
 	}
 
-	sprintf(port, "%d", state->uri.port);
-	strncpy(ip, (char *)state->uri.host.s, state->uri.host.length);
+	sprintf(state->port, "%d", state->uri.port);
+	strncpy(state->ip, (char *)state->uri.host.s, state->uri.host.length);
+
+	return CC_SUCCESS;
+}
+
+#if CC_USE_WORKERS
+// Resolves and connects on a worker thread
+static void cc_coap_setup_work(void *data)
+{
+	cc_coap_state_t *state = (cc_coap_state_t *)data;
+
+	state->setup_result = cc_coap_setup(&state->fd, state->ip, state->port);
+}
+
+static void cc_coap_setup_done(cc_node_t *node, void *data)
+{
+	cc_coap_state_t *state = (cc_coap_state_t *)data;
+
+	state->setting_up = false;
+
+	if (state->closed) {
+		if (state->setup_result == CC_SUCCESS)
+			close(state->fd);
+		cc_platform_mem_free(state);
+		return;
+	}
+
+	if (state->setup_result == CC_SUCCESS && cc_calvinsys_add_event_source(state->obj->capability->calvinsys, state->obj, state->fd, CC_PLATFORM_EVENT_READ, cc_coap_handle_event) != CC_SUCCESS) {
+		close(state->fd);
+		state->setup_result = CC_FAIL;
+	}
 
-	if (cc_coap_setup(&state->fd, ip, port) != CC_SUCCESS) {
+	if (state->setup_result != CC_SUCCESS) {
 		cc_log_error("Failed to setup COAP client");
-		return CC_FAIL;
+		state->fd = -1;
+		return;
 	}
 
-	return CC_SUCCESS;
+	// the actor can now write
+	cc_scheduler_actor_ready(node, state->obj->actor);
 }
+#endif
 
 static cc_result_t cc_calvinsys_coap_open(cc_calvinsys_obj_t *obj, cc_list_t *kwargs)
 {
 	cc_coap_state_t *state = NULL;
 	char *init_args = (char *)obj->capability->init_args;
-	cc_calvinsys_t *sys = obj->capability->calvinsys;
-	int i = 0, fd_pos = -1;
-
-	for (i = 0; i < CC_CALVINSYS_MAX_FDS; i++) {
-		if (sys->fds[i] == -1) {
-			fd_pos = i;
-			break;
-		}
-	}
-
-	if (fd_pos == -1) {
-		cc_log_error("No free descriptors");
-		return CC_FAIL;
-	}
 
 	if (cc_platform_mem_alloc((void **)&state, sizeof(cc_coap_state_t)) != CC_SUCCESS) {
 		cc_log_error("Failed to allocate memory");
@@ -327,19 +373,43 @@ static cc_result_t cc_calvinsys_coap_open(cc_calvinsys_obj_t *obj, cc_list_t *kw
 	}
 	memset(state, 0, sizeof(cc_coap_state_t));
 
+	state->fd = -1;
+
 	if (cc_coap_init(init_args, state) != CC_SUCCESS) {
 		cc_log_error("Failed to init coap client");
 		cc_platform_mem_free(state);
 		return CC_FAIL;
 	}
 
+#if CC_USE_WORKERS
+	state->obj = obj;
+	state->setting_up = true;
+	if (cc_platform_submit_work(obj->capability->calvinsys->node, cc_coap_setup_work, cc_coap_setup_done, state) != CC_SUCCESS) {
+		cc_log_error("Failed to setup COAP client");
+		cc_platform_mem_free(state);
+		return CC_FAIL;
+	}
+#else
+	if (cc_coap_setup(&state->fd, state->ip, state->port) != CC_SUCCESS) {
+		cc_log_error("Failed to setup COAP client");
+		cc_platform_mem_free(state);
+		return CC_FAIL;
+	}
+
+	if (cc_calvinsys_add_event_source(obj->capability->calvinsys, obj, state->fd, CC_PLATFORM_EVENT_READ, cc_coap_handle_event) != CC_SUCCESS) {
+		cc_log_error("Failed to register descriptor");
+		close(state->fd);
+		cc_platform_mem_free(state);
+		return CC_FAIL;
+	}
+#endif
+
 	obj->can_write = cc_coap_can_write;
 	obj->write = cc_coap_write;
 	obj->can_read = cc_coap_can_read;
 	obj->read = cc_coap_read;
 	obj->close = cc_coap_close;
 	obj->state = state;
-	sys->fds[fd_pos] = state->fd;
 
 	return CC_SUCCESS;
 }
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2016 Ericsson AB
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include "cc_config.h"
+#include "cc_api.h"
+
+// Hosts a number of nodes in one process and reports the memory and CPU
+// used per node while they run.
+
+static uint64_t cc_bench_rss_kb(void)
+{
+	FILE *fp = NULL;
+	unsigned long size = 0, resident = 0;
+	struct rusage usage;
+
+	fp = fopen("/proc/self/statm", "r");
+	if (fp != NULL) {
+		if (fscanf(fp, "%lu %lu", &size, &resident) != 2)
+			resident = 0;
+		fclose(fp);
+		if (resident > 0)
+			return (uint64_t)resident * sysconf(_SC_PAGESIZE) / 1024;
+	}
+
+	// peak instead of current where /proc is missing
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+static uint64_t cc_bench_cpu_us(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+int main(int argc, char **argv)
+{
+	char *attr = NULL, *uris = NULL, *script = NULL;
+	int c = 0, i = 0, nbr_of_nodes = 10, started = 0, duration = 10;
+	cc_api_node_thread_t **threads = NULL;
+	char state_file[64];
+	uint64_t rss_start = 0, rss_nodes = 0, cpu_start = 0, cpu_end = 0, time_start = 0, time_end = 0;
+	static struct option long_options[] = {
+		{"nodes", required_argument, NULL, 'n'},
+		{"duration", required_argument, NULL, 'd'},
+		{"attr", required_argument, NULL, 'a'},
+		{"uris", required_argument, NULL, 'u'},
+		{"script", required_argument, NULL, 's'},
+		{NULL, 0, NULL, 0}
+	};
+
+	while ((c = getopt_long(argc, argv, "n:d:a:u:s:", long_options, NULL)) != -1) {
+		switch (c) {
+		case 'n':
+			nbr_of_nodes = atoi(optarg);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'a':
+			attr = optarg;
+			break;
+		case 'u':
+			uris = optarg;
+			break;
+		case 's':
+			script = optarg;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n nodes] [-d seconds] [-u uris] [-a attributes] [-s script]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (nbr_of_nodes <= 0 || duration <= 0)
+		return EXIT_FAILURE;
+
+	threads = calloc(nbr_of_nodes, sizeof(cc_api_node_thread_t *));
+	if (threads == NULL)
+		return EXIT_FAILURE;
+
+	rss_start = cc_bench_rss_kb();
+
+	for (i = 0; i < nbr_of_nodes; i++) {
+		snprintf(state_file, sizeof(state_file), "cc_bench_node_%d.msgpack", i);
+		if (cc_api_node_spawn(&threads[i], attr, uris, NULL, script, state_file) != CC_SUCCESS) {
+			fprintf(stderr, "Failed to spawn node %d\n", i);
+			break;
+		}
+		started++;
+	}
+
+	// let the nodes connect and deploy before measuring
+	sleep(1);
+	rss_nodes = cc_bench_rss_kb();
+	cpu_start = cc_bench_cpu_us();
+	time_start = cc_platform_get_time_ms();
+	sleep(duration);
+	cpu_end = cc_bench_cpu_us();
+	time_end = cc_platform_get_time_ms();
+
+	for (i = 0; i < started; i++)
+		cc_api_node_stop(threads[i]);
+	for (i = 0; i < started; i++) {
+		cc_api_node_join(threads[i]);
+		snprintf(state_file, sizeof(state_file), "cc_bench_node_%d.msgpack", i);
+		unlink(state_file);
+	}
+	free(threads);
+
+	if (started == 0)
+		return EXIT_FAILURE;
+
+	printf("nodes: %d\n", started);
+	printf("rss: %llu kB before, %llu kB with nodes, %.1f kB per node\n",
+		(unsigned long long)rss_start,
+		(unsigned long long)rss_nodes,
+		(double)(rss_nodes - rss_start) / started);
+	printf("cpu: %.3f%% of a core per node over %.1f s\n",
+		100.0 * (cpu_end - cpu_start) / ((time_end - time_start) * 1000.0) / started,
+		(time_end - time_start) / 1000.0);
+
+	return EXIT_SUCCESS;
+}
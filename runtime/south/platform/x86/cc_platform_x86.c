@@ -21,12 +21,34 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
 #include "cc_config.h"
 #include "runtime/south/platform/cc_platform.h"
+
+// epoll is used on Linux, other systems fall back to select
+#ifndef CC_PLATFORM_X86_EPOLL
+#ifdef __linux__
+#define CC_PLATFORM_X86_EPOLL (1)
+#else
+#define CC_PLATFORM_X86_EPOLL (0)
+#endif
+#endif
+
+#if CC_PLATFORM_X86_EPOLL
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+#if CC_USE_WORKERS
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
 #include "runtime/south/transport/socket/cc_transport_socket.h"
 #include "runtime/north/cc_transport.h"
 #include "runtime/north/cc_node.h"
+#include "runtime/north/scheduler/cc_scheduler.h"
 #include "runtime/north/cc_common.h"
 #include "calvinsys/cc_calvinsys.h"
 #include "runtime/north/coder/cc_coder.h"
@@ -52,9 +74,478 @@ void cc_platform_early_init(void)
 	srand(tv.tv_sec + tv.tv_usec + getpid());
 }
 
+#define CC_PLATFORM_X86_MAX_EVENTS (32)
+
+typedef struct cc_platform_x86_fd_t {
+	int fd;
+	uint32_t events;
+	cc_platform_event_handler_t handler;
+	void *data;
+	struct cc_platform_x86_fd_t *next;
+} cc_platform_x86_fd_t;
+
+#if CC_USE_WORKERS
+typedef struct cc_platform_x86_work_t {
+	void (*work)(void *data);
+	void (*done)(cc_node_t *node, void *data);
+	void *data;
+	struct cc_platform_x86_work_t *next;
+} cc_platform_x86_work_t;
+#endif
+
+typedef struct cc_platform_x86_t {
+	cc_platform_x86_fd_t *fds;
+	bool dispatching;
+#if CC_PLATFORM_X86_EPOLL
+	int epoll_fd;
+	int timer_fd;
+	uint64_t timer_deadline;
+#endif
+	int transport_fd;
+	uint32_t transport_generation;
+	uint32_t transport_events;
+#if CC_USE_WORKERS
+	pthread_t workers[CC_WORKER_THREADS];
+	int nbr_of_workers;
+	pthread_mutex_t work_lock;
+	pthread_cond_t work_cond;
+	cc_platform_x86_work_t *work_first; // queued, protected by work_lock
+	cc_platform_x86_work_t *work_last;
+	bool work_stop;
+	_Atomic(cc_platform_x86_work_t *) work_done; // completed, pushed by workers
+	int work_pipe[2];
+#endif
+} cc_platform_x86_t;
+
+static cc_platform_x86_fd_t *cc_platform_x86_fd_get(cc_platform_x86_t *platform, int fd)
+{
+	cc_platform_x86_fd_t *entry = platform->fds;
+
+	while (entry != NULL) {
+		if (entry->fd == fd)
+			return entry;
+		entry = entry->next;
+	}
+
+	return NULL;
+}
+
+#if CC_PLATFORM_X86_EPOLL
+static int cc_platform_x86_epoll_ctl(cc_platform_x86_t *platform, int op, cc_platform_x86_fd_t *entry)
+{
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	if (entry->events & CC_PLATFORM_EVENT_READ)
+		event.events |= EPOLLIN;
+	if (entry->events & CC_PLATFORM_EVENT_WRITE)
+		event.events |= EPOLLOUT;
+	event.data.ptr = entry;
+
+	return epoll_ctl(platform->epoll_fd, op, entry->fd, &event);
+}
+#endif
+
+static cc_result_t cc_platform_x86_transport_handler(cc_node_t *node, int fd, uint32_t events, void *data)
+{
+	if (node->transport_client->state == CC_TRANSPORT_CONNECTING) {
+		if (events & CC_PLATFORM_EVENT_WRITE)
+			cc_transport_socket_connect_done(node->transport_client);
+		return CC_SUCCESS;
+	}
+
+	if ((events & CC_PLATFORM_EVENT_READ) && cc_transport_handle_data(node, node->transport_client, cc_node_handle_message) != CC_SUCCESS) {
+		cc_log_error("Failed to handle received data");
+		return CC_FAIL;
+	}
+
+	return CC_SUCCESS;
+}
+
+
+// The transport registration is only updated when waiting, the socket may
+// have been closed and its number reused
+static bool cc_platform_x86_fd_stale(cc_node_t *node, cc_platform_x86_t *platform, cc_platform_x86_fd_t *entry)
+{
+	if (entry->handler != cc_platform_x86_transport_handler)
+		return false;
+
+	platform->transport_events = 0;
+	cc_platform_remove_event_source(node, entry->fd);
+
+	return true;
+}
+
+cc_result_t cc_platform_add_event_source(cc_node_t *node, int fd, uint32_t events, cc_platform_event_handler_t handler, void *data)
+{
+	cc_platform_x86_t *platform = (cc_platform_x86_t *)node->platform;
+	cc_platform_x86_fd_t *entry = NULL;
+
+	if (platform == NULL || fd < 0)
+		return CC_FAIL;
+
+	entry = cc_platform_x86_fd_get(platform, fd);
+	if (entry != NULL && !cc_platform_x86_fd_stale(node, platform, entry)) {
+		cc_log_error("Descriptor '%d' already registered", fd);
+		return CC_FAIL;
+	}
+	entry = NULL;
+
+	if (cc_platform_mem_alloc((void **)&entry, sizeof(cc_platform_x86_fd_t)) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return CC_FAIL;
+	}
+
+	entry->fd = fd;
+	entry->events = events;
+	entry->handler = handler;
+	entry->data = data;
+
+#if CC_PLATFORM_X86_EPOLL
+	if (cc_platform_x86_epoll_ctl(platform, EPOLL_CTL_ADD, entry) < 0) {
+		cc_log_error("Failed to register descriptor '%d'", fd);
+		cc_platform_mem_free(entry);
+		return CC_FAIL;
+	}
+#endif
+
+	entry->next = platform->fds;
+	platform->fds = entry;
+
+	return CC_SUCCESS;
+}
+
+cc_result_t cc_platform_modify_event_source(cc_node_t *node, int fd, uint32_t events)
+{
+	cc_platform_x86_t *platform = (cc_platform_x86_t *)node->platform;
+	cc_platform_x86_fd_t *entry = NULL;
+
+	if (platform == NULL || fd < 0)
+		return CC_FAIL;
+
+	entry = cc_platform_x86_fd_get(platform, fd);
+	if (entry == NULL)
+		return CC_FAIL;
+
+	if (entry->events == events)
+		return CC_SUCCESS;
+	entry->events = events;
+
+#if CC_PLATFORM_X86_EPOLL
+	if (cc_platform_x86_epoll_ctl(platform, EPOLL_CTL_MOD, entry) < 0) {
+		cc_log_error("Failed to modify descriptor '%d'", fd);
+		return CC_FAIL;
+	}
+#endif
+
+	return CC_SUCCESS;
+}
+
+void cc_platform_remove_event_source(cc_node_t *node, int fd)
+{
+	cc_platform_x86_t *platform = (cc_platform_x86_t *)node->platform;
+	cc_platform_x86_fd_t *entry = NULL, *prev = NULL;
+
+	if (platform == NULL || fd < 0)
+		return;
+
+	entry = platform->fds;
+	while (entry != NULL && entry->fd != fd) {
+		prev = entry;
+		entry = entry->next;
+	}
+
+	if (entry == NULL)
+		return;
+
+#if CC_PLATFORM_X86_EPOLL
+	// fails if the descriptor already is closed which also removes it
+	epoll_ctl(platform->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+
+	// ready events may still reference the entry, free it when dispatched
+	if (platform->dispatching) {
+		entry->fd = -1;
+		return;
+	}
+
+	if (prev == NULL)
+		platform->fds = entry->next;
+	else
+		prev->next = entry->next;
+	cc_platform_mem_free(entry);
+}
+
+static void cc_platform_x86_fd_cleanup(cc_platform_x86_t *platform)
+{
+	cc_platform_x86_fd_t *entry = platform->fds, *prev = NULL, *next = NULL;
+
+	while (entry != NULL) {
+		next = entry->next;
+		if (entry->fd < 0) {
+			if (prev == NULL)
+				platform->fds = next;
+			else
+				prev->next = next;
+			cc_platform_mem_free(entry);
+		} else
+			prev = entry;
+		entry = next;
+	}
+}
+
+// The node replaces and reconnects the transport socket, its registration
+// is only changed when the socket or transport state changes
+static cc_result_t cc_platform_x86_sync(cc_node_t *node, cc_platform_x86_t *platform)
+{
+	cc_transport_socket_client_t *transport_socket = NULL;
+	uint32_t events = 0;
+
+	if (node->transport_client != NULL) {
+		transport_socket = (cc_transport_socket_client_t *)node->transport_client->client_state;
+		if (node->transport_client->state == CC_TRANSPORT_PENDING || node->transport_client->state == CC_TRANSPORT_ENABLED)
+			events = CC_PLATFORM_EVENT_READ;
+		else if (node->transport_client->state == CC_TRANSPORT_CONNECTING)
+			events = CC_PLATFORM_EVENT_WRITE; // writable when the connect completes
+		if (transport_socket->fd < 0)
+			events = 0;
+	}
+
+	if (events != 0 && platform->transport_events != 0 && transport_socket->fd == platform->transport_fd && transport_socket->generation == platform->transport_generation) {
+		if (cc_platform_modify_event_source(node, platform->transport_fd, events) != CC_SUCCESS)
+			return CC_FAIL;
+	} else if (events != 0 || platform->transport_events != 0) {
+		if (platform->transport_events != 0)
+			cc_platform_remove_event_source(node, platform->transport_fd);
+		platform->transport_events = 0;
+		if (events != 0) {
+			if (cc_platform_add_event_source(node, transport_socket->fd, events, cc_platform_x86_transport_handler, NULL) != CC_SUCCESS)
+				return CC_FAIL;
+			platform->transport_fd = transport_socket->fd;
+			platform->transport_generation = transport_socket->generation;
+		}
+	}
+	platform->transport_events = events;
+
+	return CC_SUCCESS;
+}
+
+#if CC_USE_WORKERS
+static void *cc_platform_x86_worker(void *arg)
+{
+	cc_platform_x86_t *platform = (cc_platform_x86_t *)arg;
+	cc_platform_x86_work_t *item = NULL;
+	char wake = 0;
+
+	while (true) {
+		pthread_mutex_lock(&platform->work_lock);
+		while (platform->work_first == NULL && !platform->work_stop)
+			pthread_cond_wait(&platform->work_cond, &platform->work_lock);
+		item = platform->work_first;
+		if (item != NULL) {
+			platform->work_first = item->next;
+			if (platform->work_first == NULL)
+				platform->work_last = NULL;
+		}
+		pthread_mutex_unlock(&platform->work_lock);
+
+		// queued work is completed before stopping
+		if (item == NULL)
+			return NULL;
+
+		item->work(item->data);
+
+		// lock-free push, only the push to an empty list wakes the node loop
+		item->next = atomic_load(&platform->work_done);
+		while (!atomic_compare_exchange_weak(&platform->work_done, &item->next, item))
+			;
+		if (item->next == NULL && write(platform->work_pipe[1], &wake, 1) < 0 && errno != EAGAIN)
+			cc_log_error("Failed to wake node");
+	}
+}
+
+static void cc_platform_x86_work_complete(cc_node_t *node, cc_platform_x86_t *platform)
+{
+	cc_platform_x86_work_t *item = NULL, *completed = NULL, *next = NULL;
+
+	// completions are pushed in reverse order
+	item = atomic_exchange(&platform->work_done, NULL);
+	while (item != NULL) {
+		next = item->next;
+		item->next = completed;
+		completed = item;
+		item = next;
+	}
+
+	while (completed != NULL) {
+		item = completed;
+		completed = completed->next;
+		if (item->done != NULL)
+			item->done(node, item->data);
+		cc_platform_mem_free(item);
+	}
+}
+
+static cc_result_t cc_platform_x86_work_handler(cc_node_t *node, int fd, uint32_t events, void *data)
+{
+	char buffer[64];
+
+	// drained before taking the completions, a later push wakes again
+	while (read(fd, buffer, sizeof(buffer)) > 0)
+		;
+
+	cc_platform_x86_work_complete(node, (cc_platform_x86_t *)node->platform);
+
+	return CC_SUCCESS;
+}
+
+cc_result_t cc_platform_submit_work(cc_node_t *node, void (*work)(void *data), void (*done)(cc_node_t *node, void *data), void *data)
+{
+	cc_platform_x86_t *platform = (cc_platform_x86_t *)node->platform;
+	cc_platform_x86_work_t *item = NULL;
+
+	if (platform == NULL || platform->nbr_of_workers == 0)
+		return CC_FAIL;
+
+	if (cc_platform_mem_alloc((void **)&item, sizeof(cc_platform_x86_work_t)) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return CC_FAIL;
+	}
+
+	item->work = work;
+	item->done = done;
+	item->data = data;
+	item->next = NULL;
+
+	pthread_mutex_lock(&platform->work_lock);
+	if (platform->work_last != NULL)
+		platform->work_last->next = item;
+	else
+		platform->work_first = item;
+	platform->work_last = item;
+	pthread_cond_signal(&platform->work_cond);
+	pthread_mutex_unlock(&platform->work_lock);
+
+	return CC_SUCCESS;
+}
+
+static cc_result_t cc_platform_x86_workers_start(cc_node_t *node, cc_platform_x86_t *platform)
+{
+	int i = 0;
+
+	if (pipe(platform->work_pipe) < 0) {
+		cc_log_error("Failed to create pipe");
+		return CC_FAIL;
+	}
+
+	for (i = 0; i < 2; i++) {
+		fcntl(platform->work_pipe[i], F_SETFL, fcntl(platform->work_pipe[i], F_GETFL, 0) | O_NONBLOCK);
+		fcntl(platform->work_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	if (cc_platform_add_event_source(node, platform->work_pipe[0], CC_PLATFORM_EVENT_READ, cc_platform_x86_work_handler, NULL) != CC_SUCCESS) {
+		close(platform->work_pipe[0]);
+		close(platform->work_pipe[1]);
+		return CC_FAIL;
+	}
+
+	pthread_mutex_init(&platform->work_lock, NULL);
+	pthread_cond_init(&platform->work_cond, NULL);
+	atomic_init(&platform->work_done, NULL);
+
+	for (i = 0; i < CC_WORKER_THREADS; i++) {
+		if (pthread_create(&platform->workers[i], NULL, cc_platform_x86_worker, platform) != 0) {
+			cc_log_error("Failed to start worker");
+			break;
+		}
+		platform->nbr_of_workers++;
+	}
+
+	if (platform->nbr_of_workers == 0) {
+		cc_platform_remove_event_source(node, platform->work_pipe[0]);
+		close(platform->work_pipe[0]);
+		close(platform->work_pipe[1]);
+		pthread_mutex_destroy(&platform->work_lock);
+		pthread_cond_destroy(&platform->work_cond);
+		return CC_FAIL;
+	}
+
+	return CC_SUCCESS;
+}
+
+static void cc_platform_x86_workers_stop(cc_node_t *node, cc_platform_x86_t *platform)
+{
+	int i = 0;
+
+	pthread_mutex_lock(&platform->work_lock);
+	platform->work_stop = true;
+	pthread_cond_broadcast(&platform->work_cond);
+	pthread_mutex_unlock(&platform->work_lock);
+
+	for (i = 0; i < platform->nbr_of_workers; i++)
+		pthread_join(platform->workers[i], NULL);
+	platform->nbr_of_workers = 0;
+
+	cc_platform_x86_work_complete(node, platform);
+
+	cc_platform_remove_event_source(node, platform->work_pipe[0]);
+	close(platform->work_pipe[0]);
+	close(platform->work_pipe[1]);
+	pthread_mutex_destroy(&platform->work_lock);
+	pthread_cond_destroy(&platform->work_cond);
+}
+#endif
+
 cc_result_t cc_platform_late_init(cc_node_t *node, const char *args)
 {
 	cc_result_t result = CC_SUCCESS;
+	cc_platform_x86_t *platform = NULL;
+#if CC_PLATFORM_X86_EPOLL
+	struct epoll_event event;
+#endif
+
+	if (cc_platform_mem_alloc((void **)&platform, sizeof(cc_platform_x86_t)) != CC_SUCCESS) {
+		cc_log_error("Failed to allocate memory");
+		return CC_FAIL;
+	}
+	memset(platform, 0, sizeof(cc_platform_x86_t));
+	platform->transport_fd = -1;
+
+#if CC_PLATFORM_X86_EPOLL
+	platform->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	platform->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (platform->epoll_fd < 0 || platform->timer_fd < 0) {
+		cc_log_error("Failed to create epoll instance");
+		if (platform->epoll_fd >= 0)
+			close(platform->epoll_fd);
+		if (platform->timer_fd >= 0)
+			close(platform->timer_fd);
+		cc_platform_mem_free(platform);
+		return CC_FAIL;
+	}
+
+	// the timer is the only registration without an entry
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if (epoll_ctl(platform->epoll_fd, EPOLL_CTL_ADD, platform->timer_fd, &event) < 0) {
+		cc_log_error("Failed to register timer");
+		close(platform->epoll_fd);
+		close(platform->timer_fd);
+		cc_platform_mem_free(platform);
+		return CC_FAIL;
+	}
+#endif
+
+	node->platform = platform;
+
+#if CC_USE_WORKERS
+	if (cc_platform_x86_workers_start(node, platform) != CC_SUCCESS) {
+		cc_log_error("Failed to start workers");
+		cc_platform_stop(node);
+		return CC_FAIL;
+	}
+#endif
 
 #ifdef CC_USE_LIBCOAP_CLIENT
 	if (args != NULL)
@@ -66,6 +557,31 @@ cc_result_t cc_platform_late_init(cc_node_t *node, const char *args)
 
 cc_result_t cc_platform_stop(cc_node_t *node)
 {
+	cc_platform_x86_t *platform = (cc_platform_x86_t *)node->platform;
+	cc_platform_x86_fd_t *entry = NULL;
+
+	if (platform == NULL)
+		return CC_SUCCESS;
+
+#if CC_USE_WORKERS
+	if (platform->nbr_of_workers > 0)
+		cc_platform_x86_workers_stop(node, platform);
+#endif
+
+	while (platform->fds != NULL) {
+		entry = platform->fds;
+		platform->fds = entry->next;
+		cc_platform_mem_free(entry);
+	}
+
+#if CC_PLATFORM_X86_EPOLL
+	close(platform->epoll_fd);
+	close(platform->timer_fd);
+#endif
+
+	cc_platform_mem_free(platform);
+	node->platform = NULL;
+
 	return CC_SUCCESS;
 }
 
@@ -74,58 +590,160 @@ cc_result_t cc_platform_node_started(struct cc_node_t *node)
 	return CC_SUCCESS;
 }
 
-cc_platform_evt_wait_status_t cc_platform_evt_wait(cc_node_t *node, uint32_t timeout_seconds)
+#if CC_PLATFORM_X86_EPOLL
+static cc_platform_evt_wait_status_t cc_platform_x86_wait(cc_node_t *node, cc_platform_x86_t *platform, uint32_t timeout_ms)
 {
-	int transport_fd = 0, res = 0, max_fd = -1, i = 0;
-	struct timeval tv, *tv_ref = NULL;
-	cc_calvinsys_t *sys = node->calvinsys;
+	struct epoll_event events[CC_PLATFORM_X86_MAX_EVENTS];
+	struct itimerspec spec;
+	cc_platform_x86_fd_t *entry = NULL;
+	uint64_t deadline = 0, expirations = 0;
+	uint32_t ready = 0;
+	bool data_read = false, failed = false;
+	int n = 0, i = 0;
+
+	// the timer holds an absolute deadline and is only rearmed when it moves
+	if (timeout_ms > 0)
+		deadline = cc_platform_get_time_ms() + timeout_ms;
+
+	if (deadline != platform->timer_deadline) {
+		memset(&spec, 0, sizeof(spec));
+		spec.it_value.tv_sec = deadline / 1000;
+		spec.it_value.tv_nsec = (deadline % 1000) * 1000000;
+		if (timerfd_settime(platform->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+			cc_log_error("Failed to set timer");
+			return CC_PLATFORM_EVT_WAIT_FAIL;
+		}
+		platform->timer_deadline = deadline;
+	}
 
-	if (timeout_seconds > 0) {
-		tv.tv_sec = timeout_seconds;
-		tv.tv_usec = 0;
-		tv_ref = &tv;
+	n = epoll_wait(platform->epoll_fd, events, CC_PLATFORM_X86_MAX_EVENTS, -1);
+	if (n < 0) {
+		if (errno == EINTR)
+			return CC_PLATFORM_EVT_WAIT_DATA_READ;
+		cc_log_error("epoll_wait failed");
+		return CC_PLATFORM_EVT_WAIT_FAIL;
 	}
 
-	FD_ZERO(&node->fds);
+	platform->dispatching = true;
+	for (i = 0; i < n; i++) {
+		entry = (cc_platform_x86_fd_t *)events[i].data.ptr;
+		if (entry == NULL) {
+			if (read(platform->timer_fd, &expirations, sizeof(expirations)) > 0)
+				platform->timer_deadline = 0;
+			continue;
+		}
 
-	if (node->transport_client != NULL && (node->transport_client->state == CC_TRANSPORT_PENDING || node->transport_client->state == CC_TRANSPORT_ENABLED)) {
-		transport_fd = ((cc_transport_socket_client_t *)node->transport_client->client_state)->fd;
-		max_fd = transport_fd;
-		FD_SET(transport_fd, &node->fds);
+		// removed by an earlier handler
+		if (entry->fd < 0)
+			continue;
+
+		ready = 0;
+		if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+			ready |= CC_PLATFORM_EVENT_READ;
+		if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+			ready |= CC_PLATFORM_EVENT_WRITE;
+		ready &= entry->events;
+		if (ready == 0)
+			continue;
+
+		if (entry->handler(node, entry->fd, ready, entry->data) != CC_SUCCESS)
+			failed = true;
+		data_read = true;
 	}
+	platform->dispatching = false;
+	cc_platform_x86_fd_cleanup(platform);
 
-	for (i = 0; i < CC_CALVINSYS_MAX_FDS; i++) {
-		if (sys->fds[i] != -1) {
-			FD_SET(sys->fds[i], &node->fds);
-			if (sys->fds[i] > max_fd)
-				max_fd = sys->fds[i];
-		}
+	if (failed)
+		return CC_PLATFORM_EVT_WAIT_FAIL;
+
+	if (!data_read) {
+		cc_log_debug("Timeout waiting for data");
+		return CC_PLATFORM_EVT_WAIT_TIMEOUT;
 	}
 
-	if (max_fd >= 0) {
-		res = select(max_fd + 1, &node->fds, NULL, NULL, tv_ref);
-		if (res < 0) {
-			cc_log_error("select failed");
-			return CC_PLATFORM_EVT_WAIT_FAIL;
-		} else if (res == 0)
-			cc_log_debug("Timeout waiting for data");
-		else {
-			if (FD_ISSET(transport_fd, &node->fds)) {
-				if (cc_transport_handle_data(node, node->transport_client, cc_node_handle_message) != CC_SUCCESS) {
-					cc_log_error("Failed to handle received data");
-					return CC_PLATFORM_EVT_WAIT_FAIL;
-				}
-			}
+	return CC_PLATFORM_EVT_WAIT_DATA_READ;
+}
+#else
+static cc_platform_evt_wait_status_t cc_platform_x86_wait(cc_node_t *node, cc_platform_x86_t *platform, uint32_t timeout_ms)
+{
+	struct timeval tv, *tv_ref = NULL;
+	fd_set read_fds, write_fds;
+	cc_platform_x86_fd_t *entry = NULL;
+	uint32_t ready = 0;
+	bool failed = false;
+	int max_fd = -1, res = 0;
+
+	if (timeout_ms > 0) {
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
+		tv_ref = &tv;
+	}
+
+	FD_ZERO(&read_fds);
+	FD_ZERO(&write_fds);
+
+	for (entry = platform->fds; entry != NULL; entry = entry->next) {
+		if (entry->events & CC_PLATFORM_EVENT_READ)
+			FD_SET(entry->fd, &read_fds);
+		if (entry->events & CC_PLATFORM_EVENT_WRITE)
+			FD_SET(entry->fd, &write_fds);
+		if (entry->events != 0 && entry->fd > max_fd)
+			max_fd = entry->fd;
+	}
+
+	res = select(max_fd + 1, &read_fds, &write_fds, NULL, tv_ref);
+	if (res < 0) {
+		if (errno == EINTR)
 			return CC_PLATFORM_EVT_WAIT_DATA_READ;
-		}
-	} else
-		select(0, NULL, NULL, NULL, tv_ref);
+		cc_log_error("select failed");
+		return CC_PLATFORM_EVT_WAIT_FAIL;
+	} else if (res == 0) {
+		cc_log_debug("Timeout waiting for data");
+		return CC_PLATFORM_EVT_WAIT_TIMEOUT;
+	}
+
+	// entries added by handlers are put first and not visited
+	platform->dispatching = true;
+	for (entry = platform->fds; entry != NULL; entry = entry->next) {
+		if (entry->fd < 0)
+			continue;
+
+		ready = 0;
+		if (FD_ISSET(entry->fd, &read_fds))
+			ready |= CC_PLATFORM_EVENT_READ;
+		if (FD_ISSET(entry->fd, &write_fds))
+			ready |= CC_PLATFORM_EVENT_WRITE;
+		ready &= entry->events;
+		if (ready != 0 && entry->handler(node, entry->fd, ready, entry->data) != CC_SUCCESS)
+			failed = true;
+	}
+	platform->dispatching = false;
+	cc_platform_x86_fd_cleanup(platform);
 
-	return CC_PLATFORM_EVT_WAIT_TIMEOUT;
+	if (failed)
+		return CC_PLATFORM_EVT_WAIT_FAIL;
+
+	return CC_PLATFORM_EVT_WAIT_DATA_READ;
+}
+#endif
+
+cc_platform_evt_wait_status_t cc_platform_evt_wait(cc_node_t *node, uint32_t timeout_ms)
+{
+	cc_platform_x86_t *platform = (cc_platform_x86_t *)node->platform;
+
+	if (platform == NULL || cc_platform_x86_sync(node, platform) != CC_SUCCESS)
+		return CC_PLATFORM_EVT_WAIT_FAIL;
+
+	return cc_platform_x86_wait(node, platform, timeout_ms);
 }
 
 cc_result_t cc_platform_mem_alloc(void **buffer, uint32_t size)
 {
+#if CC_USE_SLAB
+	if (cc_slab_alloc(buffer, size) == CC_SUCCESS)
+		return CC_SUCCESS;
+#endif
+
 	*buffer = malloc(size);
 	if (*buffer == NULL) {
 		cc_log_error("Failed to allocate '%ld' memory", (unsigned long)size);
@@ -148,16 +766,21 @@ void *cc_platform_mem_calloc(size_t nitems, size_t size)
 
 void cc_platform_mem_free(void *buffer)
 {
+#if CC_USE_SLAB
+	if (cc_slab_free(buffer))
+		return;
+#endif
+
 	free(buffer);
 }
 
-uint32_t cc_platform_get_time(void)
+uint64_t cc_platform_get_time_ms(void)
 {
-	struct timeval value;
+	struct timespec value;
 
-	gettimeofday(&value, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &value);
 
-	return value.tv_sec;
+	return (uint64_t)value.tv_sec * 1000 + value.tv_nsec / 1000000;
 }
 
 #if CC_USE_SLEEP
@@ -214,6 +837,43 @@ cc_result_t cc_platform_file_read(const char *path, char **buffer, size_t *len)
 	return CC_SUCCESS;
 }
 
+// Maps the file private and writable, decoding never changes the file and the
+// mapping is kept if the file is replaced
+cc_result_t cc_platform_file_map(const char *path, char **buffer, size_t *len)
+{
+	struct stat statbuf;
+	void *addr = NULL;
+	int fd = -1;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		cc_log_error("Failed to open '%s'", path);
+		return CC_FAIL;
+	}
+
+	if (fstat(fd, &statbuf) != 0 || statbuf.st_size == 0) {
+		close(fd);
+		return CC_FAIL;
+	}
+
+	addr = mmap(NULL, statbuf.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		cc_log_error("Failed to map '%s'", path);
+		return CC_FAIL;
+	}
+
+	*buffer = (char *)addr;
+	*len = statbuf.st_size;
+
+	return CC_SUCCESS;
+}
+
+void cc_platform_file_unmap(char *buffer, size_t len)
+{
+	munmap(buffer, len);
+}
+
 static cc_result_t cc_platform_create_dirs(const char *path)
 {
 	int i = 1, len = strlen(path);
@@ -241,30 +901,96 @@ static cc_result_t cc_platform_create_dirs(const char *path)
 	return CC_SUCCESS;
 }
 
+// Syncs the directory holding path so a rename in it is durable
+static cc_result_t cc_platform_x86_sync_dir(const char *path)
+{
+	char dir[strlen(path) + 2];
+	char *slash = NULL;
+	int fd = -1, res = 0;
+
+	strcpy(dir, path);
+	slash = strrchr(dir, '/');
+	if (slash == NULL)
+		strcpy(dir, ".");
+	else if (slash == dir)
+		dir[1] = '\0';
+	else
+		*slash = '\0';
+
+	fd = open(dir, O_RDONLY);
+	if (fd < 0)
+		return CC_FAIL;
+	res = fsync(fd);
+	close(fd);
+
+	return res == 0 ? CC_SUCCESS : CC_FAIL;
+}
+
+// Writes to a temporary file that is synced and renamed over path, a crash
+// leaves either the previous or the new content
 cc_result_t cc_platform_file_write(const char *path, char *buffer, size_t size)
 {
+	char tmp_path[strlen(path) + sizeof(".tmp")];
 	FILE *fp = NULL;
-	int len = 0;
+	size_t len = 0;
+	cc_result_t result = CC_SUCCESS;
 
 	if (cc_platform_create_dirs(path) != CC_SUCCESS)
 		return CC_FAIL;
 
-	fp = fopen(path, "w+");
+	strcpy(tmp_path, path);
+	strcat(tmp_path, ".tmp");
+
+	fp = fopen(tmp_path, "w");
 	if (fp == NULL)
 		return CC_FAIL;
 
 	len = fwrite(buffer, 1, size, fp);
-	if (len != size) {
-		cc_log_error("Failed to write node config");
-		fclose(fp);
+	if (len != size || fflush(fp) != 0 || fsync(fileno(fp)) != 0)
+		result = CC_FAIL;
+	if (fclose(fp) != 0)
+		result = CC_FAIL;
+
+	if (result == CC_SUCCESS && rename(tmp_path, path) != 0)
+		result = CC_FAIL;
+
+	if (result != CC_SUCCESS) {
+		cc_log_error("Failed to write '%s'", path);
+		unlink(tmp_path);
 		return CC_FAIL;
 	}
 
-	fclose(fp);
+	if (cc_platform_x86_sync_dir(path) != CC_SUCCESS)
+		cc_log_error("Failed to sync directory of '%s'", path);
 
 	return CC_SUCCESS;
 }
 
+cc_result_t cc_platform_file_append(const char *path, char *buffer, size_t size)
+{
+	FILE *fp = NULL;
+	size_t len = 0;
+	cc_result_t result = CC_SUCCESS;
+
+	if (cc_platform_create_dirs(path) != CC_SUCCESS)
+		return CC_FAIL;
+
+	fp = fopen(path, "a");
+	if (fp == NULL)
+		return CC_FAIL;
+
+	len = fwrite(buffer, 1, size, fp);
+	if (len != size || fflush(fp) != 0 || fsync(fileno(fp)) != 0)
+		result = CC_FAIL;
+	if (fclose(fp) != 0)
+		result = CC_FAIL;
+
+	if (result != CC_SUCCESS)
+		cc_log_error("Failed to append to '%s'", path);
+
+	return result;
+}
+
 cc_result_t cc_platform_file_del(const char *path)
 {
 	if (unlink(path) < 0)
@@ -18,6 +18,9 @@
 #include <arpa/inet.h>
 #include <strings.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
 #ifdef CC_PLATFORM_ANDROID
 #include <sys/socket.h>
 #endif
@@ -241,6 +244,19 @@ static int cc_transport_socket_send(cc_transport_client_t *transport_client, cha
 	return write(((cc_transport_socket_client_t *)transport_client->client_state)->fd, data, size);
 }
 
+static int cc_transport_socket_sendv(cc_transport_client_t *transport_client, const cc_transport_iovec_t *iov, int iovcnt)
+{
+	struct iovec vec[CC_TRANSPORT_MAX_IOVEC];
+	int i = 0;
+
+	for (i = 0; i < iovcnt; i++) {
+		vec[i].iov_base = iov[i].base;
+		vec[i].iov_len = iov[i].len;
+	}
+
+	return writev(((cc_transport_socket_client_t *)transport_client->client_state)->fd, vec, iovcnt);
+}
+
 static int cc_transport_socket_recv(cc_transport_client_t *transport_client, char *buffer, size_t size)
 {
 	return read(((cc_transport_socket_client_t *)transport_client->client_state)->fd, buffer, size);
@@ -248,8 +264,12 @@ static int cc_transport_socket_recv(cc_transport_client_t *transport_client, cha
 
 static void cc_transport_socket_disconnect(cc_node_t *node, cc_transport_client_t *transport_client)
 {
-	if (transport_client->state != CC_TRANSPORT_DISCONNECTED)
-		close(((cc_transport_socket_client_t *)transport_client)->fd);
+	cc_transport_socket_client_t *transport_socket = (cc_transport_socket_client_t *)transport_client->client_state;
+
+	if (transport_socket->fd >= 0) {
+		close(transport_socket->fd);
+		transport_socket->fd = -1;
+	}
 }
 
 static void cc_transport_socket_free(cc_transport_client_t *transport_client)
@@ -261,6 +281,7 @@ static void cc_transport_socket_free(cc_transport_client_t *transport_client)
 
 static cc_result_t cc_transport_socket_connect(cc_node_t *node, cc_transport_client_t *transport_client)
 {
+	static uint32_t generation;
 	cc_transport_socket_client_t *transport_socket = (cc_transport_socket_client_t *)transport_client->client_state;
 	struct sockaddr_in server;
 
@@ -269,21 +290,58 @@ static cc_result_t cc_transport_socket_connect(cc_node_t *node, cc_transport_cli
 		cc_log_error("Failed to create socket");
 		return CC_FAIL;
 	}
+#if CC_USE_NODE_THREADS
+	transport_socket->generation = __sync_add_and_fetch(&generation, 1);
+#else
+	transport_socket->generation = ++generation;
+#endif
 
 	server.sin_addr.s_addr = inet_addr(transport_socket->ip);
 	server.sin_port = htons(transport_socket->port);
 	server.sin_family = AF_INET;
 
-	if (connect(transport_socket->fd, (struct sockaddr *)&server, sizeof(server)) < 0) {
+	// connect without blocking the node, the platform completes it with
+	// cc_transport_socket_connect_done() when the socket is writable
+	if (fcntl(transport_socket->fd, F_SETFL, fcntl(transport_socket->fd, F_GETFL, 0) | O_NONBLOCK) < 0) {
+		cc_log_error("Failed to set socket non-blocking");
+		cc_transport_socket_disconnect(node, transport_client);
+		return CC_FAIL;
+	}
+
+	if (connect(transport_socket->fd, (struct sockaddr *)&server, sizeof(server)) == 0) {
+		cc_transport_socket_connect_done(transport_client);
+		return CC_SUCCESS;
+	}
+
+	if (errno != EINPROGRESS) {
 		cc_log_error("Failed to connect socket");
+		cc_transport_socket_disconnect(node, transport_client);
 		return CC_FAIL;
 	}
 
-	transport_client->state = CC_TRANSPORT_CONNECTED;
+	transport_client->state = CC_TRANSPORT_CONNECTING;
 
 	return CC_SUCCESS;
 }
 
+void cc_transport_socket_connect_done(cc_transport_client_t *transport_client)
+{
+	cc_transport_socket_client_t *transport_socket = (cc_transport_socket_client_t *)transport_client->client_state;
+	int error = 0;
+	socklen_t len = sizeof(error);
+
+	if (getsockopt(transport_socket->fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+		cc_log_error("Failed to connect socket");
+		cc_transport_socket_disconnect(NULL, transport_client);
+		transport_client->state = CC_TRANSPORT_DISCONNECTED;
+		return;
+	}
+
+	// the connection is used with blocking reads and writes
+	fcntl(transport_socket->fd, F_SETFL, fcntl(transport_socket->fd, F_GETFL, 0) & ~O_NONBLOCK);
+	transport_client->state = CC_TRANSPORT_CONNECTED;
+}
+
 static cc_result_t cc_transport_socket_parse_uri(char *uri, char **ip, size_t *ip_len, int *port)
 {
 	size_t pos = strlen(uri);
@@ -352,6 +410,7 @@ cc_transport_client_t *cc_transport_socket_create(cc_node_t *node, char *uri)
 	transport_client->rx_buffer.size = 0;
 	transport_client->connect = cc_transport_socket_connect;
 	transport_client->send = cc_transport_socket_send;
+	transport_client->sendv = cc_transport_socket_sendv;
 	transport_client->recv = cc_transport_socket_recv;
 	transport_client->disconnect = cc_transport_socket_disconnect;
 	transport_client->free = cc_transport_socket_free;
@@ -359,6 +418,8 @@ cc_transport_client_t *cc_transport_socket_create(cc_node_t *node, char *uri)
 	strncpy(transport_socket->ip, ip, ip_len);
 	transport_socket->ip[ip_len] = '\0';
 	transport_socket->port = port;
+	transport_socket->fd = -1;
+	transport_socket->generation = 0;
 	sprintf(transport_client->uri, "calvinip://%s:%d", transport_socket->ip, transport_socket->port);
 	transport_client->client_state = transport_socket;
 
@@ -16,10 +16,15 @@
 #ifndef CC_TRANSPORT_SOCKET_H
 #define CC_TRANSPORT_SOCKET_H
 
+#include "runtime/north/cc_transport.h"
+
 typedef struct cc_transport_socket_client_t {
 	int fd;
+	uint32_t generation; // changes for each new socket, descriptor numbers are reused
 	char ip[40];
 	int port;
 } cc_transport_socket_client_t;
 
+void cc_transport_socket_connect_done(cc_transport_client_t *transport_client);
+
 #endif /* CC_TRANSPORT_SOCKET_H */
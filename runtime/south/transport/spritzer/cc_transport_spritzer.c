@@ -68,7 +68,7 @@ static void cc_transport_spritzer_disconnect(cc_node_t *node, cc_transport_clien
 	}
 
 	if (transport_client->rx_buffer.buffer != NULL) {
-		cc_platform_mem_free((void *)transport_client->rx_buffer.buffer);
+		cc_transport_rx_buffer_unref(transport_client->rx_buffer.buffer);
     transport_client->rx_buffer.buffer = NULL;
   }
 	transport_client->rx_buffer.pos = 0;
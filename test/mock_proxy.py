@@ -0,0 +1,512 @@
+# -*- coding: utf-8 -*-
+
+# Copyright (c) 2016 Ericsson AB
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+""" Stand-in for the proxy runtime, benchmarks token throughput and latency
+of calvin_c without any Calvin base runtimes.
+
+The mock answers JOIN_REQUEST, TUNNEL_NEW, CONFIG, PORT_CONNECT and the
+storage requests of the node, deploys a std.Identity actor on it with
+ACTOR_NEW and sends TOKENs to its inport. The tokens coming back from the
+outport give the round trip latency.
+
+    python3 test/mock_proxy.py --runtime ./calvin_c --size 64 --rate 1000
+"""
+
+import argparse
+import json
+import os
+import select
+import shutil
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+import uuid
+
+
+def pack(obj):
+    if obj is None:
+        return b'\xc0'
+    if obj is True:
+        return b'\xc3'
+    if obj is False:
+        return b'\xc2'
+    if isinstance(obj, int):
+        if 0 <= obj < 0x80:
+            return struct.pack('B', obj)
+        if -32 <= obj < 0:
+            return struct.pack('b', obj)
+        if 0 <= obj <= 0xff:
+            return struct.pack('>BB', 0xcc, obj)
+        if 0 <= obj <= 0xffff:
+            return struct.pack('>BH', 0xcd, obj)
+        if 0 <= obj <= 0xffffffff:
+            return struct.pack('>BI', 0xce, obj)
+        if obj >= 0:
+            return struct.pack('>BQ', 0xcf, obj)
+        return struct.pack('>Bq', 0xd3, obj)
+    if isinstance(obj, float):
+        return struct.pack('>Bd', 0xcb, obj)
+    if isinstance(obj, str):
+        data = obj.encode('utf-8')
+        n = len(data)
+        if n < 32:
+            return struct.pack('B', 0xa0 | n) + data
+        if n <= 0xff:
+            return struct.pack('>BB', 0xd9, n) + data
+        if n <= 0xffff:
+            return struct.pack('>BH', 0xda, n) + data
+        return struct.pack('>BI', 0xdb, n) + data
+    if isinstance(obj, (bytes, bytearray)):
+        n = len(obj)
+        if n <= 0xff:
+            return struct.pack('>BB', 0xc4, n) + bytes(obj)
+        if n <= 0xffff:
+            return struct.pack('>BH', 0xc5, n) + bytes(obj)
+        return struct.pack('>BI', 0xc6, n) + bytes(obj)
+    if isinstance(obj, (list, tuple)):
+        n = len(obj)
+        if n < 16:
+            head = struct.pack('B', 0x90 | n)
+        elif n <= 0xffff:
+            head = struct.pack('>BH', 0xdc, n)
+        else:
+            head = struct.pack('>BI', 0xdd, n)
+        return head + b''.join(pack(item) for item in obj)
+    if isinstance(obj, dict):
+        n = len(obj)
+        if n < 16:
+            head = struct.pack('B', 0x80 | n)
+        elif n <= 0xffff:
+            head = struct.pack('>BH', 0xde, n)
+        else:
+            head = struct.pack('>BI', 0xdf, n)
+        return head + b''.join(pack(k) + pack(v) for k, v in obj.items())
+    raise TypeError("Can't pack %r" % (obj,))
+
+
+_FIXED = {
+    0xcc: '>B', 0xcd: '>H', 0xce: '>I', 0xcf: '>Q',
+    0xd0: '>b', 0xd1: '>h', 0xd2: '>i', 0xd3: '>q',
+    0xca: '>f', 0xcb: '>d'
+}
+
+
+def unpack(buf, pos=0):
+    """ Returns the value at pos and the position after it """
+    b = buf[pos]
+    pos += 1
+    if b < 0x80:
+        return b, pos
+    if b >= 0xe0:
+        return b - 0x100, pos
+    if 0x80 <= b <= 0x8f:
+        return _unpack_map(buf, pos, b & 0x0f)
+    if 0x90 <= b <= 0x9f:
+        return _unpack_array(buf, pos, b & 0x0f)
+    if 0xa0 <= b <= 0xbf:
+        n = b & 0x1f
+        return buf[pos:pos + n].decode('utf-8', 'replace'), pos + n
+    if b == 0xc0:
+        return None, pos
+    if b == 0xc2:
+        return False, pos
+    if b == 0xc3:
+        return True, pos
+    if b in _FIXED:
+        fmt = _FIXED[b]
+        return struct.unpack_from(fmt, buf, pos)[0], pos + struct.calcsize(fmt)
+    if b in (0xc4, 0xc5, 0xc6, 0xd9, 0xda, 0xdb):
+        fmt = {0xc4: '>B', 0xc5: '>H', 0xc6: '>I', 0xd9: '>B', 0xda: '>H', 0xdb: '>I'}[b]
+        n = struct.unpack_from(fmt, buf, pos)[0]
+        pos += struct.calcsize(fmt)
+        data = bytes(buf[pos:pos + n])
+        if b >= 0xd9:
+            data = data.decode('utf-8', 'replace')
+        return data, pos + n
+    if b in (0xdc, 0xdd):
+        fmt = '>H' if b == 0xdc else '>I'
+        n = struct.unpack_from(fmt, buf, pos)[0]
+        return _unpack_array(buf, pos + struct.calcsize(fmt), n)
+    if b in (0xde, 0xdf):
+        fmt = '>H' if b == 0xde else '>I'
+        n = struct.unpack_from(fmt, buf, pos)[0]
+        return _unpack_map(buf, pos + struct.calcsize(fmt), n)
+    raise ValueError("Unsupported msgpack type 0x%02x" % b)
+
+
+def _unpack_array(buf, pos, n):
+    items = []
+    for _ in range(n):
+        item, pos = unpack(buf, pos)
+        items.append(item)
+    return items, pos
+
+
+def _unpack_map(buf, pos, n):
+    items = {}
+    for _ in range(n):
+        key, pos = unpack(buf, pos)
+        value, pos = unpack(buf, pos)
+        items[key] = value
+    return items, pos
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))]
+
+
+def proc_stats(pid):
+    """ read/write syscalls and resident memory (kB) of the process """
+    stats = {}
+    try:
+        with open('/proc/%d/io' % pid) as f:
+            for line in f:
+                key, value = line.split(':')
+                stats[key] = int(value)
+        with open('/proc/%d/status' % pid) as f:
+            for line in f:
+                if line.startswith(('VmRSS', 'VmHWM')):
+                    key, value = line.split(':')
+                    stats[key] = int(value.split()[0])
+    except (IOError, OSError, ValueError):
+        pass
+    return stats
+
+
+class MockProxy(object):
+
+    def __init__(self, args):
+        self.args = args
+        self.id = str(uuid.uuid4())
+        self.node_id = None
+        self.sock = None
+        self.rx = b''
+        self.tunnels = {}
+        self.token_tunnel = None
+        self.actor_id = str(uuid.uuid4())
+        self.inport_id = str(uuid.uuid4())
+        self.outport_id = str(uuid.uuid4())
+        self.src_port_id = str(uuid.uuid4())   # connected to the actor inport
+        self.sink_port_id = str(uuid.uuid4())  # connected to the actor outport
+        self.connected = set()
+        self.deployed = False
+        self.padding = b'\0' * max(0, args.size - 8)
+        # tokens to the node, go-back-n on NACK
+        self.next_seq = 0
+        self.acked = 0
+        self.payloads = {}
+        self.next_token = 0
+        self.sent_at = {}
+        self.latencies = []
+        self.received = 0
+        self.measuring = False
+        self.expected = 0
+        self.out_of_order = 0
+        self.dropped = False
+
+    def log(self, msg):
+        if self.args.verbose:
+            sys.stderr.write("mock_proxy: %s\n" % msg)
+
+    def send_frame(self, data):
+        self.sock.sendall(struct.pack('>I', len(data)) + data)
+
+    def send(self, msg):
+        self.send_frame(pack(msg))
+
+    def recv_frames(self, timeout):
+        frames = []
+        ready, _, _ = select.select([self.sock], [], [], max(0, timeout))
+        if not ready:
+            return frames
+        data = self.sock.recv(1 << 16)
+        if not data:
+            raise EOFError("Node disconnected")
+        self.rx += data
+        while len(self.rx) >= 4:
+            size = struct.unpack_from('>I', self.rx)[0]
+            if len(self.rx) < 4 + size:
+                break
+            frames.append(self.rx[4:4 + size])
+            self.rx = self.rx[4 + size:]
+        return frames
+
+    def reply(self, msg, value):
+        self.send({'cmd': 'REPLY', 'msg_uuid': msg['msg_uuid'], 'to_rt_uuid': self.node_id,
+                   'from_rt_uuid': self.id, 'value': value})
+
+    def tunnel_data(self, tunnel_id, value):
+        self.send({'cmd': 'TUNNEL_DATA', 'to_rt_uuid': self.node_id, 'from_rt_uuid': self.id,
+                   'tunnel_id': tunnel_id, 'value': value})
+
+    def handle_join(self, frame):
+        request = json.loads(frame.decode('utf-8'))
+        self.node_id = request['id']
+        self.log("Join from '%s'" % self.node_id)
+        reply = {'cmd': 'JOIN_REPLY', 'id': self.id, 'sid': request.get('sid'),
+                 'serializer': 'msgpack', 'token_batch': self.args.batch, 'token_chunk': 0}
+        self.send_frame(json.dumps(reply).encode('utf-8'))
+
+    def handle(self, msg):
+        cmd = msg.get('cmd')
+        if cmd == 'TUNNEL_NEW':
+            self.tunnels[msg['tunnel_id']] = msg['type']
+            if msg['type'] == 'token':
+                self.token_tunnel = msg['tunnel_id']
+            self.log("Tunnel '%s' of type '%s'" % (msg['tunnel_id'], msg['type']))
+            self.reply(msg, {'status': 200, 'data': {'tunnel_id': msg['tunnel_id']}})
+        elif cmd == 'PORT_CONNECT':
+            self.connected.add(msg['peer_port_id'])
+            self.log("Port '%s' connected to '%s'" % (msg['port_id'], msg['peer_port_id']))
+            self.reply(msg, {'status': 200, 'data': {'port_id': msg['peer_port_id']}})
+        elif cmd in ('PORT_DISCONNECT', 'TUNNEL_DESTROY'):
+            self.reply(msg, {'status': 200, 'data': None})
+        elif cmd == 'REPLY':
+            if msg.get('value', {}).get('status') not in (None, 200):
+                sys.stderr.write("mock_proxy: Request failed %r\n" % (msg['value'],))
+        elif cmd == 'TUNNEL_DATA':
+            self.handle_tunnel_data(msg)
+        else:
+            self.log("Unhandled '%s'" % cmd)
+
+    def handle_tunnel_data(self, msg):
+        value = msg['value']
+        cmd = value.get('cmd')
+        if cmd == 'TOKEN':
+            self.token_received(value['token'].get('data'))
+            self.token_reply(msg, value['sequencenbr'], None)
+        elif cmd == 'TOKEN_BATCH':
+            for token in value['tokens']:
+                self.token_received(token.get('data'))
+            self.token_reply(msg, value['sequencenbr'], value['sequencenbr'] + len(value['tokens']) - 1)
+        elif cmd == 'TOKEN_REPLY':
+            self.token_acked(value)
+        elif cmd == 'CONFIG' or cmd == 'WAKEUP':
+            self.tunnel_data(msg['tunnel_id'], {'cmd': 'REPLY', 'msg_uuid': value['msg_uuid'],
+                                                'value': {'status': 200, 'data': {'time': time.time()}}})
+            if not self.deployed:
+                self.deploy()
+        elif 'msg_uuid' in value:
+            # storage requests, ports on the mock are found on the mock
+            reply = {'cmd': 'REPLY', 'msg_uuid': value['msg_uuid'], 'key': value.get('key'),
+                     'value': None, 'response': {'status': 200}}
+            if cmd == 'GET' and value.get('key') in ('port-' + self.src_port_id, 'port-' + self.sink_port_id):
+                reply['value'] = {'node_id': self.id}
+            self.tunnel_data(msg['tunnel_id'], reply)
+        else:
+            self.log("Unhandled tunnel cmd '%s'" % cmd)
+
+    def port(self, port_id, direction):
+        properties = {'routing': 'default', 'nbr_peers': 1, 'direction': direction}
+        if self.args.queue_length:
+            properties['queue_length'] = self.args.queue_length
+        return {'id': port_id, 'name': 'token', 'properties': properties}
+
+    def deploy(self):
+        self.deployed = True
+        self.log("Deploying std.Identity '%s'" % self.actor_id)
+        self.send({
+            'cmd': 'ACTOR_NEW',
+            'msg_uuid': str(uuid.uuid4()),
+            'to_rt_uuid': self.node_id,
+            'from_rt_uuid': self.id,
+            'state': {
+                'actor_type': 'std.Identity',
+                'prev_connections': {
+                    'inports': {self.inport_id: [[self.id, self.src_port_id]]},
+                    'outports': {self.outport_id: [[self.id, self.sink_port_id]]}
+                },
+                'actor_state': {
+                    'private': {
+                        '_id': self.actor_id,
+                        '_name': 'mock_proxy_identity',
+                        'inports': {'token': self.port(self.inport_id, 'in')},
+                        'outports': {'token': self.port(self.outport_id, 'out')}
+                    },
+                    'managed': {'dump': False}
+                }
+            }
+        })
+
+    def ready(self):
+        return self.token_tunnel is not None and \
+            self.src_port_id in self.connected and self.sink_port_id in self.connected
+
+    def token_reply(self, msg, first, last):
+        value = {'cmd': 'TOKEN_REPLY', 'port_id': msg['value']['port_id'],
+                 'peer_port_id': msg['value']['peer_port_id'], 'sequencenbr': first, 'value': 'ACK'}
+        if last is not None and last != first:
+            value['sequencenbr_end'] = last
+        self.tunnel_data(msg['tunnel_id'], value)
+
+    def token_received(self, data):
+        if not isinstance(data, bytes) or len(data) < 8:
+            return
+        token = struct.unpack_from('>Q', data)[0]
+        if token != self.expected:
+            self.out_of_order += 1
+        self.expected = token + 1
+        sent_at = self.sent_at.pop(token, None)
+        if sent_at is not None and self.measuring:
+            self.latencies.append(time.time() - sent_at)
+            self.received += 1
+
+    def token_acked(self, value):
+        first = value['sequencenbr']
+        last = value.get('sequencenbr_end', first)
+        if value['value'] == 'ACK':
+            for seq in range(self.acked, last + 1):
+                self.payloads.pop(seq, None)
+            self.acked = max(self.acked, last + 1)
+        elif first >= self.acked and first < self.next_seq:
+            # go back to the first unacked token, the node only accepts tokens in order
+            self.next_seq = self.acked
+
+    def send_token(self, seq):
+        self.tunnel_data(self.token_tunnel, {
+            'cmd': 'TOKEN', 'port_id': self.src_port_id, 'peer_port_id': self.inport_id,
+            'sequencenbr': seq, 'token': {'type': 'Token', 'data': self.payloads[seq]}})
+
+    def pump(self, now, due):
+        """ Sends resent and new tokens within the window, returns when the next one is due """
+        while self.next_seq - self.acked < self.args.window:
+            if self.next_seq not in self.payloads:
+                if self.args.rate > 0 and now < due:
+                    return due
+                self.payloads[self.next_seq] = struct.pack('>Q', self.next_token) + self.padding
+                self.sent_at[self.next_token] = now
+                self.next_token += 1
+                if self.args.rate > 0:
+                    due = max(due + 1.0 / self.args.rate, now - 1.0)
+            if self.next_seq == self.args.drop and not self.dropped:
+                # lost on the way, the node should nack the tokens after it
+                self.dropped = True
+            else:
+                self.send_token(self.next_seq)
+            self.next_seq += 1
+        return due
+
+    def run(self, server, pid_of):
+        self.sock, _ = server.accept()
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+
+        while self.node_id is None:
+            for frame in self.recv_frames(1.0):
+                self.handle_join(frame)
+
+        deadline = time.time() + self.args.timeout
+        while not self.ready():
+            if time.time() > deadline:
+                raise RuntimeError("Node did not connect the actor ports")
+            for frame in self.recv_frames(0.1):
+                self.handle(unpack(frame)[0])
+        self.log("Actor ports connected")
+
+        pid = pid_of()
+        start = time.time()
+        warmup_end = start + self.args.warmup
+        end = warmup_end + self.args.duration
+        due = start
+        stats_start = None
+        while True:
+            now = time.time()
+            if not self.measuring and now >= warmup_end:
+                self.measuring = True
+                stats_start = proc_stats(pid) if pid else {}
+                measure_start = now
+            if now >= end:
+                break
+            due = self.pump(now, due)
+            timeout = min(end, due if self.args.rate > 0 else end) - time.time()
+            if self.next_seq - self.acked >= self.args.window:
+                timeout = end - time.time()
+            for frame in self.recv_frames(timeout):
+                self.handle(unpack(frame)[0])
+
+        elapsed = time.time() - measure_start
+        stats_end = proc_stats(pid) if pid else {}
+        self.report(elapsed, stats_start, stats_end)
+
+    def report(self, elapsed, stats_start, stats_end):
+        n = self.received
+        print("tokens: %d of %d bytes in %.1f s" % (n, max(8, self.args.size), elapsed))
+        print("throughput: %.1f tokens/s" % (n / elapsed if elapsed > 0 else 0.0))
+        print("out of order: %d" % self.out_of_order)
+        print("latency: p50 %.3f ms, p99 %.3f ms" % (percentile(self.latencies, 50) * 1000,
+                                                   percentile(self.latencies, 99) * 1000))
+        if 'syscr' in stats_end and 'syscr' in stats_start and n > 0:
+            calls = (stats_end['syscr'] + stats_end['syscw']) - (stats_start['syscr'] + stats_start['syscw'])
+            print("syscalls: %.2f read/write per token" % (float(calls) / n))
+        if 'VmRSS' in stats_end:
+            print("rss: %d kB, peak %d kB" % (stats_end['VmRSS'], stats_end.get('VmHWM', 0)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Mock proxy and token benchmark for calvin_c")
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=5000)
+    parser.add_argument('--runtime', help="calvin_c binary to start, otherwise wait for a node to connect")
+    parser.add_argument('--pid', type=int, help="pid of an already started node, for syscalls and rss")
+    parser.add_argument('--size', type=int, default=64, help="token data size in bytes (min 8)")
+    parser.add_argument('--rate', type=float, default=0, help="tokens/s to send, 0 for as fast as acked")
+    parser.add_argument('--window', type=int, default=4, help="max tokens sent and not acked")
+    parser.add_argument('--batch', type=int, default=1, help="token batch size announced to the node")
+    parser.add_argument('--drop', type=int, help="sequence number of a token to not send the first time")
+    parser.add_argument('--queue-length', type=int, default=0, help="queue length of the actor ports")
+    parser.add_argument('--duration', type=float, default=10)
+    parser.add_argument('--warmup', type=float, default=1)
+    parser.add_argument('--timeout', type=float, default=10, help="seconds to wait for the deployment")
+    parser.add_argument('--verbose', action='store_true')
+    args = parser.parse_args()
+
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind((args.host, args.port))
+    server.listen(1)
+
+    node = None
+    workdir = None
+    if args.runtime:
+        # a fresh directory so no state file from a previous run is restored
+        workdir = tempfile.mkdtemp(prefix='mock_proxy_')
+        uris = json.dumps(["calvinip://%s:%d" % (args.host, args.port)])
+        output = None if args.verbose else open(os.devnull, 'w')
+        node = subprocess.Popen([os.path.abspath(args.runtime), '-u', uris],
+                                cwd=workdir, stdout=output, stderr=output)
+
+    proxy = MockProxy(args)
+    try:
+        proxy.run(server, lambda: node.pid if node else args.pid)
+    finally:
+        if node:
+            node.terminate()
+            try:
+                node.wait(5)
+            except subprocess.TimeoutExpired:
+                node.kill()
+        if workdir:
+            shutil.rmtree(workdir, ignore_errors=True)
+        server.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,52 @@
+# -*- coding: utf-8 -*-
+
+# Copyright (c) 2016 Ericsson AB
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+import re
+import subprocess
+import sys
+import pytest
+
+""" Test the token window of the constrained runtime against the mock proxy,
+no base runtimes are needed.
+"""
+
+calvin_c = "./calvin_c"
+
+
+def run_mock_proxy(*args):
+    return subprocess.check_output([sys.executable, "test/mock_proxy.py", "--runtime", calvin_c,
+                                    "--port", "5010", "--warmup", "0", "--duration", "2"] + list(args),
+                                   universal_newlines=True)
+
+
+def get_count(output, name):
+    return int(re.search(r"%s: (\d+)" % name, output).group(1))
+
+
+@pytest.mark.skipif(not os.path.exists(calvin_c), reason="calvin_c not built")
+def test_token_window():
+    output = run_mock_proxy("--window", "4")
+    assert get_count(output, "tokens") > 0
+    assert get_count(output, "out of order") == 0
+
+
+@pytest.mark.skipif(not os.path.exists(calvin_c), reason="calvin_c not built")
+def test_token_dropped_from_window():
+    # the tokens after the lost one are nacked and all are resent from it
+    output = run_mock_proxy("--window", "4", "--drop", "5")
+    assert get_count(output, "tokens") > 5
+    assert get_count(output, "out of order") == 0